@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdlib>
+#include <new>
+
+// ======================================================================
+// AlignedAllocator
+//
+// std::allocator replacement that hands out memory aligned to `Alignment`
+// bytes (default: one cache line / one AVX-512 register), so that arrays
+// can be streamed with aligned vector loads.
+
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator
+{
+  using value_type = T;
+
+  template <typename U>
+  struct rebind
+  {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() = default;
+
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&)
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    void* p = nullptr;
+    if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, std::size_t n) { std::free(p); }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment>&) const
+  {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment>&) const
+  {
+    return false;
+  }
+};
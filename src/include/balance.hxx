@@ -1,4 +1,38 @@
 
 #pragma once
 
+#include <mpi.h>
+
 extern int psc_balance_generation_cnt;
+
+// per-patch compute time measured in the current step, and its
+// exponentially smoothed average over the previous steps. Both are only
+// allocated when the balancer is using measured cost.
+extern double* psc_balance_comp_time_by_patch;
+extern double* psc_balance_cost_by_patch;
+
+// ======================================================================
+// PatchTimer
+//
+// adds the wall time spent in its scope to patch p's compute time,
+// e.g. in the body of a loop over patches. Does nothing unless the cost is
+// being measured.
+
+class PatchTimer
+{
+public:
+  PatchTimer(int p)
+    : p_{p}, t0_{psc_balance_comp_time_by_patch ? MPI_Wtime() : 0.}
+  {}
+
+  ~PatchTimer()
+  {
+    if (psc_balance_comp_time_by_patch) {
+      psc_balance_comp_time_by_patch[p_] += MPI_Wtime() - t0_;
+    }
+  }
+
+private:
+  int p_;
+  double t0_;
+};
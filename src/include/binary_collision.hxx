@@ -2,31 +2,10 @@
 #pragma once
 
 #include "cuda_compat.h"
+#include "rng_philox.hxx"
 
 #include <cmath>
 
-// ======================================================================
-// RngC
-
-template <typename real_t>
-struct RngC
-{
-  // ----------------------------------------------------------------------
-  // uniform
-  //
-  // returns random number in ]0:1]
-
-  real_t uniform()
-  {
-    real_t ran;
-    do {
-      ran = real_t(random()) / RAND_MAX;
-    } while (ran == real_t(0.f));
-
-    return ran;
-  }
-};
-
 // ======================================================================
 // RngFake
 //
@@ -36,6 +15,11 @@ struct RngFake
 {
   using real_t = double;
 
+  RngFake() = default;
+  __host__ __device__ RngFake(uint64_t key, uint32_t stream, uint32_t timestep,
+                              uint32_t seq = 0)
+  {}
+
   __host__ __device__ real_t uniform() { return .5; }
 };
 
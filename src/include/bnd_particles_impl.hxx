@@ -4,6 +4,7 @@
 #include <mrc_profile.h>
 
 #include <cstring>
+#include <memory>
 
 #include "balance.hxx"
 #include "ddc_particles.hxx"
@@ -11,8 +12,6 @@
 #include "particles_simple.hxx"
 
 extern int pr_time_step_no_comm;
-extern double* psc_balance_comp_time_by_patch;
-
 // ======================================================================
 // BndParticlesCommon
 
@@ -51,31 +50,56 @@ struct BndParticlesCommon : BndParticlesBase
   // process_and_exchange
 
   void process_and_exchange(Mparticles& mprts, BndBuffers& bufs)
+  {
+    process_and_exchange_begin(mprts, bufs);
+    process_and_exchange_end(mprts, bufs);
+  }
+
+  // ----------------------------------------------------------------------
+  // process_and_exchange_begin
+  //
+  // sort out the particles that left their patch and get them on their way.
+  // Other work can be done until process_and_exchange_end(), as long as it
+  // doesn't touch the particles.
+
+  void process_and_exchange_begin(Mparticles& mprts, BndBuffers& bufs)
   {
     static int pr_B, pr_C;
     if (!pr_B) {
       pr_B = prof_register("xchg_prep", 1., 0, 0);
-      pr_C = prof_register("xchg_comm", 1., 0, 0);
+      pr_C = prof_register("xchg_comm_begin", 1., 0, 0);
     }
 
     // prof_restart(pr_time_step_no_comm);
     prof_start(pr_B);
 #pragma omp parallel for
     for (int p = 0; p < ddcp->nr_patches; p++) {
-      if (psc_balance_comp_time_by_patch)
-        psc_balance_comp_time_by_patch[p] -= MPI_Wtime();
+      PatchTimer timer(p);
       process_patch(mprts.grid(), mprts.particleIndexer(), bufs, p);
-      if (psc_balance_comp_time_by_patch)
-        psc_balance_comp_time_by_patch[p] += MPI_Wtime();
     }
     prof_stop(pr_B);
     // prof_stop(pr_time_step_no_comm);
 
     prof_start(pr_C);
-    ddcp->comm(bufs);
+    ddcp->comm_begin(bufs);
     prof_stop(pr_C);
   }
 
+  // ----------------------------------------------------------------------
+  // process_and_exchange_end
+
+  void process_and_exchange_end(Mparticles& mprts, BndBuffers& bufs)
+  {
+    static int pr_D;
+    if (!pr_D) {
+      pr_D = prof_register("xchg_comm_end", 1., 0, 0);
+    }
+
+    prof_start(pr_D);
+    ddcp->comm_end(bufs);
+    prof_stop(pr_D);
+  }
+
 protected:
   void process_patch(const Grid_t& grid, const ParticleIndexer<real_t>& pi,
                      BndBuffers& buf, int p);
@@ -109,15 +133,19 @@ void BndParticlesCommon<MP>::process_patch(const Grid_t& grid,
   }
 
   using BndBuffer = typename Mparticles::BndBuffer;
+  using BndpParticle = typename Mparticles::BndpParticle;
   BndBuffer& buf = bufs[p];
+  const BndBuffer& cbuf = buf;
   unsigned int n_begin = 0;
   unsigned int n_end = buf.size();
   unsigned int head = n_begin;
 
   for (int n = n_begin; n < n_end; n++) {
-    auto* prt = &buf[n];
-    real_t* xi = prt->x;
-    real_t* pxi = prt->u;
+    // work on a copy, so that this also works with SoA buffers, where
+    // buf[n] is a load/store proxy rather than a reference
+    BndpParticle prt = cbuf[n];
+    real_t* xi = prt.x;
+    real_t* pxi = prt.u;
 
     Int3 pos = pi.cellPosition(xi);
 
@@ -127,7 +155,7 @@ void BndParticlesCommon<MP>::process_patch(const Grid_t& grid,
       // fast path
       // particle is still inside patch: move into right position
       pi.validCellIndex(xi);
-      buf[head++] = *prt;
+      buf[head++] = prt;
       continue;
     }
 
@@ -197,10 +225,10 @@ void BndParticlesCommon<MP>::process_patch(const Grid_t& grid,
     if (!drop) {
       if (dir[0] == 0 && dir[1] == 0 && dir[2] == 0) {
         pi.validCellIndex(xi);
-        buf[head++] = *prt;
+        buf[head++] = prt;
       } else {
         auto* nei = &dpatch->nei[mrc_ddc_dir2idx(dir)];
-        nei->send_buf.push_back(*prt);
+        nei->send_buf.push_back(prt);
       }
     }
   }
@@ -223,16 +251,45 @@ struct BndParticles_ : BndParticlesCommon<MP>
 
   void operator()(Mparticles& mprts)
   {
+    begin(mprts);
+    end(mprts);
+
+    // struct psc_mfields *mflds = psc_mfields_get_as(psc->flds, "c", JXI, JXI +
+    // 3); psc_bnd_particles_open_boundary(bnd, particles, mflds);
+    // psc_mfields_put_as(mflds, psc->flds, JXI, JXI + 3);
+  }
+
+  // ----------------------------------------------------------------------
+  // begin / end
+  //
+  // same as operator(), but split so that the particle messages can be in
+  // flight while the caller does something else (e.g., push B). `mprts`
+  // must not be accessed in between.
+
+  void begin(Mparticles& mprts)
+  {
+    assert(!pending_);
     if (psc_balance_generation_cnt > this->balance_generation_cnt_) {
       this->balance_generation_cnt_ = psc_balance_generation_cnt;
       this->reset(mprts.grid());
     }
 
-    auto&& bufs = mprts.bndBuffers();
-    this->process_and_exchange(mprts, bufs);
+    pending_.reset(new Pending{mprts.bndBuffers()});
+    this->process_and_exchange_begin(mprts, pending_->bufs);
+  }
 
-    // struct psc_mfields *mflds = psc_mfields_get_as(psc->flds, "c", JXI, JXI +
-    // 3); psc_bnd_particles_open_boundary(bnd, particles, mflds);
-    // psc_mfields_put_as(mflds, psc->flds, JXI, JXI + 3);
+  void end(Mparticles& mprts)
+  {
+    assert(pending_);
+    this->process_and_exchange_end(mprts, pending_->bufs);
+    pending_.reset();
   }
+
+private:
+  struct Pending
+  {
+    decltype(std::declval<Mparticles&>().bndBuffers()) bufs;
+  };
+
+  std::unique_ptr<Pending> pending_;
 };
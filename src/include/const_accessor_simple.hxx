@@ -11,9 +11,11 @@ struct ParticleProxySimple
   using real_t = typename Mparticles::real_t;
   using Patch = typename Mparticles::Patch;
   using Real3 = Vec3<real_t>;
+  // Particle& for AoS storage, a load/store proxy for SoA storage
+  using reference = typename Patch::reference;
 
-  ParticleProxySimple(Particle& prt, const Mparticles& mprts)
-    : prt_{prt}, mprts_{mprts}
+  ParticleProxySimple(reference prt, const Mparticles& mprts)
+    : prt_{std::forward<reference>(prt)}, mprts_{mprts}
   {}
 
   Real3 x() const { return prt_.x; }
@@ -38,7 +40,7 @@ struct ParticleProxySimple
   }
 
 private:
-  Particle& prt_;
+  reference prt_;
   const Mparticles& mprts_;
 };
 
@@ -52,8 +54,10 @@ struct ConstParticleProxySimple
   using real_t = typename Mparticles::real_t;
   using Real3 = Vec3<real_t>;
   using Double3 = Vec3<double>;
+  // const Particle& for AoS storage, a copy for SoA storage
+  using const_reference = typename Mparticles::Patch::const_reference;
 
-  ConstParticleProxySimple(const Particle& prt, const Mparticles& mprts, int p)
+  ConstParticleProxySimple(const_reference prt, const Mparticles& mprts, int p)
     : prt_{prt}, mprts_{mprts}, p_{p}
   {}
 
@@ -76,7 +80,7 @@ struct ConstParticleProxySimple
   }
 
 private:
-  const Particle& prt_;
+  const_reference prt_;
   const Mparticles& mprts_;
   const int p_;
 };
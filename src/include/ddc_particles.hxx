@@ -28,6 +28,8 @@ struct ddc_particles
   ddc_particles(const Grid_t& grid);
 
   void comm(BndBuffers& bufs);
+  void comm_begin(BndBuffers& bufs);
+  void comm_end(BndBuffers& bufs);
 
   struct dsend_entry
   {
@@ -80,6 +82,11 @@ struct ddc_particles
   int n_ranks;
   std::vector<MPI_Request> send_reqs_;
   std::vector<MPI_Request> recv_reqs_;
+
+  // state kept between comm_begin() and comm_end()
+  Buffer send_buf_;
+  Buffer recv_buf_;
+  std::vector<typename BndBuffer::iterator> it_recv_;
 };
 
 // ----------------------------------------------------------------------
@@ -282,8 +289,21 @@ inline ddc_particles<MP>::ddc_particles(const Grid_t& grid)
 template <typename MP>
 inline void ddc_particles<MP>::comm(BndBuffers& bufs)
 {
-  using iterator_t = typename Buffer::iterator;
+  comm_begin(bufs);
+  comm_end(bufs);
+}
+
+// ----------------------------------------------------------------------
+// comm_begin
+//
+// exchanges the counts, posts the particle sends / receives and moves
+// particles between local patches. Until comm_end() is called, the tail
+// of each patch's buffer is reserved for the incoming particles and must
+// not be touched.
 
+template <typename MP>
+inline void ddc_particles<MP>::comm_begin(BndBuffers& bufs)
+{
   MPI_Comm comm = MPI_COMM_WORLD; // FIXME
   int rank, size;
   MPI_Comm_rank(comm, &rank);
@@ -375,9 +395,10 @@ inline void ddc_particles<MP>::comm(BndBuffers& bufs)
   }
 
   // post sends
-  Buffer send_buf;
-  send_buf.resize(n_send);
-  auto it = send_buf.begin();
+  // (send / recv buffers are kept around, so they're only reallocated when
+  // they need to grow)
+  send_buf_.resize(n_send);
+  Particle* it = send_buf_.data();
   for (int r = 0; r < n_ranks; r++) {
     if (cinfo_[r].n_send == 0)
       continue;
@@ -390,24 +411,23 @@ inline void ddc_particles<MP>::comm(BndBuffers& bufs)
       std::copy(send_buf_nei->begin(), send_buf_nei->end(), it);
       it += send_buf_nei->size();
     }
-    MPI_Isend(&*it0, sz * cinfo_[r].n_send, mpi_dtype, cinfo_[r].rank, 1, comm,
+    MPI_Isend(it0, sz * cinfo_[r].n_send, mpi_dtype, cinfo_[r].rank, 1, comm,
               &send_reqs_[r]);
   }
-  assert(it == send_buf.begin() + n_send);
+  assert(it == send_buf_.data() + n_send);
 
   // post receives
-  Buffer recv_buf;
-  recv_buf.resize(n_recv);
-  it = recv_buf.begin();
+  recv_buf_.resize(n_recv);
+  it = recv_buf_.data();
   for (int r = 0; r < n_ranks; r++) {
     if (cinfo_[r].n_recv == 0)
       continue;
 
-    MPI_Irecv(&*it, sz * cinfo_[r].n_recv, mpi_dtype, cinfo_[r].rank, 1, comm,
+    MPI_Irecv(it, sz * cinfo_[r].n_recv, mpi_dtype, cinfo_[r].rank, 1, comm,
               &recv_reqs_[r]);
     it += cinfo_[r].n_recv;
   }
-  assert(it == recv_buf.begin() + n_recv);
+  assert(it == recv_buf_.data() + n_recv);
 
   // leave room for receives (FIXME? just change order)
   // each patch's array looks like:
@@ -416,7 +436,8 @@ inline void ddc_particles<MP>::comm(BndBuffers& bufs)
   //          --------------      new particles go here (# = patch->n_recvs)
   //          ----------          locally exchanged particles go here
   //                    ----      remote particles go here
-  auto* it_recv = new iterator_t[nr_patches];
+  auto& it_recv = it_recv_;
+  it_recv.resize(nr_patches);
 
   for (int p = 0; p < nr_patches; p++) {
     patch* patch = &patches_[p];
@@ -452,13 +473,25 @@ inline void ddc_particles<MP>::comm(BndBuffers& bufs)
       }
     }
   }
+}
+
+// ----------------------------------------------------------------------
+// comm_end
+//
+// waits for the particles from other ranks and appends them to their
+// patches
+
+template <typename MP>
+inline void ddc_particles<MP>::comm_end(BndBuffers& bufs)
+{
+  auto& it_recv = it_recv_;
 
   MPI_Waitall(n_ranks, recv_reqs_.data(), MPI_STATUSES_IGNORE);
   MPI_Waitall(n_ranks, send_reqs_.data(), MPI_STATUSES_IGNORE);
 
   // copy received particles into right place
 
-  it = recv_buf.begin();
+  auto it = recv_buf_.begin();
   for (int r = 0; r < n_ranks; r++) {
     for (int i = 0; i < cinfo_[r].n_recv_entries; i++) {
       drecv_entry* re = &cinfo_[r].recv_entry[i];
@@ -467,14 +500,12 @@ inline void ddc_particles<MP>::comm(BndBuffers& bufs)
       it_recv[re->patch] += cinfo_[r].recv_cnts[i];
     }
   }
-  assert(it == recv_buf.begin() + n_recv);
+  assert(it == recv_buf_.end());
 
   for (int p = 0; p < nr_patches; p++) {
     BndBuffer& buf = bufs[p];
     assert(it_recv[p] == buf.end());
   }
-
-  delete[] it_recv;
 }
 
 #endif
@@ -83,6 +83,7 @@ struct MfieldsBase
 
   int _n_comps() const { return n_fields_; }
   Int3 ibn() const { return ibn_; }
+  virtual std::size_t element_size() const = 0;
 
   const Grid_t& _grid() const { return *grid_; }
 
@@ -175,6 +176,11 @@ struct MfieldsStateBase
   int _n_patches() const { return grid_->n_patches(); }
   int _n_comps() const { return n_fields_; }
   Int3 ibn() const { return ibn_; }
+  virtual std::size_t element_size() const = 0;
+
+  // the Mfields that holds the data, if there is one, which then is one of
+  // MfieldsBase::instances itself
+  virtual const MfieldsBase* mfields_base() const { return nullptr; }
 
   const Grid_t& _grid() { return *grid_; }
 
@@ -354,6 +360,8 @@ struct Mfields
 
   auto gt() { return Base::storage().view(); }
 
+  std::size_t element_size() const override { return sizeof(real_t); }
+
   template <typename FUNC>
   void Foreach_3d(int l, int r, FUNC&& F) const
   {
@@ -456,6 +464,9 @@ struct MfieldsStateFromMfields : MfieldsStateBase
 
   auto gt() { return mflds_.storage(); }
 
+  std::size_t element_size() const override { return sizeof(real_t); }
+  const MfieldsBase* mfields_base() const override { return &mflds_; }
+
 public: // FIXME public so that we can read/write it, friend needs include which
         // gives nvcc issues
   Mfields mflds_;
@@ -23,6 +23,7 @@ public:
     writer.put("np", domain.np, launch);
     writer.put("ldims", domain.ldims, launch);
     writer.put("dx", domain.dx, launch);
+    writer.put("curve", int(domain.curve), kg::io::Mode::Blocking);
   }
 
   static void get(Engine& reader, value_type& domain,
@@ -34,6 +35,12 @@ public:
     reader.get("np", domain.np, launch);
     reader.get("ldims", domain.ldims, launch);
     reader.get("dx", domain.dx, launch);
+    // files written before there was a choice of curve used BYDIM
+    int curve = int(psc::grid::Curve::BYDIM);
+    if (reader.hasAttribute("curve")) {
+      reader.get("curve", curve, Mode::Blocking);
+    }
+    domain.curve = psc::grid::Curve(curve);
   }
 };
 
@@ -10,6 +10,31 @@ namespace psc
 namespace grid
 {
 
+// ======================================================================
+// Curve
+//
+// space-filling curve that orders the patches. The decomposition assigns
+// contiguous ranges along it to each proc, so a more local curve means
+// less surface between procs. MORTON needs a power of 2 number of
+// patches in each direction.
+
+enum class Curve
+{
+  BYDIM,
+  MORTON,
+  HILBERT,
+};
+
+inline const char* to_string(Curve curve)
+{
+  switch (curve) {
+    case Curve::BYDIM: return "bydim";
+    case Curve::MORTON: return "morton";
+    case Curve::HILBERT: return "hilbert";
+  }
+  return "unknown";
+}
+
 // ======================================================================
 // Domain
 
@@ -46,6 +71,7 @@ struct Domain
   Int3 np; ///< Number of patches in each dimension
   Int3 ldims;
   Real3 dx;
+  Curve curve = Curve::BYDIM; ///< Order of the patches
 };
 
 template <typename R>
@@ -57,6 +83,7 @@ inline std::ostream& operator<<(std::ostream& os, const Domain<R>& domain)
   os << ", np=" << domain.np;
   os << ", ldims=" << domain.ldims;
   os << ", dx=" << domain.dx;
+  os << ", curve=" << to_string(domain.curve);
   os << "}";
   return os;
 }
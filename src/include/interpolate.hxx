@@ -707,6 +707,11 @@ struct InterpolateEM
   using ip_coeffs_t = ip_coeffs<real_t, OPT_IP>;
   using ip_coeff_t = typename ip_coeffs_t::ip_coeff_t;
 
+  // same interpolation, reading from a different kind of fields (e.g., a
+  // FldTile)
+  template <typename F2>
+  using rebind = InterpolateEM<F2, OPT_IP, OPT_DIM>;
+
   __host__ __device__ void set_coeffs(real_t xm[3])
   {
     cx.set(xm[0]);
@@ -0,0 +1,93 @@
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+// ======================================================================
+// IOThread
+//
+// Runs tasks (typically writing out data that the caller has already
+// copied / gathered) in order on a background thread, so the simulation
+// can continue while the I/O happens. Tasks that are still queued when
+// it's destroyed are finished first.
+//
+// If the tasks make MPI calls, MPI needs to have been initialized with
+// MPI_THREAD_MULTIPLE, and they should use their own communicator.
+
+class IOThread
+{
+public:
+  using task_type = std::function<void(void)>;
+
+  IOThread() : thread_{&IOThread::thread_func, this} {}
+
+  IOThread(const IOThread&) = delete;
+  IOThread& operator=(const IOThread&) = delete;
+
+  ~IOThread()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    exit_ = true;
+    lock.unlock();
+    cv_.notify_all();
+
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  void push(task_type task)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_.push(std::move(task));
+    lock.unlock();
+    cv_.notify_all();
+  }
+
+  // ----------------------------------------------------------------------
+  // wait
+  //
+  // blocks until all tasks queued so far are done
+
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_done_.wait(lock, [this] { return queue_.empty() && !busy_; });
+  }
+
+private:
+  void thread_func()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+      cv_.wait(lock, [this] { return queue_.size() || exit_; });
+      if (queue_.empty()) { // exit_, and nothing left to do
+        break;
+      }
+
+      auto task = std::move(queue_.front());
+      queue_.pop();
+      busy_ = true;
+
+      lock.unlock();
+      task();
+      lock.lock();
+
+      busy_ = false;
+      cv_done_.notify_all();
+    }
+  }
+
+  std::queue<task_type> queue_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable cv_done_;
+  bool busy_ = false;
+  bool exit_ = false;
+  std::thread thread_; // needs to be last, it uses the above right away
+};
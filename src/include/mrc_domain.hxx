@@ -35,6 +35,8 @@ struct MrcDomain
     mrc_domain_set_param_int(domain_, "bcz", bc[2]);
     mrc_domain_set_param_int(domain_, "nr_patches", nr_patches);
     mrc_domain_set_param_int3(domain_, "np", grid_domain.np);
+    mrc_domain_set_param_select(domain_, "curve_type",
+                                curveType(grid_domain.curve, grid_domain.np));
 
     struct mrc_crds* crds = mrc_domain_get_crds(domain_);
     mrc_crds_set_type(crds, "uniform");
@@ -140,5 +142,20 @@ struct MrcDomain
   mrc_ddc* create_ddc() const { return mrc_domain_create_ddc(domain_); }
 
 private:
+  static int curveType(psc::grid::Curve curve, const Int3& np)
+  {
+    switch (curve) {
+      case psc::grid::Curve::BYDIM: return CURVE_BYDIM;
+      case psc::grid::Curve::MORTON:
+        for (int d = 0; d < 3; d++) {
+          assert((np[d] & (np[d] - 1)) == 0);
+        }
+        return CURVE_MORTON;
+      case psc::grid::Curve::HILBERT: return CURVE_HILBERT;
+    }
+    assert(0);
+    return CURVE_BYDIM;
+  }
+
   mrc_domain* domain_ = nullptr;
 };
@@ -13,6 +13,9 @@ struct OutputParticlesParams
   bool use_independent_io;
   const char* romio_cb_write;
   const char* romio_ds_write;
+  bool aggregate; // only one rank per node writes, after gathering the
+                  // particles from the others on the node
+  bool async;     // write in the background, while the simulation continues
 };
 
 // ======================================================================
@@ -7,8 +7,13 @@
 #include "particle_simple.hxx"
 #include "particle_indexer.hxx"
 #include "UniqueIdGenerator.h"
+#include "aligned_allocator.hxx"
 
 #include <iterator>
+#include <type_traits>
+#ifndef NDEBUG
+#include <unordered_set>
+#endif
 
 // ======================================================================
 
@@ -42,9 +47,14 @@ struct MparticlesStorage
   using Particle = _Particle;
   using PatchBuffer = std::vector<Particle>;
   using Buffers = std::vector<PatchBuffer>;
+  using BndBuffer = PatchBuffer;
+  using BndBuffers = Buffers;
+  using BndBuffersRef = Buffers&;
   using Range = Span<Particle>;
   using iterator = typename Range::iterator;
   using const_iterator = typename Range::const_iterator;
+  using reference = Particle&;
+  using const_reference = const Particle&;
 
   MparticlesStorage(uint n_patches) : bufs_(n_patches) {}
 
@@ -95,8 +105,291 @@ struct MparticlesStorage
   {
     return bufs_[p][n];
   } // FIXME, ugly and not great for effciency
+  const Particle& at(int p, int n) const { return bufs_[p][n]; }
   void push_back(int p, const Particle& prt) { bufs_[p].push_back(prt); }
 
+  // the underlying buffer, e.g., to hand it over to another storage
+  PatchBuffer& buffer(int p) { return bufs_[p]; }
+
+  Buffers& bndBuffers() { return bufs_; }
+
+private:
+  Buffers bufs_;
+};
+
+// ======================================================================
+// ParticleBufferSoA
+//
+// Keeps one patch worth of particles as separate, aligned arrays per
+// component (x, y, z, ux, uy, uz, qni_wni, kind), so that kernels can
+// stream through contiguous lanes via x(d), u(d), etc.
+//
+// Element access goes through `reference`, which loads the particle when
+// it's created and stores it back when it goes away, so code written
+// against `Particle&` (accessors, injectors, conversion) keeps working.
+// Hence there must not be two live references to the same particle, as
+// whichever goes away last would undo the other's changes; debug builds
+// check for that.
+
+template <typename _Particle>
+class ParticleBufferSoA
+{
+public:
+  using Particle = _Particle;
+  using real_t = typename Particle::real_t;
+  using Real3 = typename Particle::Real3;
+
+  template <typename T>
+  using Array = std::vector<T, AlignedAllocator<T>>;
+
+  static_assert(std::is_same<Particle, ParticleSimple<real_t>>::value,
+                "ParticleBufferSoA only supports ParticleSimple");
+
+  class reference : public Particle
+  {
+  public:
+    reference(ParticleBufferSoA& buf, size_t n)
+      : Particle(buf.get(n)), buf_{&buf}, n_{n}
+    {
+#ifndef NDEBUG
+      bool inserted = buf.live_.insert(n).second;
+      assert(inserted && "two references to the same SoA particle");
+#endif
+    }
+
+    reference(const reference&) = delete;
+    reference(reference&& other)
+      : Particle(other), buf_{other.buf_}, n_{other.n_}
+    {
+      other.buf_ = nullptr;
+    }
+
+    ~reference()
+    {
+      if (buf_) {
+        buf_->set(n_, *this);
+#ifndef NDEBUG
+        buf_->live_.erase(n_);
+#endif
+      }
+    }
+
+    reference& operator=(const Particle& prt)
+    {
+      Particle::operator=(prt);
+      return *this;
+    }
+
+    reference& operator=(const reference& other)
+    {
+      Particle::operator=(other);
+      return *this;
+    }
+
+    friend void swap(reference& a, reference& b)
+    {
+      using std::swap;
+      swap(static_cast<Particle&>(a), static_cast<Particle&>(b));
+    }
+
+  private:
+    ParticleBufferSoA* buf_;
+    size_t n_;
+  };
+
+  using const_reference = Particle;
+
+  class iterator
+  {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Particle;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = typename ParticleBufferSoA::reference;
+
+    iterator() = default;
+    iterator(ParticleBufferSoA& buf, size_t n) : buf_{&buf}, n_{n} {}
+
+    reference operator*() const { return {*buf_, n_}; }
+    reference operator[](difference_type n) const { return {*buf_, n_ + n}; }
+
+    iterator& operator++()
+    {
+      n_++;
+      return *this;
+    }
+    iterator& operator--()
+    {
+      n_--;
+      return *this;
+    }
+    iterator& operator+=(difference_type n)
+    {
+      n_ += n;
+      return *this;
+    }
+    iterator operator+(difference_type n) const { return {*buf_, n_ + n}; }
+    difference_type operator-(const iterator& other) const
+    {
+      return difference_type(n_) - difference_type(other.n_);
+    }
+
+    bool operator==(const iterator& other) const { return n_ == other.n_; }
+    bool operator!=(const iterator& other) const { return n_ != other.n_; }
+    bool operator<(const iterator& other) const { return n_ < other.n_; }
+
+  private:
+    ParticleBufferSoA* buf_ = nullptr;
+    size_t n_ = 0;
+  };
+
+  size_t size() const { return kind_.size(); }
+  size_t capacity() const { return kind_.capacity(); }
+
+  void reserve(size_t n)
+  {
+    for (int d = 0; d < 3; d++) {
+      x_[d].reserve(n);
+      u_[d].reserve(n);
+    }
+    qni_wni_.reserve(n);
+    kind_.reserve(n);
+  }
+
+  void resize(size_t n)
+  {
+    for (int d = 0; d < 3; d++) {
+      x_[d].resize(n);
+      u_[d].resize(n);
+    }
+    qni_wni_.resize(n);
+    kind_.resize(n);
+  }
+
+  void push_back(const Particle& prt)
+  {
+    for (int d = 0; d < 3; d++) {
+      x_[d].push_back(prt.x[d]);
+      u_[d].push_back(prt.u[d]);
+    }
+    qni_wni_.push_back(prt.qni_wni);
+    kind_.push_back(prt.kind);
+  }
+
+  Particle get(size_t n) const
+  {
+    return {Real3{x_[0][n], x_[1][n], x_[2][n]},
+            Real3{u_[0][n], u_[1][n], u_[2][n]},
+            qni_wni_[n],
+            kind_[n],
+            0,
+            0};
+  }
+
+  void set(size_t n, const Particle& prt)
+  {
+    for (int d = 0; d < 3; d++) {
+      x_[d][n] = prt.x[d];
+      u_[d][n] = prt.u[d];
+    }
+    qni_wni_[n] = prt.qni_wni;
+    kind_[n] = prt.kind;
+  }
+
+  reference operator[](size_t n) { return {*this, n}; }
+  const_reference operator[](size_t n) const { return get(n); }
+
+  iterator begin() { return {*this, 0}; }
+  iterator end() { return {*this, size()}; }
+
+  // raw component arrays, for kernels that work on contiguous lanes
+  real_t* x(int d) { return x_[d].data(); }
+  real_t* u(int d) { return u_[d].data(); }
+  real_t* qni_wni() { return qni_wni_.data(); }
+  int* kind() { return kind_.data(); }
+
+private:
+  Array<real_t> x_[3];
+  Array<real_t> u_[3];
+  Array<real_t> qni_wni_;
+  Array<int> kind_;
+#ifndef NDEBUG
+  std::unordered_set<size_t> live_; // particles with a live `reference`
+#endif
+};
+
+// ======================================================================
+// MparticlesStorageSoA
+//
+// Structure-of-arrays alternative to MparticlesStorage. The boundary
+// exchange works on the SoA buffers themselves, through the same
+// load/store references as everything else.
+
+template <typename _Particle>
+struct MparticlesStorageSoA
+{
+  using Particle = _Particle;
+  using PatchBuffer = ParticleBufferSoA<Particle>;
+  using Buffers = std::vector<PatchBuffer>;
+  using BndBuffer = PatchBuffer;
+  using BndBuffers = Buffers;
+  using BndBuffersRef = Buffers&;
+  using iterator = typename PatchBuffer::iterator;
+  using reference = typename PatchBuffer::reference;
+  using const_reference = typename PatchBuffer::const_reference;
+
+  MparticlesStorageSoA(uint n_patches) : bufs_(n_patches) {}
+
+  void reset(const Grid_t& grid) { bufs_ = Buffers(grid.n_patches()); }
+
+  void reserve_all(const std::vector<uint>& n_prts_by_patch)
+  {
+    for (int p = 0; p < bufs_.size(); p++) {
+      bufs_[p].reserve(n_prts_by_patch[p]);
+    }
+  }
+
+  void resize_all(const std::vector<uint>& n_prts_by_patch)
+  {
+    for (int p = 0; p < bufs_.size(); p++) {
+      assert(n_prts_by_patch[p] <= bufs_[p].capacity());
+      bufs_[p].resize(n_prts_by_patch[p]);
+    }
+  }
+
+  void clear()
+  {
+    for (int p = 0; p < bufs_.size(); p++) {
+      bufs_[p].resize(0);
+    }
+  }
+
+  std::vector<uint> sizeByPatch() const
+  {
+    std::vector<uint> n_prts_by_patch(bufs_.size());
+    for (int p = 0; p < bufs_.size(); p++) {
+      n_prts_by_patch[p] = bufs_[p].size();
+    }
+    return n_prts_by_patch;
+  }
+
+  int size() const
+  {
+    int n_prts = 0;
+    for (const auto& buf : bufs_) {
+      n_prts += buf.size();
+    }
+    return n_prts;
+  }
+
+  PatchBuffer& operator[](int p) { return bufs_[p]; }
+  reference at(int p, int n) { return bufs_[p][n]; }
+  const_reference at(int p, int n) const { return bufs_[p][n]; }
+  void push_back(int p, const Particle& prt) { bufs_[p].push_back(prt); }
+
+  PatchBuffer& buffer(int p) { return bufs_[p]; }
+
   Buffers& bndBuffers() { return bufs_; }
 
 private:
@@ -106,7 +399,7 @@ private:
 // ======================================================================
 // MparticlesSimple
 
-template <typename P>
+template <typename P, typename S = MparticlesStorage<P>>
 struct MparticlesSimple : MparticlesBase
 {
   using Particle = P;
@@ -115,24 +408,26 @@ struct MparticlesSimple : MparticlesBase
   using BndpParticle = P;
   using Accessor = AccessorSimple<MparticlesSimple>;
   using ConstAccessor = ConstAccessorSimple<MparticlesSimple>;
-  using Storage = MparticlesStorage<Particle>;
-  using BndBuffer = typename Storage::PatchBuffer;
-  using BndBuffers = typename Storage::Buffers;
+  using Storage = S;
+  using BndBuffer = typename Storage::BndBuffer;
+  using BndBuffers = typename Storage::BndBuffers;
 
   struct Patch
   {
     using iterator = typename Storage::iterator;
-    using const_iterator = typename Storage::const_iterator;
+    using reference = typename Storage::reference;
+    using const_reference = typename Storage::const_reference;
 
     Patch(MparticlesSimple& mprts, int p) : mprts_(mprts), p_(p) {}
 
     Patch(const Patch&) = delete;
     Patch(Patch&&) = default;
 
-    Particle& operator[](int n) { return mprts_.storage_.at(p_, n); }
-    const Particle& operator[](int n) const
+    reference operator[](int n) { return mprts_.storage_.at(p_, n); }
+    const_reference operator[](int n) const
     {
-      return mprts_.storage_.at(p_, n);
+      const auto& storage = mprts_.storage_;
+      return storage.at(p_, n);
     }
 
     iterator begin() { return mprts_.storage_[p_].begin(); }
@@ -146,11 +441,12 @@ struct MparticlesSimple : MparticlesBase
       checkInPatchMod(prt);
       validCellIndex(prt);
       mprts_.storage_.push_back(p_, prt);
+      mprts_.kind_offsets_[p_].clear();
     }
 
     void check() const
     {
-      for (auto& prt : mprts_.storage_[p_]) {
+      for (const auto& prt : mprts_.storage_[p_]) {
         mprts_.pi_.validCellIndex(prt.x());
       }
     }
@@ -182,6 +478,7 @@ struct MparticlesSimple : MparticlesBase
   explicit MparticlesSimple(const Grid_t& grid)
     : MparticlesBase(grid),
       storage_(grid.n_patches()),
+      kind_offsets_(grid.n_patches()),
       uid_gen(grid.comm()),
       pi_(grid)
   {}
@@ -195,6 +492,7 @@ struct MparticlesSimple : MparticlesBase
   {
     MparticlesBase::reset(grid);
     storage_.reset(grid);
+    kind_offsets_ = KindOffsets(grid.n_patches());
   }
 
   Patch operator[](int p) const
@@ -209,8 +507,13 @@ struct MparticlesSimple : MparticlesBase
   void resize_all(const std::vector<uint>& n_prts_by_patch)
   {
     storage_.resize_all(n_prts_by_patch);
+    invalidate_kind_offsets();
+  }
+  void clear()
+  {
+    storage_.clear();
+    invalidate_kind_offsets();
   }
-  void clear() { storage_.clear(); }
   std::vector<uint> sizeByPatch() const override
   {
     return storage_.sizeByPatch();
@@ -226,7 +529,40 @@ struct MparticlesSimple : MparticlesBase
   } // FIXME
   Accessor accessor_() { return {*this}; }
 
-  BndBuffers& bndBuffers() { return storage_.bndBuffers(); }
+  typename Storage::BndBuffersRef bndBuffers()
+  {
+    invalidate_kind_offsets();
+    return storage_.bndBuffers();
+  }
+
+  Storage& storage() { return storage_; }
+
+  // ----------------------------------------------------------------------
+  // kind_offsets
+  //
+  // If the particles in patch p are grouped by kind (see SortIncremental),
+  // kind k occupies [kind_offsets(p)[k], kind_offsets(p)[k + 1]). Adding,
+  // removing or reordering particles by other means resets it to empty.
+
+  const std::vector<uint>& kind_offsets(int p) const
+  {
+    return kind_offsets_[p];
+  }
+
+  // copies into the existing per-patch vector, so that setting the offsets
+  // every step doesn't allocate
+  void set_kind_offsets(int p, const std::vector<uint>& offsets)
+  {
+    assert(offsets.empty() || offsets.back() == storage_[p].size());
+    kind_offsets_[p].assign(offsets.begin(), offsets.end());
+  }
+
+  void invalidate_kind_offsets()
+  {
+    for (auto& offsets : kind_offsets_) {
+      offsets.clear();
+    }
+  }
 
   void check() const
   {
@@ -270,7 +606,10 @@ struct MparticlesSimple : MparticlesBase
   const Convert& convert_from() override { return convert_from_; }
 
 private:
+  using KindOffsets = std::vector<std::vector<uint>>;
+
   Storage storage_;
+  KindOffsets kind_offsets_;
 
 public: // FIXME
   psc::particle::UniqueIdGenerator uid_gen;
@@ -298,3 +637,49 @@ const MparticlesSimple<ParticleSimple<double>>::Convert
   MparticlesSimple<ParticleSimple<double>>::convert_from_;
 extern template const MparticlesSimple<ParticleSimple<double>>::Convert
   MparticlesSimple<ParticleSimple<double>>::convert_from_;
+
+template <>
+const MparticlesSimple<
+  ParticleSimple<float>,
+  MparticlesStorageSoA<ParticleSimple<float>>>::Convert
+  MparticlesSimple<ParticleSimple<float>,
+                   MparticlesStorageSoA<ParticleSimple<float>>>::convert_to_;
+extern template const MparticlesSimple<
+  ParticleSimple<float>,
+  MparticlesStorageSoA<ParticleSimple<float>>>::Convert
+  MparticlesSimple<ParticleSimple<float>,
+                   MparticlesStorageSoA<ParticleSimple<float>>>::convert_to_;
+template <>
+const MparticlesSimple<
+  ParticleSimple<float>,
+  MparticlesStorageSoA<ParticleSimple<float>>>::Convert
+  MparticlesSimple<ParticleSimple<float>,
+                   MparticlesStorageSoA<ParticleSimple<float>>>::convert_from_;
+extern template const MparticlesSimple<
+  ParticleSimple<float>,
+  MparticlesStorageSoA<ParticleSimple<float>>>::Convert
+  MparticlesSimple<ParticleSimple<float>,
+                   MparticlesStorageSoA<ParticleSimple<float>>>::convert_from_;
+
+template <>
+const MparticlesSimple<
+  ParticleSimple<double>,
+  MparticlesStorageSoA<ParticleSimple<double>>>::Convert
+  MparticlesSimple<ParticleSimple<double>,
+                   MparticlesStorageSoA<ParticleSimple<double>>>::convert_to_;
+extern template const MparticlesSimple<
+  ParticleSimple<double>,
+  MparticlesStorageSoA<ParticleSimple<double>>>::Convert
+  MparticlesSimple<ParticleSimple<double>,
+                   MparticlesStorageSoA<ParticleSimple<double>>>::convert_to_;
+template <>
+const MparticlesSimple<
+  ParticleSimple<double>,
+  MparticlesStorageSoA<ParticleSimple<double>>>::Convert
+  MparticlesSimple<ParticleSimple<double>,
+                   MparticlesStorageSoA<ParticleSimple<double>>>::convert_from_;
+extern template const MparticlesSimple<
+  ParticleSimple<double>,
+  MparticlesStorageSoA<ParticleSimple<double>>>::Convert
+  MparticlesSimple<ParticleSimple<double>,
+                   MparticlesStorageSoA<ParticleSimple<double>>>::convert_from_;
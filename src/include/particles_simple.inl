@@ -53,13 +53,16 @@ public:
   template <typename FUNC>
   void operator()(const std::string& name, FUNC&& func)
   {
-    using Ret = typename std::remove_pointer<decltype(func(mprts_[0][0]))>::type;
+    using Particle = typename Mparticles::Particle;
+    using Ret = typename std::remove_pointer<decltype(
+      func(std::declval<Particle&>()))>::type;
     std::vector<Ret> vec(mprts_.size());
     auto it = vec.begin();
     for (int p = 0; p < mprts_.n_patches(); p++) {
       auto prts = mprts_[p];
       for (int n = 0; n < prts.size(); n++) {
-        *it++ = *func(prts[n]);
+        auto&& prt = prts[n];
+        *it++ = *func(prt);
       }
     }
 
@@ -83,7 +86,9 @@ public:
   template <typename FUNC>
   void operator()(const std::string& name, FUNC&& func)
   {
-    using Ret = typename std::remove_pointer<decltype(func(mprts_[0][0]))>::type;
+    using Particle = typename Mparticles::Particle;
+    using Ret = typename std::remove_pointer<decltype(
+      func(std::declval<Particle&>()))>::type;
     std::vector<Ret> vec(mprts_.size());
     reader_.get<VariableByParticle>(name, vec, mprts_.grid(),
                                     kg::io::Mode::Blocking);
@@ -91,7 +96,9 @@ public:
     for (int p = 0; p < mprts_.n_patches(); p++) {
       auto prts = mprts_[p];
       for (int n = 0; n < prts.size(); n++) {
-        *func(prts[n]) = *it++;
+        // with SoA storage, prt is a proxy that stores back on destruction
+        auto&& prt = prts[n];
+        *func(prt) = *it++;
       }
     }
   }
@@ -101,11 +108,11 @@ private:
   Mparticles& mprts_;
 };
 
-template <typename R>
-class kg::io::Descr<MparticlesSimple<R>>
+template <typename P, typename S>
+class kg::io::Descr<MparticlesSimple<P, S>>
 {
 public:
-  using Mparticles = MparticlesSimple<R>;
+  using Mparticles = MparticlesSimple<P, S>;
   using Particle = typename Mparticles::Particle;
 
   void put(kg::io::Engine& writer, const Mparticles& mprts,
@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include "PscConfig.h"
+
 #include <mrc_profile.h>
 #include <DiagEnergies.h>
 
@@ -11,6 +13,9 @@
 #include <checks.hxx>
 #include <output_particles.hxx>
 #include <push_particles.hxx>
+#include <reweight.hxx>
+#include <scratch_arena.hxx>
+#include <subcycling.hxx>
 
 #include "checkpoint.hxx"
 #ifdef USE_CUDA
@@ -22,6 +27,10 @@
 
 #include <fstream>
 
+#ifdef PSC_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 #ifdef VPIC
 #include "../libpsc/vpic/vpic_iface.h"
 #endif
@@ -82,6 +91,113 @@ struct mem_fraction<
   }
 };
 
+// particle boundary exchanges that can be split into begin() / end(), so
+// that other work can happen while the particles are in flight. Others just
+// do all their work in begin().
+
+template <typename BndParticles, typename Mparticles, typename Enable = void>
+struct bndp_split
+{
+  static void begin(BndParticles& bndp, Mparticles& mprts) { bndp(mprts); }
+  static void end(BndParticles& bndp, Mparticles& mprts) {}
+};
+
+template <typename BndParticles, typename Mparticles>
+struct bndp_split<BndParticles, Mparticles,
+                  gt::meta::void_t<decltype(std::declval<BndParticles>().begin(
+                    std::declval<Mparticles&>()))>>
+{
+  static void begin(BndParticles& bndp, Mparticles& mprts)
+  {
+    bndp.begin(mprts);
+  }
+  static void end(BndParticles& bndp, Mparticles& mprts) { bndp.end(mprts); }
+};
+
+// field pushes that can run on the interior while the ghost points of the
+// fields they depend on are still being filled. This needs both a Bnd with
+// fill_ghosts_begin() / fill_ghosts_end() and a PushFields that takes a
+// `wait` callback, otherwise it's just fill ghosts, then push.
+
+template <typename PushFields, typename Bnd, typename MfieldsState,
+          typename Enable = void>
+struct push_fields_overlap
+{
+  template <typename Dim>
+  static void push_E(PushFields& pushf, Bnd& bnd, MfieldsState& mflds,
+                     double dt_fac, Dim tag)
+  {
+    bnd.fill_ghosts(mflds, JXI, JXI + 3);
+    pushf.push_E(mflds, dt_fac, tag);
+  }
+
+  template <typename Dim>
+  static void push_H(PushFields& pushf, Bnd& bnd, MfieldsState& mflds,
+                     double dt_fac, Dim tag)
+  {
+    bnd.fill_ghosts(mflds, EX, EX + 3);
+    pushf.push_H(mflds, dt_fac, tag);
+  }
+};
+
+template <typename PushFields, typename Bnd, typename MfieldsState>
+struct push_fields_overlap<
+  PushFields, Bnd, MfieldsState,
+  gt::meta::void_t<decltype(std::declval<Bnd&>().fill_ghosts_begin(
+                     std::declval<MfieldsState&>(), 0, 0)),
+                   decltype(std::declval<PushFields&>().push_E(
+                     std::declval<MfieldsState&>(), 1., dim_xyz{},
+                     std::declval<void (*)()>()))>>
+{
+  template <typename Dim>
+  static void push_E(PushFields& pushf, Bnd& bnd, MfieldsState& mflds,
+                     double dt_fac, Dim tag)
+  {
+    bnd.fill_ghosts_begin(mflds, JXI, JXI + 3);
+    pushf.push_E(mflds, dt_fac, tag,
+                 [&]() { bnd.fill_ghosts_end(mflds, JXI, JXI + 3); });
+  }
+
+  template <typename Dim>
+  static void push_H(PushFields& pushf, Bnd& bnd, MfieldsState& mflds,
+                     double dt_fac, Dim tag)
+  {
+    bnd.fill_ghosts_begin(mflds, EX, EX + 3);
+    pushf.push_H(mflds, dt_fac, tag,
+                 [&]() { bnd.fill_ghosts_end(mflds, EX, EX + 3); });
+  }
+};
+
+// PushFields that update the ghost points along with the interior, as far
+// as the stencil reaches, say so with `pushes_ghosts`. Given deep enough
+// ghosts, that makes the exchanges in between the H-E-H pushes unnecessary.
+
+template <typename PushFields, typename Enable = void>
+struct pushes_ghosts : std::false_type
+{};
+
+template <typename PushFields>
+struct pushes_ghosts<PushFields,
+                     gt::meta::void_t<decltype(PushFields::pushes_ghosts)>>
+  : std::integral_constant<bool, PushFields::pushes_ghosts>
+{};
+
+// particle pushes that can push just some kinds, by a multiple of dt, can
+// be used for subcycling
+
+template <typename PushParticles, typename Mparticles, typename MfieldsState,
+          typename Enable = void>
+struct push_particles_subcycle : std::false_type
+{};
+
+template <typename PushParticles, typename Mparticles, typename MfieldsState>
+struct push_particles_subcycle<
+  PushParticles, Mparticles, MfieldsState,
+  gt::meta::void_t<decltype(std::declval<PushParticles&>().push_mprts(
+    std::declval<Mparticles&>(), std::declval<MfieldsState&>(), 0u, 1))>>
+  : std::true_type
+{};
+
 } // namespace detail
 
 template <typename Mparticles>
@@ -110,6 +226,19 @@ struct PscParams
 
   int sort_interval = 0;
   int marder_interval = 0;
+
+  int reweight_interval = 0; // merge / split particles every so many steps
+  ReweightParams reweight;
+
+  int n_threads = 1; // OpenMP threads per rank for patch-parallel loops
+                     // (particle push, particle bnd)
+
+  // per kind, push only every so many steps (default 1), see Subcycling
+  std::vector<int> subcycle;
+
+  // skip the ghost exchanges in between the field pushes where possible,
+  // see Psc::temporal_blocking()
+  bool temporal_blocking = false;
 };
 
 // ----------------------------------------------------------------------
@@ -140,6 +269,7 @@ struct Psc
   using Balance = typename PscConfig::Balance;
   using Sort = typename PscConfig::Sort;
   using Collision = typename PscConfig::Collision;
+  using Reweight = typename PscConfig::Reweight;
   using Checks = typename PscConfig::Checks;
   using Marder = typename PscConfig::Marder;
   using PushParticles = typename PscConfig::PushParticles;
@@ -171,6 +301,8 @@ struct Psc
       bndp_{grid},
       diagnostics_{diagnostics},
       inject_particles_{inject_particles},
+      reweight_{params.reweight},
+      subcycling_{grid, params.subcycle},
       checkpointing_{params.write_checkpoint_every_step}
   {
     time_start_ = MPI_Wtime();
@@ -179,10 +311,53 @@ struct Psc
     assert(grid.isInvar(1) == Dim::InvarY::value);
     assert(grid.isInvar(2) == Dim::InvarZ::value);
 
+    if (subcycling_.active() &&
+        !detail::push_particles_subcycle<PushParticles, Mparticles,
+                                         MfieldsState>::value) {
+      mpi_printf(grid.comm(), "ERROR: subcycling is not supported by this "
+                              "particle pusher.\n");
+      MPI_Abort(grid.comm(), 1);
+    }
+
+    // the Marder correction would take the charge density of the subcycled
+    // kinds, which are ahead of E, for an error in div E
+    if (subcycling_.active() && params.marder_interval > 0) {
+      mpi_printf(grid.comm(), "ERROR: the Marder correction doesn't work "
+                              "with subcycling.\n");
+      MPI_Abort(grid.comm(), 1);
+    }
+
+    if (subcycling_.active() && params.write_checkpoint_every_step > 0 &&
+        (params.write_checkpoint_every_step % subcycling_.period() != 0 ||
+         params.nmax % subcycling_.period() != 0)) {
+      mpi_printf(grid.comm(),
+                 "ERROR: with subcycling, write_checkpoint_every_step and "
+                 "nmax need to be multiples of %d.\n",
+                 subcycling_.period());
+      MPI_Abort(grid.comm(), 1);
+    }
+
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     log_.open("mem-" + std::to_string(rank) + ".log");
 
+#ifdef PSC_HAVE_OPENMP
+    omp_set_num_threads(params.n_threads);
+    mpi_printf(grid.comm(), "Using %d OpenMP thread(s) per rank.\n",
+               params.n_threads);
+#else
+    if (params.n_threads > 1) {
+      mpi_printf(grid.comm(),
+                 "WARNING: n_threads = %d, but built without OpenMP.\n",
+                 params.n_threads);
+    }
+#endif
+
+    if (params.temporal_blocking && !temporal_blocking()) {
+      mpi_printf(grid.comm(), "WARNING: temporal blocking needs a PushFields "
+                              "that pushes ghosts, and ibn >= 2.\n");
+    }
+
 #ifdef USE_CUDA
     mem_stats_csv_header(log_);
 #endif
@@ -198,12 +373,16 @@ struct Psc
   {
     st_nr_particles = psc_stats_register("nr particles");
     st_time_step = psc_stats_register("time entire step");
+    st_scratch_mb = psc_stats_register("scratch high water MB");
 
     // generic stats categories
     st_time_particle = psc_stats_register("time particle update");
     st_time_field = psc_stats_register("time field update");
     st_time_comm = psc_stats_register("time communication");
     st_time_output = psc_stats_register("time output");
+    if (subcycling_.active()) {
+      st_time_subcycle = psc_stats_register("time subcycled particle update");
+    }
 
     // FIXME not quite the right place
     pr_time_step_no_comm = prof_register("time step w/o comm", 1., 0, 0);
@@ -267,6 +446,8 @@ struct Psc
       //   pr_time_step_no_comm); // actual measurements are done w/ restart
 
       step();
+      balance_.update_cost(grid());
+      psc::ScratchArena::reset_all();
       grid_->timestep_++; // FIXME, too hacky
 #ifdef VPIC
       vgrid->step++;
@@ -279,6 +460,8 @@ struct Psc
       prof_stop(pr);
 
       psc_stats_val[st_nr_particles] = mprts_.size();
+      psc_stats_val[st_scratch_mb] =
+        psc::ScratchArena::high_water_all() / (1024. * 1024.);
 
       if (grid().timestep() % p_.stats_every == 0) {
         print_status();
@@ -290,7 +473,9 @@ struct Psc
         MPI_Allreduce(&wallclock_elapsed, &wallclock_elapsed_max, 1, MPI_DOUBLE,
                       MPI_MAX, MPI_COMM_WORLD);
 
-        if (wallclock_elapsed_max > p_.wallclock_limit) {
+        // with subcycling, stop (and checkpoint) where all cycles start over
+        if (wallclock_elapsed_max > p_.wallclock_limit &&
+            grid().timestep() % subcycling_.period() == 0) {
           mpi_printf(MPI_COMM_WORLD, "WARNING: Max wallclock time elapsed!\n");
           break;
         }
@@ -315,11 +500,12 @@ struct Psc
 
   void step_vpic()
   {
-    static int pr_sort, pr_collision, pr_checks, pr_push_prts, pr_push_flds,
-      pr_bndp, pr_bndf, pr_marder, pr_inject, pr_heating;
+    static int pr_sort, pr_collision, pr_reweight, pr_checks, pr_push_prts,
+      pr_push_flds, pr_bndp, pr_bndf, pr_marder, pr_inject, pr_heating;
     if (!pr_sort) {
       pr_sort = prof_register("step_sort", 1., 0, 0);
       pr_collision = prof_register("step_collision", 1., 0, 0);
+      pr_reweight = prof_register("step_reweight", 1., 0, 0);
       pr_push_prts = prof_register("step_push_prts", 1., 0, 0);
       pr_push_flds = prof_register("step_push_flds", 1., 0, 0);
       pr_bndp = prof_register("step_bnd_prts", 1., 0, 0);
@@ -358,6 +544,13 @@ struct Psc
       prof_stop(pr_collision);
     }
 
+    if (p_.reweight_interval > 0 && timestep % p_.reweight_interval == 0) {
+      mpi_printf(comm, "***** Reweighting...\n");
+      prof_start(pr_reweight);
+      reweight_(mprts_);
+      prof_stop(pr_reweight);
+    }
+
     // psc_bnd_particles_open_calc_moments(psc_->bnd_particles,
     // psc_->particles);
 
@@ -433,6 +626,66 @@ struct Psc
   }
 #endif
 
+  // ----------------------------------------------------------------------
+  // temporal_blocking
+  //
+  // Whether step_psc() skips the ghost exchanges in between the field
+  // pushes, which needs to be asked for with PscParams::temporal_blocking.
+  // The first B push covers [-2, ldims + 1), and so gets all the H
+  // that the E push needs for [-1, ldims + 1), which in turn is all the E
+  // that the second B push needs for the interior, provided that there are
+  // (at least) two layers of E ghosts that are valid at the start of the
+  // step (which they are, from the end of the previous step).
+
+  bool temporal_blocking()
+  {
+    if (!p_.temporal_blocking || !detail::pushes_ghosts<PushFields>::value) {
+      return false;
+    }
+    for (int d = 0; d < 3; d++) {
+      if (!grid().isInvar(d) && grid().ibn[d] < 2) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // ----------------------------------------------------------------------
+  // push_mprts_subcycled
+  //
+  // the subcycled kinds are timed separately, since that's where the
+  // savings show
+
+  void push_mprts_subcycled(int pr_push_prts, int pr_push_prts_sub)
+  {
+    using PushSubcycle =
+      detail::push_particles_subcycle<PushParticles, Mparticles, MfieldsState>;
+    push_mprts_subcycled(pr_push_prts, pr_push_prts_sub,
+                         std::integral_constant<bool, PushSubcycle::value>{});
+  }
+
+  void push_mprts_subcycled(int pr_push_prts, int pr_push_prts_sub,
+                            std::true_type)
+  {
+    subcycling_.push_mprts(pushp_, mprts_, mflds_);
+    prof_stop(pr_push_prts);
+
+    prof_start(pr_push_prts_sub);
+    psc_stats_start(st_time_subcycle);
+    subcycling_.push_subcycled(pushp_, mprts_, mflds_, grid().timestep());
+    psc_stats_stop(st_time_subcycle);
+    prof_stop(pr_push_prts_sub);
+
+    prof_restart(pr_push_prts);
+  }
+
+  void push_mprts_subcycled(int pr_push_prts, int pr_push_prts_sub,
+                            std::false_type)
+  {
+    // checked in the ctor
+    assert(0);
+  }
+
   // ----------------------------------------------------------------------
   // step_psc
 
@@ -440,12 +693,15 @@ struct Psc
   {
     using Dim = typename PscConfig::Dim;
 
-    static int pr_sort, pr_collision, pr_checks, pr_push_prts, pr_push_flds,
-      pr_bndp, pr_bndf, pr_marder, pr_inject_prts;
+    static int pr_sort, pr_collision, pr_reweight, pr_checks, pr_push_prts,
+      pr_push_prts_sub, pr_push_flds, pr_bndp, pr_bndf, pr_marder,
+      pr_inject_prts;
     if (!pr_sort) {
       pr_sort = prof_register("step_sort", 1., 0, 0);
       pr_collision = prof_register("step_collision", 1., 0, 0);
+      pr_reweight = prof_register("step_reweight", 1., 0, 0);
       pr_push_prts = prof_register("step_push_prts", 1., 0, 0);
+      pr_push_prts_sub = prof_register("step_push_prts_sub", 1., 0, 0);
       pr_inject_prts = prof_register("step_inject_prts", 1., 0, 0);
       pr_push_flds = prof_register("step_push_flds", 1., 0, 0);
       pr_bndp = prof_register("step_bnd_prts", 1., 0, 0);
@@ -482,6 +738,13 @@ struct Psc
       prof_stop(pr_collision);
     }
 
+    if (p_.reweight_interval > 0 && timestep % p_.reweight_interval == 0) {
+      mpi_printf(comm, "***** Reweighting...\n");
+      prof_start(pr_reweight);
+      reweight_(mprts_);
+      prof_stop(pr_reweight);
+    }
+
     // === particle injection
     prof_start(pr_inject_prts);
     inject_particles();
@@ -498,10 +761,22 @@ struct Psc
     // === particle propagation p^{n} -> p^{n+1}, x^{n+1/2} -> x^{n+3/2}
     mpi_printf(comm, "***** Pushing particles...\n");
     prof_start(pr_push_prts);
-    pushp_.push_mprts(mprts_, mflds_);
+    if (subcycling_.active()) {
+      push_mprts_subcycled(pr_push_prts, pr_push_prts_sub);
+    } else {
+      pushp_.push_mprts(mprts_, mflds_);
+    }
     prof_stop(pr_push_prts);
     // state is now: x^{n+3/2}, p^{n+1}, E^{n+1/2}, B^{n+1/2}, j^{n+1}
 
+    // the particle exchange is started here, but only completed after the B
+    // push and the H ghost fill, which don't need the particles
+    using BndpSplit = detail::bndp_split<BndParticles, Mparticles>;
+    mpi_printf(comm, "***** Bnd particles...\n");
+    prof_start(pr_bndp);
+    BndpSplit::begin(bndp_, mprts_);
+    prof_stop(pr_bndp);
+
     // === field propagation B^{n+1/2} -> B^{n+1}
     mpi_printf(comm, "***** Pushing B...\n");
     prof_start(pr_push_flds);
@@ -509,46 +784,63 @@ struct Psc
     prof_stop(pr_push_flds);
     // state is now: x^{n+3/2}, p^{n+1}, E^{n+1/2}, B^{n+1}, j^{n+1}
 
-    mpi_printf(comm, "***** Bnd particles...\n");
-    prof_start(pr_bndp);
-    bndp_(mprts_);
-    prof_stop(pr_bndp);
-
     // === field propagation E^{n+1/2} -> E^{n+3/2}
     mpi_printf(comm, "***** Push fields E\n");
+    // with temporal blocking, the B push above already got the H ghosts
+    // that the E push needs, and the E push gets the E ghosts that the next
+    // B push needs, so only J gets exchanged until the end of the step
+    bool temporal_blocking = this->temporal_blocking();
     prof_start(pr_bndf);
 #if 1
     bndf_.fill_ghosts_H(mflds_);
-    bnd_.fill_ghosts(mflds_, HX, HX + 3);
+    if (!temporal_blocking) {
+      bnd_.fill_ghosts(mflds_, HX, HX + 3);
+    }
 #endif
+    prof_stop(pr_bndf);
+
+    prof_restart(pr_bndp);
+    BndpSplit::end(bndp_, mprts_);
+    prof_stop(pr_bndp);
 
+    prof_restart(pr_bndf);
     bndf_.add_ghosts_J(mflds_);
     bnd_.add_ghosts(mflds_, JXI, JXI + 3);
-    bnd_.fill_ghosts(mflds_, JXI, JXI + 3);
     prof_stop(pr_bndf);
 
+    // the J / E ghost fills are done while the interior E / B is pushed
+    using PushFieldsOverlap =
+      detail::push_fields_overlap<PushFields, Bnd, MfieldsState>;
+
     prof_restart(pr_push_flds);
-    pushf_.push_E(mflds_, 1., Dim{});
+    PushFieldsOverlap::push_E(pushf_, bnd_, mflds_, 1., Dim{});
     prof_stop(pr_push_flds);
 
 #if 1
     prof_restart(pr_bndf);
     bndf_.fill_ghosts_E(mflds_);
-    bnd_.fill_ghosts(mflds_, EX, EX + 3);
     prof_stop(pr_bndf);
 #endif
-    // state is now: x^{n+3/2}, p^{n+1}, E^{n+3/2}, B^{n+1}
 
     // === field propagation B^{n+1} -> B^{n+3/2}
     mpi_printf(comm, "***** Push fields B\n");
     prof_restart(pr_push_flds);
-    pushf_.push_H(mflds_, .5, Dim{});
+    if (temporal_blocking) {
+      pushf_.push_H(mflds_, .5, Dim{});
+    } else {
+      PushFieldsOverlap::push_H(pushf_, bnd_, mflds_, .5, Dim{});
+    }
     prof_stop(pr_push_flds);
 
 #if 1
     prof_start(pr_bndf);
     bndf_.fill_ghosts_H(mflds_);
-    bnd_.fill_ghosts(mflds_, HX, HX + 3);
+    if (temporal_blocking) {
+      // E and H are contiguous, so that's a single exchange
+      bnd_.fill_ghosts(mflds_, EX, HX + 3);
+    } else {
+      bnd_.fill_ghosts(mflds_, HX, HX + 3);
+    }
     prof_stop(pr_bndf);
     // state is now: x^{n+3/2}, p^{n+1}, E^{n+3/2}, B^{n+3/2}
 #endif
@@ -726,6 +1018,8 @@ protected:
   InjectParticles& inject_particles_;
 
   Sort sort_;
+  Reweight reweight_;
+  Subcycling<MfieldsState> subcycling_;
   PushParticles pushp_;
   PushFields pushf_;
   Bnd bnd_;
@@ -742,6 +1036,8 @@ protected:
 
   int st_nr_particles;
   int st_time_step;
+  int st_scratch_mb;
+  int st_time_subcycle;
 };
 
 // ======================================================================
@@ -6,6 +6,8 @@
 #include <psc_bits.h>
 #include <psc/gtensor.h>
 
+#include <array>
+
 namespace psc
 {
 namespace deposit
@@ -61,6 +63,41 @@ public:
   {
     (*this)(flds, l, h, val, dim_t{});
   }
+
+  // deposit N values at once, into flds(i, j, k, m) for m in [0, N), so the
+  // weights only need to be computed once
+  template <typename F, std::size_t N>
+  void operator()(F& flds, const gt::sarray<int, 3>& l, const real3_t& h,
+                  const std::array<real_t, N>& vals)
+  {
+    const bool invar[3] = {dim_t::InvarX::value, dim_t::InvarY::value,
+                           dim_t::InvarZ::value};
+    int lo[3], n[3];
+    real_t g[3][2];
+    for (int d = 0; d < 3; d++) {
+      if (invar[d]) {
+        lo[d] = 0;
+        n[d] = 1;
+        g[d][0] = 1.f;
+      } else {
+        lo[d] = l[d];
+        n[d] = 2;
+        g[d][0] = 1.f - h[d];
+        g[d][1] = h[d];
+      }
+    }
+
+    for (int dz = 0; dz < n[2]; dz++) {
+      for (int dy = 0; dy < n[1]; dy++) {
+        for (int dx = 0; dx < n[0]; dx++) {
+          real_t w = g[0][dx] * g[1][dy] * g[2][dz];
+          for (std::size_t m = 0; m < N; m++) {
+            flds(lo[0] + dx, lo[1] + dy, lo[2] + dz, m) += w * vals[m];
+          }
+        }
+      }
+    }
+  }
 };
 
 // ---------------------------------------------------------------------------
@@ -166,9 +203,10 @@ class Deposit1stNc
 public:
   static std::string suffix() { return "_1st_nc"; }
 
-  template <typename F>
+  // val may also be a std::array<T, N> of values to deposit at once
+  template <typename F, typename V>
   void operator()(F& flds, const gt::sarray<int, 3>& ib,
-                  const gt::sarray<T, 3>& x, T val)
+                  const gt::sarray<T, 3>& x, const V& val)
 
   {
     gt::sarray<int, 3> l;
@@ -189,9 +227,10 @@ class Deposit1stCc
 public:
   static std::string suffix() { return "_1st_cc"; }
 
-  template <typename F>
+  // val may also be a std::array<T, N> of values to deposit at once
+  template <typename F, typename V>
   void operator()(F& flds, const gt::sarray<int, 3>& ib,
-                  const gt::sarray<T, 3>& x, T val)
+                  const gt::sarray<T, 3>& x, const V& val)
 
   {
     gt::sarray<int, 3> l;
@@ -283,6 +322,20 @@ public:
     deposit(flds, ib, x, value);
   }
 
+  // deposit several values at once (1st order only, for now)
+  template <typename F, std::size_t N>
+  void operator()(const F& flds, const gt::shape_type<3>& ib, const real3_t& xi,
+                  std::array<real_t, N> vals)
+  {
+    real3_t x = xi * dxi_;
+    for (auto& val : vals) {
+      val *= fnqs_;
+    }
+
+    DepositNorm<real_t, dim_t> deposit;
+    deposit(flds, ib, x, vals);
+  }
+
   real3_t dxi_;
   real_t fnqs_;
 };
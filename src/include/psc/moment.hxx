@@ -4,6 +4,9 @@
 #include "psc_bits.h"
 #include <psc/deposit.hxx>
 
+#include <array>
+#include <vector>
+
 namespace psc
 {
 namespace moment
@@ -98,6 +101,154 @@ void deposit_2nd_nc(MF& mflds_gt, const Int3& ib, const MP& mprts, F&& func)
                                                std::forward<F>(func));
 }
 
+// ===========================================================================
+// DepositTile
+//
+// Local accumulator for the 3x3x3 cells around (and including) one cell.
+// That's all that 1st order deposition from particles in that cell can
+// reach. Deposition goes into the tile while consecutive particles stay in
+// the same cell, and the tile is added to the fields only when they move
+// on to another cell. With cell-sorted particles, that is once per cell.
+
+template <typename R, typename D>
+class DepositTile
+{
+public:
+  using real_t = R;
+  using dim_t = D;
+  static const int W = 3;
+
+  DepositTile(int n_comps) : n_comps_{n_comps}, data_(W * W * W * n_comps) {}
+
+  // center the tile on cell idx, in field (i.e. ghost-shifted) coordinates
+  void reset(const Int3& idx)
+  {
+    const bool invar[3] = {dim_t::InvarX::value, dim_t::InvarY::value,
+                           dim_t::InvarZ::value};
+    for (int d = 0; d < 3; d++) {
+      lo_[d] = invar[d] ? 0 : idx[d] - 1;
+      n_[d] = invar[d] ? 1 : W;
+    }
+  }
+
+  real_t operator()(int i, int j, int k, int m) const
+  {
+    return data_[index(i, j, k, m)];
+  }
+
+  real_t& operator()(int i, int j, int k, int m)
+  {
+    return data_[index(i, j, k, m)];
+  }
+
+  // add components [mb, me) to flds(i, j, k, m), and zero them again
+  template <typename F>
+  void flush(F& flds, int mb, int me)
+  {
+    for (int m = mb; m < me; m++) {
+      for (int k = 0; k < n_[2]; k++) {
+        for (int j = 0; j < n_[1]; j++) {
+          for (int i = 0; i < n_[0]; i++) {
+            real_t& val = data_[((m * W + k) * W + j) * W + i];
+            flds(lo_[0] + i, lo_[1] + j, lo_[2] + k, m) += val;
+            val = 0;
+          }
+        }
+      }
+    }
+  }
+
+private:
+  int index(int i, int j, int k, int m) const
+  {
+    return ((m * W + (k - lo_[2])) * W + (j - lo_[1])) * W + (i - lo_[0]);
+  }
+
+  int n_comps_;
+  std::vector<real_t> data_;
+  Int3 lo_;
+  Int3 n_;
+};
+
+// ---------------------------------------------------------------------------
+// TileComps
+//
+// view of the tile that starts at component mb
+
+template <typename Tile>
+struct TileComps
+{
+  typename Tile::real_t& operator()(int i, int j, int k, int m) const
+  {
+    return tile(i, j, k, mb + m);
+  }
+
+  Tile& tile;
+  int mb;
+};
+
+// ===========================================================================
+// deposit_by_kind
+//
+// Fused deposition of N moments per particle into components
+// [N * kind, N * (kind + 1)). The shape function weights are computed once
+// per particle for all N of them, and the deposition goes through a
+// DepositTile. func(prt) returns the N values as a std::array.
+
+template <template <typename, typename> class DepositCode, typename D,
+          std::size_t N, typename MF, typename MP, typename F>
+void deposit_by_kind(MF& mflds_gt, const Int3& ib, const MP& mprts, F&& func)
+{
+  using real_t = typename MF::value_type;
+  using real3_t = gt::sarray<real_t, 3>;
+  using Deposit = DepositCode<real_t, D>;
+  using Tile = DepositTile<real_t, D>;
+
+  const auto& grid = mprts.grid();
+  const auto& domain = grid.domain;
+  real3_t dx = {domain.dx[0], domain.dx[1], domain.dx[2]};
+  Deposit deposit{dx, real_t(grid.norm.fnqs)};
+  int n_kinds = grid.kinds.size();
+
+  auto accessor = mprts.accessor();
+  for (int p = 0; p < mprts.n_patches(); p++) {
+    auto flds = mflds_gt.view(_all, _all, _all, _all, p);
+    Tile tile(N * n_kinds);
+    std::vector<bool> touched(n_kinds);
+    Int3 cur = {-1, -1, -1};
+    bool have_cur = false;
+
+    auto flush = [&]() {
+      for (int kind = 0; kind < n_kinds; kind++) {
+        if (touched[kind]) {
+          tile.flush(flds, N * kind, N * (kind + 1));
+          touched[kind] = false;
+        }
+      }
+    };
+
+    for (auto prt : accessor[p]) {
+      real3_t x = prt.x();
+      Int3 idx;
+      for (int d = 0; d < 3; d++) {
+        idx[d] = fint(x[d] * deposit.dxi_[d]) - ib[d];
+      }
+      if (!have_cur || idx != cur) {
+        flush();
+        tile.reset(idx);
+        cur = idx;
+        have_cur = true;
+      }
+
+      int kind = prt.kind();
+      touched[kind] = true;
+      TileComps<Tile> comps{tile, int(N) * kind};
+      deposit(comps, ib, x, func(prt));
+    }
+    flush();
+  }
+}
+
 // ===========================================================================
 // FIXME _particle_calc_vxi
 
@@ -130,11 +281,10 @@ public:
   template <typename MFLDS_GT, typename MP>
   void operator()(MFLDS_GT& mflds_gt, const Int3& ib, const MP& mprts)
   {
-    deposit<DepositCode, dim_t>(mflds_gt, ib, mprts,
-                                [&](auto& deposit_one, const auto& prt) {
-                                  int m = prt.kind();
-                                  deposit_one(m, prt.w());
-                                });
+    using real_t = typename MFLDS_GT::value_type;
+    deposit_by_kind<DepositCode, dim_t, 1>(
+      mflds_gt, ib, mprts,
+      [&](const auto& prt) { return std::array<real_t, 1>{real_t(prt.w())}; });
   }
 };
 
@@ -181,14 +331,16 @@ public:
   template <typename MFLDS_GT, typename MP>
   void operator()(MFLDS_GT& mflds_gt, const Int3& ib, const MP& mprts)
   {
-    using real_t = typename MP::real_t;
-    deposit<DepositCode, dim_t>(
-      mflds_gt, ib, mprts, [&](auto& deposit_one, const auto& prt) {
-        real_t vxi[3];
+    using real_t = typename MFLDS_GT::value_type;
+    deposit_by_kind<DepositCode, dim_t, 3>(
+      mflds_gt, ib, mprts, [&](const auto& prt) {
+        typename MP::real_t vxi[3];
         _particle_calc_vxi(prt, vxi);
+        std::array<real_t, 3> vals;
         for (int m = 0; m < 3; m++) {
-          deposit_one(m + 3 * prt.kind(), prt.w() * vxi[m]);
+          vals[m] = prt.w() * vxi[m];
         }
+        return vals;
       });
   }
 };
@@ -211,11 +363,14 @@ public:
   template <typename MFLDS_GT, typename MP>
   void operator()(MFLDS_GT& mflds_gt, const Int3& ib, const MP& mprts)
   {
-    deposit<DepositCode, dim_t>(
-      mflds_gt, ib, mprts, [&](auto& deposit_one, const auto& prt) {
+    using real_t = typename MFLDS_GT::value_type;
+    deposit_by_kind<DepositCode, dim_t, 3>(
+      mflds_gt, ib, mprts, [&](const auto& prt) {
+        std::array<real_t, 3> vals;
         for (int m = 0; m < 3; m++) {
-          deposit_one(m + 3 * prt.kind(), prt.w() * prt.m() * prt.u()[m]);
+          vals[m] = prt.w() * prt.m() * prt.u()[m];
         }
+        return vals;
       });
   }
 };
@@ -238,18 +393,17 @@ public:
   template <typename MFLDS_GT, typename MP>
   void operator()(MFLDS_GT& mflds_gt, const Int3& ib, const MP& mprts)
   {
-    using real_t = typename MP::real_t;
-    deposit<DepositCode, dim_t>(mflds_gt, ib, mprts, [&](const auto& prt) {
-      int mm = prt.kind() * 6;
-      real_t vxi[3];
-      _particle_calc_vxi(prt, vxi);
-      deposit_one(mm + 0, prt.w() * prt.m() * prt.u()[0] * vxi[0]);
-      deposit_one(mm + 1, prt.w() * prt.m() * prt.u()[1] * vxi[1]);
-      deposit_one(mm + 2, prt.w() * prt.m() * prt.u()[2] * vxi[2]);
-      deposit_one(mm + 3, prt.w() * prt.m() * prt.u()[0] * vxi[1]);
-      deposit_one(mm + 4, prt.w() * prt.m() * prt.u()[0] * vxi[2]);
-      deposit_one(mm + 5, prt.w() * prt.m() * prt.u()[1] * vxi[2]);
-    });
+    using real_t = typename MFLDS_GT::value_type;
+    deposit_by_kind<DepositCode, dim_t, 6>(
+      mflds_gt, ib, mprts, [&](const auto& prt) {
+        typename MP::real_t vxi[3];
+        _particle_calc_vxi(prt, vxi);
+        real_t wm = prt.w() * prt.m();
+        return std::array<real_t, 6>{
+          wm * prt.u()[0] * vxi[0], wm * prt.u()[1] * vxi[1],
+          wm * prt.u()[2] * vxi[2], wm * prt.u()[0] * vxi[1],
+          wm * prt.u()[0] * vxi[2], wm * prt.u()[1] * vxi[2]};
+      });
   }
 }; // namespace moment
 
@@ -273,25 +427,26 @@ public:
   template <typename MFLDS_GT, typename MP>
   void operator()(MFLDS_GT& mflds_gt, const Int3& ib, const MP& mprts)
   {
-    using real_t = typename MP::real_t;
-    deposit<DepositCode, dim_t>(
-      mflds_gt, ib, mprts, [&](auto& deposit_one, const auto& prt) {
-        int mm = prt.kind() * 13;
-        real_t vxi[3];
+    using real_t = typename MFLDS_GT::value_type;
+    deposit_by_kind<DepositCode, dim_t, 13>(
+      mflds_gt, ib, mprts, [&](const auto& prt) {
+        typename MP::real_t vxi[3];
         _particle_calc_vxi(prt, vxi);
-        deposit_one(mm + 0, prt.w() * prt.q());
-        deposit_one(mm + 1, prt.w() * prt.q() * vxi[0]);
-        deposit_one(mm + 2, prt.w() * prt.q() * vxi[1]);
-        deposit_one(mm + 3, prt.w() * prt.q() * vxi[2]);
-        deposit_one(mm + 4, prt.w() * prt.m() * prt.u()[0]);
-        deposit_one(mm + 5, prt.w() * prt.m() * prt.u()[1]);
-        deposit_one(mm + 6, prt.w() * prt.m() * prt.u()[2]);
-        deposit_one(mm + 7, prt.w() * prt.m() * prt.u()[0] * vxi[0]);
-        deposit_one(mm + 8, prt.w() * prt.m() * prt.u()[1] * vxi[1]);
-        deposit_one(mm + 9, prt.w() * prt.m() * prt.u()[2] * vxi[2]);
-        deposit_one(mm + 10, prt.w() * prt.m() * prt.u()[0] * vxi[1]);
-        deposit_one(mm + 11, prt.w() * prt.m() * prt.u()[1] * vxi[2]);
-        deposit_one(mm + 12, prt.w() * prt.m() * prt.u()[2] * vxi[0]);
+        real_t wq = prt.w() * prt.q();
+        real_t wm = prt.w() * prt.m();
+        return std::array<real_t, 13>{wq,
+                                      wq * vxi[0],
+                                      wq * vxi[1],
+                                      wq * vxi[2],
+                                      wm * prt.u()[0],
+                                      wm * prt.u()[1],
+                                      wm * prt.u()[2],
+                                      wm * prt.u()[0] * vxi[0],
+                                      wm * prt.u()[1] * vxi[1],
+                                      wm * prt.u()[2] * vxi[2],
+                                      wm * prt.u()[0] * vxi[1],
+                                      wm * prt.u()[1] * vxi[2],
+                                      wm * prt.u()[2] * vxi[0]};
       });
   }
 };
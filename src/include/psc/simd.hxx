@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cmath>
+
+// ======================================================================
+// portable SIMD packs
+//
+// psc::simd::pack<T, N> is a fixed-width bundle of N lanes with the usual
+// elementwise arithmetic. Every operation is a plain loop over the lanes,
+// which gcc / clang / icx turn into the native vector instructions of
+// whatever -march we're built for (SSE2, AVX2, AVX-512), so there are no
+// intrinsics to maintain. Since the operators are overloaded, scalar code
+// written against a generic real_t (e.g., AdvanceParticle) can be
+// instantiated with a pack to push N particles at once.
+
+#if defined(__AVX512F__)
+#define PSC_SIMD_BYTES 64
+#elif defined(__AVX__)
+#define PSC_SIMD_BYTES 32
+#else
+#define PSC_SIMD_BYTES 16
+#endif
+
+#if defined(_OPENMP)
+#define PSC_PRAGMA_SIMD _Pragma("omp simd")
+#else
+#define PSC_PRAGMA_SIMD
+#endif
+
+namespace psc
+{
+namespace simd
+{
+
+template <typename T, int N>
+struct alignas(sizeof(T) * N) pack
+{
+  using value_type = T;
+
+  static constexpr int size() { return N; }
+
+  pack() = default;
+
+  pack(T s)
+  {
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      v[l] = s;
+    }
+  }
+
+  T& operator[](int l) { return v[l]; }
+  const T& operator[](int l) const { return v[l]; }
+
+  // ----------------------------------------------------------------------
+  // unaligned load / store of N consecutive values
+
+  static pack load(const T* p)
+  {
+    pack res;
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      res.v[l] = p[l];
+    }
+    return res;
+  }
+
+  void store(T* p) const
+  {
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      p[l] = v[l];
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // arithmetic
+
+  pack operator-() const
+  {
+    pack res;
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      res.v[l] = -v[l];
+    }
+    return res;
+  }
+
+  pack& operator+=(const pack& w)
+  {
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      v[l] += w.v[l];
+    }
+    return *this;
+  }
+
+  pack& operator-=(const pack& w)
+  {
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      v[l] -= w.v[l];
+    }
+    return *this;
+  }
+
+  pack& operator*=(const pack& w)
+  {
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      v[l] *= w.v[l];
+    }
+    return *this;
+  }
+
+  pack& operator/=(const pack& w)
+  {
+    PSC_PRAGMA_SIMD
+    for (int l = 0; l < N; l++) {
+      v[l] /= w.v[l];
+    }
+    return *this;
+  }
+
+  // non-template friends, so that scalars on either side get converted,
+  // e.g. `1.f + sqr(u)`
+
+  friend pack operator+(pack a, const pack& b) { return a += b; }
+  friend pack operator-(pack a, const pack& b) { return a -= b; }
+  friend pack operator*(pack a, const pack& b) { return a *= b; }
+  friend pack operator/(pack a, const pack& b) { return a /= b; }
+
+  T v[N];
+};
+
+template <typename T, int N>
+inline pack<T, N> sqrt(const pack<T, N>& a)
+{
+  pack<T, N> res;
+  PSC_PRAGMA_SIMD
+  for (int l = 0; l < N; l++) {
+    res.v[l] = std::sqrt(a.v[l]);
+  }
+  return res;
+}
+
+// more specialized than the generic ::rsqrt(T) in cuda_compat.h, so it's
+// the one that gets picked up through ADL
+
+template <typename T, int N>
+inline pack<T, N> rsqrt(const pack<T, N>& a)
+{
+  return pack<T, N>(T(1.)) / sqrt(a);
+}
+
+// ----------------------------------------------------------------------
+// native
+//
+// pack filling one vector register of the target architecture, i.e.,
+// 16 floats with AVX-512, 8 with AVX2
+
+template <typename T>
+using native = pack<T, PSC_SIMD_BYTES / sizeof(T)>;
+
+} // namespace simd
+} // namespace psc
@@ -64,6 +64,8 @@ struct MfieldsCuda
     return gt::adapt_device(storage_.data().get(), storage_.shape());
   }
 
+  std::size_t element_size() const override { return sizeof(real_t); }
+
   static const Convert convert_to_, convert_from_;
   const Convert& convert_to() override { return convert_to_; }
   const Convert& convert_from() override { return convert_from_; }
@@ -145,6 +147,9 @@ struct MfieldsStateCuda : MfieldsStateBase
   auto& storage() { return mflds_.storage(); }
   auto& storage() const { return mflds_.storage(); }
 
+  std::size_t element_size() const override { return sizeof(real_t); }
+  const MfieldsBase* mfields_base() const override { return &mflds_; }
+
 private:
   MfieldsCuda mflds_;
 };
@@ -5,5 +5,8 @@
 #include "particles_simple.hxx"
 
 using MparticlesDouble = MparticlesSimple<ParticleSimple<double>>;
+using MparticlesDoubleSoA =
+  MparticlesSimple<ParticleSimple<double>,
+                   MparticlesStorageSoA<ParticleSimple<double>>>;
 
 #endif
@@ -5,5 +5,8 @@
 #include "particles_simple.hxx"
 
 using MparticlesSingle = MparticlesSimple<ParticleSimple<float>>;
+using MparticlesSingleSoA =
+  MparticlesSimple<ParticleSimple<float>,
+                   MparticlesStorageSoA<ParticleSimple<float>>>;
 
 #endif
@@ -6,127 +6,210 @@
 #include "fields_traits.hxx"
 
 #include "push_fields.hxx"
-#include "psc.h" // FIXME, for foreach_3d macro
+#include "psc.h"
+#include <psc/simd.hxx>
 
-// ----------------------------------------------------------------------
-// Foreach_3d
+#include <algorithm>
 
-template <class F>
-static void Foreach_3d(const Grid_t& grid, F f, int l, int r)
-{
-  grid.Foreach_3d(l, r, [&](int i, int j, int k) {
-    f.x(i, j, k);
-    f.y(i, j, k);
-    f.z(i, j, k);
-  });
-}
-
-// ----------------------------------------------------------------------
+// ======================================================================
+// PushFieldsPatch
+//
+// Updates E or H of one patch over a box of cells, all three components
+// together. The box is visited in rows along the first non-invariant
+// direction, which is contiguous in memory, so the inner loop is a plain
+// strided stencil that vectorizes. Rows are grouped into tiles of
+// `tile_rows` rows in the 2nd direction, each of which is swept through the
+// 3rd direction in turn, so the neighboring rows the stencil reads again
+// are still in cache. Which directions are invariant is given by `Dim`.
 
-template <typename Fields>
-class PushBase
+template <typename MfieldsState, typename Dim>
+class PushFieldsPatch
 {
 public:
-  using real_t = typename Fields::value_type;
-  using fields_t = typename Fields::fields_t;
-  using dim = typename Fields::dim;
+  using real_t = typename MfieldsState::real_t;
+
+  static const int tile_rows = 16;
 
-  PushBase(const Grid_t& grid, double dt_fac)
+  PushFieldsPatch(MfieldsState& mflds, int p, double dt_fac)
   {
-    dth = dt_fac * grid.dt;
+    const Grid_t& grid = mflds.grid();
+    auto& storage = mflds.storage();
+    Int3 ib = mflds.ib();
+
+    // invariant directions get stride 0, so the (vanishing) derivatives
+    // there don't step out of the patch
+    int stride = 1;
+    for (int d = 0; d < 3; d++) {
+      assert(grid.isInvar(d) == invar(d));
+      assert(!invar(d) || storage.shape(d) == 1);
+      stride_[d] = invar(d) ? 0 : stride;
+      stride *= storage.shape(d);
+    }
+    stride_m_ = stride;
+    base_ = &storage(0, 0, 0, 0, p) -
+            (ib[0] * stride_[0] + ib[1] * stride_[1] + ib[2] * stride_[2]);
 
-    // FIXME, it'd be even better to not even calculate derivates
-    // that will be multiplied by 0
-    cnx = dim::InvarX::value ? 0 : dth / grid.domain.dx[0];
-    cny = dim::InvarY::value ? 0 : dth / grid.domain.dx[1];
-    cnz = dim::InvarZ::value ? 0 : dth / grid.domain.dx[2];
+    dth_ = dt_fac * grid.dt;
+    for (int d = 0; d < 3; d++) {
+      cn_[d] = invar(d) ? 0 : dth_ / grid.domain.dx[d];
+    }
+
+    d0_ = 0;
+    while (d0_ < 2 && invar(d0_)) {
+      d0_++;
+    }
+    d1_ = d0_ == 0 ? 1 : 0;
+    d2_ = 3 - d0_ - d1_;
   }
 
-protected:
-  real_t dth;
-  real_t cnx, cny, cnz;
-};
+  // ----------------------------------------------------------------------
+  // push_E
+  //
+  // E += dt (curl H - J) on cells [lo, hi)
 
-template <typename Fields>
-class PushE : PushBase<Fields>
-{
-public:
-  using Base = PushBase<Fields>;
-  using typename Base::fields_t;
-  using typename Base::real_t;
+  void push_E(const Int3& lo, const Int3& hi)
+  {
+    const int sx = stride_[0], sy = stride_[1], sz = stride_[2];
+    const real_t cnx = cn_[0], cny = cn_[1], cnz = cn_[2], dth = dth_;
 
-  template <typename FF>
-  PushE(const Grid_t& grid, FF&& flds, double dt_fac)
-    : Base(grid, dt_fac), F(flds.storage(), flds.ib())
-  {}
+    foreach_row(lo, hi, [&](real_t* f, int n) {
+      real_t* __restrict__ ex = f + EX * stride_m_;
+      real_t* __restrict__ ey = f + EY * stride_m_;
+      real_t* __restrict__ ez = f + EZ * stride_m_;
+      const real_t* __restrict__ hx = f + HX * stride_m_;
+      const real_t* __restrict__ hy = f + HY * stride_m_;
+      const real_t* __restrict__ hz = f + HZ * stride_m_;
+      const real_t* __restrict__ jx = f + JXI * stride_m_;
+      const real_t* __restrict__ jy = f + JYI * stride_m_;
+      const real_t* __restrict__ jz = f + JZI * stride_m_;
 
-  void x(int i, int j, int k)
+      PSC_PRAGMA_SIMD
+      for (int i = 0; i < n; i++) {
+        ex[i] += cny * (hz[i] - hz[i - sy]) - cnz * (hy[i] - hy[i - sz]) -
+                 dth * jx[i];
+        ey[i] += cnz * (hx[i] - hx[i - sz]) - cnx * (hz[i] - hz[i - sx]) -
+                 dth * jy[i];
+        ez[i] += cnx * (hy[i] - hy[i - sx]) - cny * (hx[i] - hx[i - sy]) -
+                 dth * jz[i];
+      }
+    });
+  }
+
+  // ----------------------------------------------------------------------
+  // push_H
+  //
+  // H -= dt curl E on cells [lo, hi)
+
+  void push_H(const Int3& lo, const Int3& hi)
   {
-    F(EX, i, j, k) +=
-      (cny * (F(HZ, i, j, k) - F(HZ, i, j - 1, k)) -
-       cnz * (F(HY, i, j, k) - F(HY, i, j, k - 1)) - dth * F(JXI, i, j, k));
+    const int sx = stride_[0], sy = stride_[1], sz = stride_[2];
+    const real_t cnx = cn_[0], cny = cn_[1], cnz = cn_[2];
+
+    foreach_row(lo, hi, [&](real_t* f, int n) {
+      const real_t* __restrict__ ex = f + EX * stride_m_;
+      const real_t* __restrict__ ey = f + EY * stride_m_;
+      const real_t* __restrict__ ez = f + EZ * stride_m_;
+      real_t* __restrict__ hx = f + HX * stride_m_;
+      real_t* __restrict__ hy = f + HY * stride_m_;
+      real_t* __restrict__ hz = f + HZ * stride_m_;
+
+      PSC_PRAGMA_SIMD
+      for (int i = 0; i < n; i++) {
+        hx[i] -= cny * (ez[i + sy] - ez[i]) - cnz * (ey[i + sz] - ey[i]);
+        hy[i] -= cnz * (ex[i + sz] - ex[i]) - cnx * (ez[i + sx] - ez[i]);
+        hz[i] -= cnx * (ey[i + sx] - ey[i]) - cny * (ex[i + sy] - ex[i]);
+      }
+    });
   }
 
-  void y(int i, int j, int k)
+private:
+  static bool invar(int d)
   {
-    F(EY, i, j, k) +=
-      (cnz * (F(HX, i, j, k) - F(HX, i, j, k - 1)) -
-       cnx * (F(HZ, i, j, k) - F(HZ, i - 1, j, k)) - dth * F(JYI, i, j, k));
+    return d == 0   ? Dim::InvarX::value
+           : d == 1 ? Dim::InvarY::value
+                    : Dim::InvarZ::value;
   }
 
-  void z(int i, int j, int k)
+  template <typename F>
+  void foreach_row(const Int3& lo, const Int3& hi, F&& row)
   {
-    F(EZ, i, j, k) +=
-      (cnx * (F(HY, i, j, k) - F(HY, i - 1, j, k)) -
-       cny * (F(HX, i, j, k) - F(HX, i, j - 1, k)) - dth * F(JZI, i, j, k));
+    int n = hi[d0_] - lo[d0_];
+    if (n <= 0) {
+      return;
+    }
+
+    for (int tb = lo[d1_]; tb < hi[d1_]; tb += tile_rows) {
+      int te = std::min(tb + tile_rows, hi[d1_]);
+      for (int c = lo[d2_]; c < hi[d2_]; c++) {
+        for (int b = tb; b < te; b++) {
+          Int3 idx;
+          idx[d0_] = lo[d0_];
+          idx[d1_] = b;
+          idx[d2_] = c;
+          row(base_ + idx[0] * stride_[0] + idx[1] * stride_[1] +
+                idx[2] * stride_[2],
+              n);
+        }
+      }
+    }
   }
 
-protected:
-  Fields F;
-  using Base::cnx;
-  using Base::cny;
-  using Base::cnz;
-  using Base::dth;
+  real_t* base_; // points to cell (0, 0, 0), component 0
+  Int3 stride_;
+  int stride_m_;
+  real_t dth_;
+  Vec3<real_t> cn_;
+  int d0_, d1_, d2_; // row direction first
 };
 
-template <typename Fields>
-class PushH : PushBase<Fields>
-{
-public:
-  using Base = PushBase<Fields>;
-  using typename Base::fields_t;
-  using typename Base::real_t;
-
-  template <typename FF>
-  PushH(const Grid_t& grid, FF&& flds, double dt_fac)
-    : Base(grid, dt_fac), F(flds.storage(), flds.ib())
-  {}
+// ----------------------------------------------------------------------
+// push_box / push_boxes_interior / push_boxes_shell
+//
+// The cells [-l, ldims + r) (invariant directions: just 0) that a push
+// covers, and their split into the interior [0, ldims - ri) and the shell
+// around it, as a few boxes.
 
-  void x(int i, int j, int k)
-  {
-    F(HX, i, j, k) -= (cny * (F(EZ, i, j + 1, k) - F(EZ, i, j, k)) -
-                       cnz * (F(EY, i, j, k + 1) - F(EY, i, j, k)));
+inline void push_box(const Grid_t& grid, int l, int r, Int3& lo, Int3& hi)
+{
+  for (int d = 0; d < 3; d++) {
+    bool invar = grid.isInvar(d);
+    lo[d] = invar ? 0 : -l;
+    hi[d] = invar ? 1 : grid.ldims[d] + r;
   }
+}
 
-  void y(int i, int j, int k)
-  {
-    F(HY, i, j, k) -= (cnz * (F(EX, i, j, k + 1) - F(EX, i, j, k)) -
-                       cnx * (F(EZ, i + 1, j, k) - F(EZ, i, j, k)));
+inline void push_box_interior(const Grid_t& grid, int ri, Int3& lo, Int3& hi)
+{
+  for (int d = 0; d < 3; d++) {
+    lo[d] = 0;
+    hi[d] = grid.isInvar(d) ? 1 : grid.ldims[d] - ri;
   }
+}
 
-  void z(int i, int j, int k)
-  {
-    F(HZ, i, j, k) -= (cnx * (F(EY, i + 1, j, k) - F(EY, i, j, k)) -
-                       cny * (F(EX, i, j + 1, k) - F(EX, i, j, k)));
-  }
+template <typename F>
+void push_boxes_shell(const Grid_t& grid, int l, int r, int ri, F&& f)
+{
+  Int3 lo, hi, ilo, ihi;
+  push_box(grid, l, r, lo, hi);
+  push_box_interior(grid, ri, ilo, ihi);
 
-protected:
-  Fields F;
-  using Base::cnx;
-  using Base::cny;
-  using Base::cnz;
-  using Base::dth;
-};
+  // peel off the slabs below and above the interior, one direction at a
+  // time
+  for (int d = 2; d >= 0; d--) {
+    Int3 blo = lo, bhi = hi;
+    bhi[d] = ilo[d];
+    if (bhi[d] > blo[d]) {
+      f(blo, bhi);
+    }
+    blo = lo, bhi = hi;
+    blo[d] = ihi[d];
+    if (bhi[d] > blo[d]) {
+      f(blo, bhi);
+    }
+    lo[d] = ilo[d];
+    hi[d] = ihi[d];
+  }
+}
 
 // ======================================================================
 // class PushFields
@@ -137,6 +220,10 @@ class PushFields : public PushFieldsBase
   using MfieldsState = _MfieldsState;
 
 public:
+  // push_E() / push_H() update the ghost points, too, as far as the stencil
+  // allows, see Psc::temporal_blocking()
+  static const bool pushes_ghosts = true;
+
   // ----------------------------------------------------------------------
   // push_E
   //
@@ -149,11 +236,36 @@ public:
   template <typename dim>
   void push_E(MfieldsState& mflds, double dt_fac, dim tag)
   {
-    using Fields = Fields3d<typename MfieldsState::fields_view_t::Storage, dim>;
+    Int3 lo, hi;
+    push_box(mflds.grid(), 1, 2, lo, hi);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      PushFieldsPatch<MfieldsState, dim>(mflds, p, dt_fac).push_E(lo, hi);
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // push_E, overlapped
+  //
+  // same as above, but first only updates the interior cells, which only
+  // depend on interior J, then calls `wait` (which is expected to complete
+  // the J ghost fill that's been started), and then does the rest. The H
+  // ghosts need to be up-to-date already.
 
+  template <typename dim, typename F>
+  void push_E(MfieldsState& mflds, double dt_fac, dim tag, F&& wait)
+  {
+    const Grid_t& grid = mflds.grid();
+    Int3 ilo, ihi;
+    push_box_interior(grid, 0, ilo, ihi);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      PushFieldsPatch<MfieldsState, dim>(mflds, p, dt_fac).push_E(ilo, ihi);
+    }
+    wait();
     for (int p = 0; p < mflds.n_patches(); p++) {
-      PushE<Fields> push_E(mflds.grid(), mflds[p], dt_fac);
-      Foreach_3d(mflds.grid(), push_E, 1, 2);
+      PushFieldsPatch<MfieldsState, dim> push(mflds, p, dt_fac);
+      push_boxes_shell(grid, 1, 2, 0, [&](const Int3& lo, const Int3& hi) {
+        push.push_E(lo, hi);
+      });
     }
   }
 
@@ -168,11 +280,35 @@ public:
   template <typename dim>
   void push_H(MfieldsState& mflds, double dt_fac, dim tag)
   {
-    using Fields = Fields3d<typename MfieldsState::fields_view_t::Storage, dim>;
+    Int3 lo, hi;
+    push_box(mflds.grid(), 2, 1, lo, hi);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      PushFieldsPatch<MfieldsState, dim>(mflds, p, dt_fac).push_H(lo, hi);
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // push_H, overlapped
+  //
+  // same as above, but the E ghosts don't need to be filled until `wait`
+  // returns. The interior excludes the last layer of cells, since those
+  // use E at i + 1.
 
+  template <typename dim, typename F>
+  void push_H(MfieldsState& mflds, double dt_fac, dim tag, F&& wait)
+  {
+    const Grid_t& grid = mflds.grid();
+    Int3 ilo, ihi;
+    push_box_interior(grid, 1, ilo, ihi);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      PushFieldsPatch<MfieldsState, dim>(mflds, p, dt_fac).push_H(ilo, ihi);
+    }
+    wait();
     for (int p = 0; p < mflds.n_patches(); p++) {
-      PushH<Fields> push_H(mflds.grid(), mflds[p], dt_fac);
-      Foreach_3d(mflds.grid(), push_H, 2, 1);
+      PushFieldsPatch<MfieldsState, dim> push(mflds, p, dt_fac);
+      push_boxes_shell(grid, 2, 1, 1, [&](const Int3& lo, const Int3& hi) {
+        push.push_H(lo, hi);
+      });
     }
   }
 };
@@ -11,3 +11,46 @@ extern int pr_time_step_no_comm; // FIXME
 
 class PushParticlesBase
 {};
+
+// ======================================================================
+// PushRange
+//
+// The particles [begin, end) of a patch that a pusher goes through. If
+// they're all of one kind (kind >= 0), per-kind constants can be taken out
+// of the loop; otherwise, only the particles of kinds in kind_mask are
+// pushed.
+
+struct PushRange
+{
+  unsigned int begin;
+  unsigned int end;
+  int kind;
+  unsigned int kind_mask;
+
+  bool pushes(int prt_kind) const
+  {
+    return kind >= 0 || ((kind_mask >> prt_kind) & 1);
+  }
+};
+
+// ----------------------------------------------------------------------
+// for_each_push_range
+//
+// one PushRange per kind in kind_mask, if the particles in patch p are
+// grouped by kind, otherwise one for the whole patch
+
+template <typename Mparticles, typename F>
+void for_each_push_range(const Mparticles& mprts, int p,
+                         unsigned int kind_mask, F&& f)
+{
+  const auto& offsets = mprts.kind_offsets(p);
+  if (offsets.empty()) {
+    f(PushRange{0, mprts[p].size(), -1, kind_mask});
+    return;
+  }
+  for (int k = 0; k + 1 < int(offsets.size()); k++) {
+    if (((kind_mask >> k) & 1) && offsets[k] < offsets[k + 1]) {
+      f(PushRange{offsets[k], offsets[k + 1], k, 1u << k});
+    }
+  }
+}
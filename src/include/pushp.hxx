@@ -11,6 +11,8 @@ struct AdvanceParticle
 
   __host__ __device__ AdvanceParticle(real_t dt) : dt_(dt) {}
 
+  __host__ __device__ real_t dt() const { return dt_; }
+
   // ----------------------------------------------------------------------
   // push_x
 
@@ -0,0 +1,28 @@
+
+#pragma once
+
+// ======================================================================
+// ReweightParams
+//
+// target range for the number of macro-particles per cell and kind;
+// 0 turns the respective bound off
+
+struct ReweightParams
+{
+  int n_min = 0; // split particles in cells with fewer than this
+  int n_max = 0; // merge particles in cells with more than this (>= 2)
+};
+
+// ======================================================================
+// ReweightNone
+//
+// for particle types that don't support reweighting
+
+struct ReweightNone
+{
+  ReweightNone(const ReweightParams& params = {}) {}
+
+  template <typename Mparticles>
+  void operator()(Mparticles& mprts)
+  {}
+};
@@ -0,0 +1,118 @@
+
+#pragma once
+
+#include "cuda_compat.h"
+
+#include <cmath>
+#include <cstdint>
+
+// ======================================================================
+// Philox4x32
+//
+// Philox-4x32-10 counter-based random number generator (Salmon et al.,
+// "Parallel random numbers: as easy as 1, 2, 3", SC'11). It maps a 128-bit
+// counter and a 64-bit key to 128 random bits, without any state, so
+// independent streams can be had just by picking distinct counters / keys.
+
+struct Philox4x32
+{
+  struct ctr_type
+  {
+    uint32_t v[4];
+  };
+
+  struct key_type
+  {
+    uint32_t v[2];
+  };
+
+  __host__ __device__ static ctr_type apply(ctr_type ctr, key_type key)
+  {
+    for (int r = 0; r < 10; r++) {
+      if (r > 0) {
+        key.v[0] += W0;
+        key.v[1] += W1;
+      }
+      uint64_t p0 = uint64_t(M0) * ctr.v[0];
+      uint64_t p1 = uint64_t(M1) * ctr.v[2];
+      ctr = {{uint32_t(p1 >> 32) ^ ctr.v[1] ^ key.v[0], uint32_t(p1),
+              uint32_t(p0 >> 32) ^ ctr.v[3] ^ key.v[1], uint32_t(p0)}};
+    }
+    return ctr;
+  }
+
+private:
+  static const uint32_t M0 = 0xD2511F53;
+  static const uint32_t M1 = 0xCD9E8D57;
+  static const uint32_t W0 = 0x9E3779B9;
+  static const uint32_t W1 = 0xBB67AE85;
+};
+
+// ======================================================================
+// RngStream
+//
+// distinguishes the random numbers used by different operators, so they
+// don't reuse each other's
+
+enum RngStream : uint32_t
+{
+  RNG_STREAM_COLLISION = 1,
+  RNG_STREAM_HEATING = 2,
+  RNG_STREAM_REWEIGHT = 3,
+};
+
+// ======================================================================
+// RngPhilox
+//
+// A sequence of random numbers that's fully determined by what it's
+// keyed by, typically the global cell index (or something else that
+// doesn't depend on the decomposition), the operator's RngStream, the
+// timestep and, optionally, a sub-sequence number (e.g. the particle).
+// That makes it cheap to create one wherever it's needed, e.g., per cell
+// or per particle, independent of threading and the order things are
+// processed in.
+
+template <typename R>
+struct RngPhilox
+{
+  using real_t = R;
+
+  __host__ __device__ RngPhilox(uint64_t key, uint32_t stream,
+                                uint32_t timestep, uint32_t seq = 0)
+    : key_{{uint32_t(key), uint32_t(key >> 32)}},
+      ctr_{{0, seq, stream, timestep}}
+  {}
+
+  // ----------------------------------------------------------------------
+  // uniform
+  //
+  // returns random number in ]0:1]
+
+  __host__ __device__ real_t uniform()
+  {
+    if (n_ == 4) {
+      buf_ = Philox4x32::apply(ctr_, key_);
+      ctr_.v[0]++;
+      n_ = 0;
+    }
+    return real_t((double(buf_.v[n_++]) + 1.) * (1. / 4294967296.));
+  }
+
+  // ----------------------------------------------------------------------
+  // normal
+  //
+  // returns normally distributed random number with mean 0, stdev 1
+
+  __host__ __device__ real_t normal()
+  {
+    real_t ran1 = uniform(), ran2 = uniform();
+    return std::sqrt(real_t(-2.) * std::log(ran1)) *
+           std::cos(real_t(2. * M_PI) * ran2);
+  }
+
+private:
+  Philox4x32::key_type key_;
+  Philox4x32::ctr_type ctr_;
+  Philox4x32::ctr_type buf_;
+  int n_ = 4;
+};
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace psc
+{
+
+// ======================================================================
+// ScratchArena
+//
+// Bump allocator for the temporary arrays that get built and thrown away
+// every step (sort offsets, collision permutations, particle send / recv
+// buffers, ...). Allocating just advances a pointer into a chunk that is
+// kept around, and a Scope hands everything allocated within it back when
+// it goes out of scope, so after the first few steps no calls to
+// malloc / free happen at all.
+//
+// If a request doesn't fit, another chunk gets added. At the next reset(),
+// which is meant to be called between steps, the chunks are merged into a
+// single one big enough for everything used so far.
+//
+// There is one arena per thread (ScratchArena::get()), so OpenMP threads
+// can draw from their own arena without locking. Only trivially copyable
+// types are supported, as nothing gets constructed or destructed.
+
+class ScratchArena
+{
+public:
+  static const std::size_t ALIGNMENT = 64;
+  static const std::size_t MIN_CHUNK_SIZE = 1 << 20;
+
+  // ----------------------------------------------------------------------
+  // Scope
+  //
+  // releases everything allocated from `arena` during its lifetime
+
+  class Scope
+  {
+  public:
+    Scope(ScratchArena& arena)
+      : arena_{arena}, chunk_{arena.cur_chunk_}, used_{arena.used_}
+    {
+      if (chunk_ >= 0) {
+        offset_ = arena_.chunks_[chunk_].offset;
+      }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    ~Scope()
+    {
+      for (int c = chunk_ + 1; c < arena_.chunks_.size(); c++) {
+        arena_.chunks_[c].offset = 0;
+      }
+      if (chunk_ >= 0) {
+        arena_.chunks_[chunk_].offset = offset_;
+      }
+      arena_.cur_chunk_ = chunk_;
+      arena_.used_ = used_;
+    }
+
+  private:
+    ScratchArena& arena_;
+    int chunk_;
+    std::size_t offset_ = 0;
+    std::size_t used_;
+  };
+
+  ScratchArena()
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    registry().push_back(this);
+  }
+
+  ScratchArena(const ScratchArena&) = delete;
+  ScratchArena& operator=(const ScratchArena&) = delete;
+
+  ~ScratchArena()
+  {
+    release();
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    auto& reg = registry();
+    reg.erase(std::remove(reg.begin(), reg.end(), this), reg.end());
+  }
+
+  // ----------------------------------------------------------------------
+  // get
+  //
+  // the calling thread's arena
+
+  static ScratchArena& get()
+  {
+    static thread_local ScratchArena arena;
+    return arena;
+  }
+
+  // ----------------------------------------------------------------------
+  // alloc
+  //
+  // uninitialized space for `n` T's, aligned to ALIGNMENT
+
+  template <typename T>
+  T* alloc(std::size_t n)
+  {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ScratchArena only holds trivially copyable types");
+    return static_cast<T*>(alloc_bytes(n * sizeof(T)));
+  }
+
+  // ----------------------------------------------------------------------
+  // calloc
+  //
+  // like alloc(), but zero-initialized
+
+  template <typename T>
+  T* calloc(std::size_t n)
+  {
+    T* p = alloc<T>(n);
+    std::memset(p, 0, n * sizeof(T));
+    return p;
+  }
+
+  // ----------------------------------------------------------------------
+  // reset
+  //
+  // drop all allocations, and if more than one chunk was needed, replace
+  // them by a single chunk that can hold the high water mark
+
+  void reset()
+  {
+    if (chunks_.size() > 1) {
+      std::size_t size = std::max(capacity(), high_water_);
+      release();
+      add_chunk(size);
+    }
+    for (auto& chunk : chunks_) {
+      chunk.offset = 0;
+    }
+    cur_chunk_ = chunks_.empty() ? -1 : 0;
+    used_ = 0;
+  }
+
+  // bytes currently handed out
+  std::size_t used() const { return used_; }
+
+  // largest used() seen since the arena was created
+  std::size_t high_water() const { return high_water_; }
+
+  // bytes currently held from the system
+  std::size_t capacity() const
+  {
+    std::size_t cap = 0;
+    for (auto& chunk : chunks_) {
+      cap += chunk.size;
+    }
+    return cap;
+  }
+
+  // ----------------------------------------------------------------------
+  // reset_all / high_water_all
+  //
+  // reset all threads' arenas, and sum their high water marks, for
+  // per-rank stats. Must not be called while other threads are using their
+  // arenas.
+
+  static void reset_all()
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    for (auto* arena : registry()) {
+      arena->reset();
+    }
+  }
+
+  static std::size_t high_water_all()
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    std::size_t hw = 0;
+    for (auto* arena : registry()) {
+      hw += arena->high_water();
+    }
+    return hw;
+  }
+
+private:
+  struct Chunk
+  {
+    char* data;
+    std::size_t size;
+    std::size_t offset;
+  };
+
+  void* alloc_bytes(std::size_t size)
+  {
+    size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+    // find a chunk (the current one, or a later one left over from a
+    // previous step) that has enough room, or make a new one
+    while (cur_chunk_ < 0 || chunks_[cur_chunk_].offset + size >
+                                 chunks_[cur_chunk_].size) {
+      if (cur_chunk_ + 1 < chunks_.size()) {
+        cur_chunk_++;
+        chunks_[cur_chunk_].offset = 0;
+      } else {
+        std::size_t last = chunks_.empty() ? 0 : chunks_.back().size;
+        add_chunk(std::max({size, 2 * last, MIN_CHUNK_SIZE}));
+        cur_chunk_ = chunks_.size() - 1;
+      }
+    }
+
+    auto& chunk = chunks_[cur_chunk_];
+    void* p = chunk.data + chunk.offset;
+    chunk.offset += size;
+    used_ += size;
+    high_water_ = std::max(high_water_, used_);
+    return p;
+  }
+
+  void add_chunk(std::size_t size)
+  {
+    void* p = nullptr;
+    if (posix_memalign(&p, ALIGNMENT, size) != 0) {
+      throw std::bad_alloc();
+    }
+    chunks_.push_back({static_cast<char*>(p), size, 0});
+  }
+
+  void release()
+  {
+    for (auto& chunk : chunks_) {
+      std::free(chunk.data);
+    }
+    chunks_.clear();
+    cur_chunk_ = -1;
+  }
+
+  static std::vector<ScratchArena*>& registry()
+  {
+    static std::vector<ScratchArena*> reg;
+    return reg;
+  }
+
+  static std::mutex& registry_mutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  std::vector<Chunk> chunks_;
+  int cur_chunk_ = -1;
+  std::size_t used_ = 0;
+  std::size_t high_water_ = 0;
+};
+
+} // namespace psc
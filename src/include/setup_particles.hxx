@@ -3,6 +3,7 @@
 
 #include <functional>
 #include <type_traits>
+#include "balance.hxx"
 #include "centering.hxx"
 #include "rng.hxx"
 
@@ -263,6 +264,7 @@ struct SetupParticles
     auto inj = mprts.injector();
 
     for (int p = 0; p < mprts.n_patches(); ++p) {
+      PatchTimer timer(p);
       auto injector = inj[p];
 
       op_cellwise(grid, p, init_np,
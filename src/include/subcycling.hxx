@@ -0,0 +1,144 @@
+
+#pragma once
+
+#include "grid.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+// ======================================================================
+// Subcycling
+//
+// Pushes kinds with subcycle[kind] = N > 1 only every N steps, by N * dt.
+// The push needs the E / H fields averaged over the N steps it covers, which
+// haven't happened yet, so they're extrapolated from the fields at the push
+// and their average over the N steps up to and including it. That's exact
+// for fields that change linearly in time. The current they deposit is the
+// average over the N steps to come, and is added to J in each of them, so
+// that charge is conserved again at the end of each cycle.
+//
+// The subcycled kinds are only moved by the push, so their particles need
+// to stay within one cell over N * dt, same as the others over dt. In
+// between, they're ahead of the fields by up to N - 1 steps, which
+// diagnostics and continuity checks will see. The Marder correction would
+// try to correct for that, so it can't be combined with subcycling.
+//
+// The extrapolated fields and the cached current live in an MfieldsState per
+// distinct N, which gets balanced along with everything else, but isn't
+// checkpointed. Checkpoints hence need to be taken where all cycles
+// start over, ie., at multiples of period(), when the cached current has
+// been used up. After a restart, the first push just uses the fields at
+// that step rather than an average.
+
+template <typename MfieldsState>
+class Subcycling
+{
+  using real_t = typename MfieldsState::real_t;
+
+  struct Group
+  {
+    int n_sub;
+    unsigned kind_mask = 0;
+    std::unique_ptr<MfieldsState> mflds; // extrapolated EM, cached J
+    int n_acc = 0;                       // steps accumulated into mflds
+    int next = 0;                        // timestep of the next push
+  };
+
+public:
+  Subcycling(const Grid_t& grid, const std::vector<int>& subcycle)
+  {
+    int n_kinds = grid.kinds.size();
+    assert(n_kinds <= 32);
+    for (int k = 0; k < n_kinds; k++) {
+      int n_sub = k < int(subcycle.size()) ? subcycle[k] : 1;
+      assert(n_sub >= 1);
+      if (n_sub == 1) {
+        kind_mask_ |= 1u << k;
+        continue;
+      }
+      auto it = std::find_if(groups_.begin(), groups_.end(),
+                             [&](const Group& g) { return g.n_sub == n_sub; });
+      if (it == groups_.end()) {
+        groups_.emplace_back();
+        it = groups_.end() - 1;
+        it->n_sub = n_sub;
+      }
+      it->kind_mask |= 1u << k;
+    }
+  }
+
+  bool active() const { return !groups_.empty(); }
+
+  // number of steps after which all cycles start over
+  int period() const
+  {
+    int period = 1;
+    for (const auto& g : groups_) {
+      int a = period, b = g.n_sub;
+      while (b != 0) {
+        int r = a % b;
+        a = b;
+        b = r;
+      }
+      period = period / a * g.n_sub;
+    }
+    return period;
+  }
+
+  // ----------------------------------------------------------------------
+  // push_mprts
+  //
+  // pushes the kinds that aren't subcycled, which also starts J over
+
+  template <typename PushParticles, typename Mparticles>
+  void push_mprts(PushParticles& pushp, Mparticles& mprts, MfieldsState& mflds)
+  {
+    pushp.push_mprts(mprts, mflds, kind_mask_, 1);
+  }
+
+  // ----------------------------------------------------------------------
+  // push_subcycled
+  //
+  // pushes the subcycled kinds whose turn it is, and adds the current of
+  // all subcycled kinds to J
+
+  template <typename PushParticles, typename Mparticles>
+  void push_subcycled(PushParticles& pushp, Mparticles& mprts,
+                      MfieldsState& mflds, int timestep)
+  {
+    auto em = mflds.storage().view(_all, _all, _all, _s(EX, HX + 3));
+    auto j = mflds.storage().view(_all, _all, _all, _s(JXI, JXI + 3));
+    for (auto& g : groups_) {
+      if (!g.mflds) {
+        g.mflds.reset(new MfieldsState{mflds.grid()});
+      }
+      auto em_avg = g.mflds->storage().view(_all, _all, _all, _s(EX, HX + 3));
+      auto j_sub = g.mflds->storage().view(_all, _all, _all, _s(JXI, JXI + 3));
+
+      em_avg = em_avg + em;
+      g.n_acc++;
+
+      if (timestep >= g.next) {
+        // (re)starting in the middle of a cycle, the first one is cut short
+        // to get back in phase
+        int n_sub = g.n_sub - timestep % g.n_sub;
+        // the accumulated average is centered (n_acc - 1) / 2 steps back,
+        // the interval to be pushed (n_sub - 1) / 2 steps ahead
+        double w = g.n_acc > 1 ? double(n_sub - 1) / (g.n_acc - 1) : 0.;
+        em_avg = real_t(1. + w) * em - real_t(w / g.n_acc) * em_avg;
+        pushp.push_mprts(mprts, *g.mflds, g.kind_mask, n_sub);
+        em_avg = real_t(0.);
+        g.n_acc = 0;
+        g.next = timestep + n_sub;
+      }
+
+      j = j + j_sub;
+    }
+  }
+
+private:
+  unsigned kind_mask_ = 0; // kinds pushed every step
+  std::vector<Group> groups_;
+};
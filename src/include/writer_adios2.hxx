@@ -11,10 +11,9 @@
 
 #ifdef PSC_USE_IO_THREADS
 
-#include <thread>
+#include "io_thread.hxx"
+
 #include <mutex>
-#include <condition_variable>
-#include <queue>
 
 static std::mutex writer_mutex;
 
@@ -22,18 +21,8 @@ static std::mutex writer_mutex;
 
 class WriterADIOS2
 {
-#ifdef PSC_USE_IO_THREADS
-  using task_type = std::function<void(void)>;
-#endif
-
 public:
-  WriterADIOS2()
-  {
-    MPI_Comm_dup(MPI_COMM_WORLD, &comm_);
-#ifdef PSC_USE_IO_THREADS
-    writer_thread_ = std::thread(&WriterADIOS2::thread_func, this);
-#endif
-  }
+  WriterADIOS2() { MPI_Comm_dup(MPI_COMM_WORLD, &comm_); }
 
   WriterADIOS2(const WriterADIOS2&) = delete;
   WriterADIOS2& operator=(const WriterADIOS2&) = delete;
@@ -41,14 +30,8 @@ public:
   ~WriterADIOS2()
   {
 #ifdef PSC_USE_IO_THREADS
-    std::unique_lock<std::mutex> lock(queue_lock_);
-    exit_ = true;
-    lock.unlock();
-    cv_.notify_all();
-
-    if (writer_thread_.joinable()) {
-      writer_thread_.join();
-    }
+    // pending writes still use comm_
+    io_thread_.wait();
 #endif
     MPI_Comm_free(&comm_);
   }
@@ -212,10 +195,7 @@ public:
       prof_stop(pr_thread);
     };
 
-    std::unique_lock<std::mutex> lock(queue_lock_);
-    queue_.push(write_func);
-    lock.unlock();
-    cv_.notify_one();
+    io_thread_.push(std::move(write_func));
 #else
     prof_start(pr_write);
     begin_step(grid);
@@ -228,26 +208,6 @@ public:
   }
 
 private:
-#ifdef PSC_USE_IO_THREADS
-  void thread_func()
-  {
-    std::unique_lock<std::mutex> lock(queue_lock_);
-
-    do {
-      cv_.wait(lock, [this] { return queue_.size() || exit_; });
-
-      if (!exit_ && queue_.size()) {
-        auto task = std::move(queue_.front());
-        queue_.pop();
-
-        lock.unlock();
-        task();
-        lock.lock();
-      }
-    } while (!exit_);
-  }
-#endif
-
   // Our writer thread may be writing one file via adios2 at the same time that
   // another thread is writing another file, and adios2 isn't thread safe at
   // all, so both threads may be making MPI calls that interfere with each
@@ -258,10 +218,6 @@ private:
   std::string pfx_;
   std::string dir_;
 #ifdef PSC_USE_IO_THREADS
-  std::thread writer_thread_;
-  std::queue<task_type> queue_;
-  std::mutex queue_lock_;
-  std::condition_variable cv_;
-  bool exit_ = false;
+  IOThread io_thread_;
 #endif
 };
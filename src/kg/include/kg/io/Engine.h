@@ -73,6 +73,11 @@ public:
   template <typename T>
   Dims variableShape();
 
+  // ----------------------------------------------------------------------
+  // hasAttribute
+
+  bool hasAttribute(const std::string& pfx);
+
   // ----------------------------------------------------------------------
   // internal
 
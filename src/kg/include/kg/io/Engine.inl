@@ -138,6 +138,17 @@ inline void Engine::getAttribute(std::vector<T>& vec)
   file_.getAttribute(prefix(), vec.data());
 }
 
+// ----------------------------------------------------------------------
+// hasAttribute
+
+inline bool Engine::hasAttribute(const std::string& pfx)
+{
+  prefixes_.push_back(pfx);
+  bool has = file_.sizeAttribute(prefix()) > 0;
+  prefixes_.pop_back();
+  return has;
+}
+
 // ----------------------------------------------------------------------
 // variableShape
 
@@ -270,6 +270,9 @@ inline size_t FileAdios2::sizeAttribute(const std::string& name) const
   }
   ADIOS2_FOREACH_ATTRIBUTE_STDTYPE_1ARG(make_case)
 #undef make_case
+  else if (type.empty()) { // no such attribute
+    return 0;
+  }
   std::abort();
 }
 
@@ -43,6 +43,7 @@ public:
   virtual void getAttribute(const std::string& name, TypePointer data) = 0;
   virtual void putAttribute(const std::string& name, TypeConstPointer data,
                             size_t size) = 0;
+  // 0 if there is no such attribute
   virtual size_t sizeAttribute(const std::string& name) const = 0;
 };
 
@@ -49,6 +49,28 @@ TEST(IO, WriteReadAttr)
   }
 }
 
+TEST(IO, HasAttr)
+{
+  auto io = kg::io::IOAdios2{};
+
+  {
+    auto writer = io.open("test.bp", kg::io::Mode::Write);
+    writer.beginStep(kg::io::StepMode::Append);
+    writer.put("attr_double", 99.);
+    writer.endStep();
+    writer.close();
+  }
+
+  {
+    auto reader = io.open("test.bp", kg::io::Mode::Read);
+    reader.beginStep(kg::io::StepMode::Read);
+    EXPECT_TRUE(reader.hasAttribute("attr_double"));
+    EXPECT_FALSE(reader.hasAttribute("attr_missing"));
+    reader.endStep();
+    reader.close();
+  }
+}
+
 struct Custom
 {
   int i;
@@ -2,5 +2,6 @@
 #include "balance.hxx"
 
 double* psc_balance_comp_time_by_patch;
+double* psc_balance_cost_by_patch;
 
 int psc_balance_generation_cnt;
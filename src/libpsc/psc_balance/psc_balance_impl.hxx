@@ -17,10 +17,9 @@
 #include <mrc_profile.h>
 #include <string.h>
 
+#include <algorithm>
 #include <numeric>
 
-extern double* psc_balance_comp_time_by_patch;
-
 static double capability_default(int p) { return 1.; }
 
 // ======================================================================
@@ -113,8 +112,6 @@ inline void best_mapping_recursive(const input& input,
                                         &input.load_by_patch[patch_end], 0.);
     double load_target =
       (load_total * (proc_middle - proc_begin)) / (proc_end - proc_begin);
-    std::cout << "[" << proc_begin << ":" << proc_end << "] total "
-              << load_total << " target " << load_target << "\n";
     double load = 0.;
     int patch_middle = patch_begin;
     for (;;) {
@@ -134,7 +131,6 @@ inline void best_mapping_recursive(const input& input,
         break;
       }
     }
-    std::cout << "middle " << patch_middle << " load " << load << "\n";
 
     // make sure there are at least as many patches as procs on either side
     if (patch_middle - patch_begin < proc_middle - proc_begin) {
@@ -162,6 +158,350 @@ inline std::vector<int> best_mapping(const input& input)
 }
 
 #endif
+
+// ----------------------------------------------------------------------
+// best_mapping (distributed)
+//
+// The same recursive bisection as above, but working on the prefix sum of
+// the loads along the space-filling curve. The prefix sum stays
+// distributed like the patches themselves. Each proc looks for cuts only
+// among its own patches, and the cuts found are shared with two
+// allreduces per level. All procs end up with the complete
+// n_patches_by_proc and, if asked for, the resulting load on each proc.
+// Loads are accumulated globally rather than per segment, so a cut might
+// differ from the serial version when rounding makes two candidates tie.
+//
+// Usually, each process passes its own loads. It can also stand in for a
+// contiguous range of procs and pass the loads of each of them, which is
+// how the tests run many procs on MPI_COMM_SELF.
+
+inline std::vector<int> best_mapping(
+  MPI_Comm comm, const std::vector<std::vector<double>>& loads_by_local_proc,
+  std::vector<double>* load_by_proc = nullptr)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  // global index of the first local patch, and the load before it, for
+  // each local proc
+  int n_local_procs = loads_by_local_proc.size();
+  int n_patches_local = 0;
+  double load_local = 0.;
+  for (const auto& loads : loads_by_local_proc) {
+    n_patches_local += loads.size();
+    load_local += std::accumulate(loads.begin(), loads.end(), 0.);
+  }
+  int patch_off = 0;
+  double load_off = 0.;
+  MPI_Exscan(&n_patches_local, &patch_off, 1, MPI_INT, MPI_SUM, comm);
+  MPI_Exscan(&load_local, &load_off, 1, MPI_DOUBLE, MPI_SUM, comm);
+  if (rank == 0) { // MPI_Exscan leaves rank 0's result undefined
+    patch_off = 0;
+    load_off = 0.;
+  }
+  int size, n_global_patches;
+  double load_total;
+  MPI_Allreduce(&n_local_procs, &size, 1, MPI_INT, MPI_SUM, comm);
+  MPI_Allreduce(&n_patches_local, &n_global_patches, 1, MPI_INT, MPI_SUM,
+                comm);
+  MPI_Allreduce(&load_local, &load_total, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+  // prefix[l][i] is the total load of all global patches before patch i of
+  // local proc l, which starts at global patch patch_offs[l]
+  std::vector<std::vector<double>> prefix(n_local_procs);
+  std::vector<int> patch_offs(n_local_procs);
+  for (int l = 0; l < n_local_procs; l++) {
+    const auto& loads = loads_by_local_proc[l];
+    prefix[l].resize(loads.size() + 1);
+    prefix[l][0] = load_off;
+    for (int i = 0; i < loads.size(); i++) {
+      prefix[l][i + 1] = prefix[l][i] + loads[i];
+    }
+    patch_offs[l] = patch_off;
+    patch_off += loads.size();
+    load_off = prefix[l].back();
+  }
+
+  struct segment
+  {
+    int proc_begin, proc_end;
+    int patch_begin, patch_end;
+    double load_begin, load_end; // prefix sum at patch_begin, patch_end
+  };
+
+  std::vector<int> n_patches_by_proc(size);
+  if (load_by_proc) {
+    load_by_proc->assign(size, 0.);
+  }
+
+  std::vector<segment> segments;
+  auto add_segment = [&](const segment& seg) {
+    // we always must have at least one patch per proc
+    assert(seg.patch_end - seg.patch_begin >= seg.proc_end - seg.proc_begin);
+    if (seg.proc_end == seg.proc_begin + 1) {
+      n_patches_by_proc[seg.proc_begin] = seg.patch_end - seg.patch_begin;
+      if (load_by_proc) {
+        (*load_by_proc)[seg.proc_begin] = seg.load_end - seg.load_begin;
+      }
+    } else {
+      segments.push_back(seg);
+    }
+  };
+
+  add_segment({0, size, 0, n_global_patches, 0., load_total});
+  while (!segments.empty()) {
+    int n_segments = segments.size();
+
+    // find the cut in each segment, on the proc that has the patch where
+    // the prefix sum crosses the target
+    std::vector<int> cuts_local(n_segments, -1), cuts(n_segments);
+    for (int s = 0; s < n_segments; s++) {
+      auto& seg = segments[s];
+      int proc_middle = (seg.proc_begin + seg.proc_end) / 2;
+      double threshold =
+        seg.load_begin + ((seg.load_end - seg.load_begin) *
+                          (proc_middle - seg.proc_begin)) /
+                           (seg.proc_end - seg.proc_begin);
+
+      for (int l = 0; l < n_local_procs; l++) {
+        const auto& pfx = prefix[l];
+        int n_patches = pfx.size() - 1;
+        int i_begin = std::max(seg.patch_begin - patch_offs[l], 0);
+        int i_end = std::min(seg.patch_end - patch_offs[l], n_patches);
+        if (i_begin >= i_end || pfx[i_begin] > threshold) {
+          continue;
+        }
+        auto it =
+          std::upper_bound(&pfx[i_begin + 1], &pfx[i_end + 1], threshold);
+        if (it == &pfx[i_end + 1]) {
+          continue;
+        }
+        int i = it - &pfx[0];
+        double above = pfx[i] - threshold;
+        double below = threshold - pfx[i - 1];
+        // if we were closer to the target load one step ago, go with that
+        cuts_local[s] = patch_offs[l] + (below < above ? i - 1 : i);
+      }
+    }
+    MPI_Allreduce(cuts_local.data(), cuts.data(), n_segments, MPI_INT, MPI_MAX,
+                  comm);
+
+    // make sure there are at least as many patches as procs on either side
+    for (int s = 0; s < n_segments; s++) {
+      auto& seg = segments[s];
+      int proc_middle = (seg.proc_begin + seg.proc_end) / 2;
+      int& patch_middle = cuts[s];
+      if (patch_middle < 0) { // target never crossed (roundoff)
+        patch_middle = seg.patch_end;
+      }
+      if (patch_middle - seg.patch_begin < proc_middle - seg.proc_begin) {
+        patch_middle = seg.patch_begin + (proc_middle - seg.proc_begin);
+      }
+      if (seg.patch_end - patch_middle < seg.proc_end - proc_middle) {
+        patch_middle = seg.patch_end - (seg.proc_end - proc_middle);
+      }
+    }
+
+    // prefix sum at the cuts, from the proc that has the patch before it
+    std::vector<double> loads_local(n_segments), loads_cut(n_segments);
+    for (int s = 0; s < n_segments; s++) {
+      for (int l = 0; l < n_local_procs; l++) {
+        int i = cuts[s] - patch_offs[l];
+        if (i >= 1 && i < prefix[l].size()) {
+          loads_local[s] = prefix[l][i];
+        }
+      }
+    }
+    MPI_Allreduce(loads_local.data(), loads_cut.data(), n_segments, MPI_DOUBLE,
+                  MPI_SUM, comm);
+
+    auto parents = std::move(segments);
+    segments.clear();
+    for (int s = 0; s < n_segments; s++) {
+      auto& seg = parents[s];
+      int proc_middle = (seg.proc_begin + seg.proc_end) / 2;
+      add_segment({seg.proc_begin, proc_middle, seg.patch_begin, cuts[s],
+                   seg.load_begin, loads_cut[s]});
+      add_segment({proc_middle, seg.proc_end, cuts[s], seg.patch_end,
+                   loads_cut[s], seg.load_end});
+    }
+  }
+
+  return n_patches_by_proc;
+}
+
+inline std::vector<int> best_mapping(MPI_Comm comm,
+                                     const std::vector<double>& loads,
+                                     std::vector<double>* load_by_proc = nullptr)
+{
+  return best_mapping(comm, std::vector<std::vector<double>>{loads},
+                      load_by_proc);
+}
+
+// ======================================================================
+// incremental
+//
+// Parameters for incremental rebalancing. Rather than jumping to the best
+// mapping right away, the boundaries between neighboring procs along the
+// space-filling curve only move toward it, each by no more than max_bytes
+// worth of patch data. The move is made only if it pays off: the drop in
+// the largest per-proc load, times n_steps (how long the new mapping is
+// expected to last), has to exceed the migration cost, which is
+// cost_per_byte times the most bytes any one proc sends. Loads and
+// cost_per_byte are in the same units, i.e., particles or seconds
+// depending on how the loads are measured.
+
+struct incremental
+{
+  double max_bytes = 0.; // per boundary, 0 turns incremental mode off
+  double cost_per_byte = 0.;
+  int n_steps = 1;
+};
+
+// ----------------------------------------------------------------------
+// incremental_mapping
+//
+// given the old and best (target) mapping, returns the new mapping
+// according to the above, or the old one if the move doesn't pay off.
+// Like best_mapping (distributed), a process can pass the loads and bytes
+// for a contiguous range of procs.
+
+inline std::vector<int> incremental_mapping(
+  MPI_Comm comm, const std::vector<std::vector<double>>& loads_by_local_proc,
+  const std::vector<std::vector<double>>& bytes_by_local_proc,
+  const std::vector<int>& n_patches_by_proc_old,
+  const std::vector<int>& n_patches_by_proc_target, const incremental& prm,
+  std::vector<double>* load_by_proc = nullptr)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  int size = n_patches_by_proc_old.size();
+
+  int n_local_procs = loads_by_local_proc.size();
+  assert(bytes_by_local_proc.size() == n_local_procs);
+  int proc_off = 0;
+  MPI_Exscan(&n_local_procs, &proc_off, 1, MPI_INT, MPI_SUM, comm);
+  if (rank == 0) { // MPI_Exscan leaves rank 0's result undefined
+    proc_off = 0;
+  }
+
+  // boundaries between procs, cut[r] is the first patch on proc r
+  auto get_cuts = [](const std::vector<int>& n_patches_by_proc) {
+    std::vector<int> cuts(n_patches_by_proc.size() + 1);
+    std::partial_sum(n_patches_by_proc.begin(), n_patches_by_proc.end(),
+                     cuts.begin() + 1);
+    return cuts;
+  };
+  auto cuts_old = get_cuts(n_patches_by_proc_old);
+  auto cuts_target = get_cuts(n_patches_by_proc_target);
+
+  // for each boundary: shift (in patches), load and bytes moved across it.
+  // Only one of the two procs next to a boundary can move it.
+  enum
+  {
+    SHIFT,
+    LOAD,
+    BYTES,
+    N_MOVED
+  };
+  std::vector<double> moved_local(N_MOVED * (size + 1)), moved(moved_local);
+  std::vector<double> load_by_proc_local(size), load_by_proc_old(size);
+  for (int l = 0; l < n_local_procs; l++) {
+    const auto& loads = loads_by_local_proc[l];
+    const auto& bytes = bytes_by_local_proc[l];
+    int r = proc_off + l;
+    int n_patches = loads.size();
+    assert(n_patches == n_patches_by_proc_old[r]);
+    assert(bytes.size() == n_patches);
+    int off = cuts_old[r];
+
+    // This proc gives away patches at its left end if the boundary there
+    // moves right, and at its right end if that one moves left. Move each
+    // of them as far as the byte limit allows, but keep at least one patch.
+    int i_left = 0, i_right = n_patches;
+    double load_left = 0., load_right = 0.;
+    double bytes_left = 0., bytes_right = 0.;
+    while (i_left < cuts_target[r] - off && i_left + 1 < i_right &&
+           bytes_left + bytes[i_left] <= prm.max_bytes) {
+      load_left += loads[i_left];
+      bytes_left += bytes[i_left];
+      i_left++;
+    }
+    while (i_right > cuts_target[r + 1] - off && i_right - 1 > i_left &&
+           bytes_right + bytes[i_right - 1] <= prm.max_bytes) {
+      load_right += loads[i_right - 1];
+      bytes_right += bytes[i_right - 1];
+      i_right--;
+    }
+
+    // the neighbor on the other side of each boundary contributes zeros
+    moved_local[N_MOVED * r + SHIFT] += i_left;
+    moved_local[N_MOVED * r + LOAD] += load_left;
+    moved_local[N_MOVED * r + BYTES] += bytes_left;
+    moved_local[N_MOVED * (r + 1) + SHIFT] += i_right - n_patches;
+    moved_local[N_MOVED * (r + 1) + LOAD] += load_right;
+    moved_local[N_MOVED * (r + 1) + BYTES] += bytes_right;
+
+    load_by_proc_local[r] = std::accumulate(loads.begin(), loads.end(), 0.);
+  }
+  MPI_Allreduce(moved_local.data(), moved.data(), moved.size(), MPI_DOUBLE,
+                MPI_SUM, comm);
+  MPI_Allreduce(load_by_proc_local.data(), load_by_proc_old.data(), size,
+                MPI_DOUBLE, MPI_SUM, comm);
+
+  std::vector<int> n_patches_by_proc_new(size);
+  auto load_by_proc_new = load_by_proc_old;
+  double max_bytes_sent = 0.;
+  for (int r = 0; r < size; r++) {
+    const double* left = &moved[N_MOVED * r];
+    const double* right = &moved[N_MOVED * (r + 1)];
+    n_patches_by_proc_new[r] = n_patches_by_proc_old[r] - int(left[SHIFT]) +
+                               int(right[SHIFT]);
+    double bytes_sent = 0.;
+    if (left[SHIFT] > 0) {
+      load_by_proc_new[r] -= left[LOAD];
+      bytes_sent += left[BYTES];
+    } else {
+      load_by_proc_new[r] += left[LOAD];
+    }
+    if (right[SHIFT] < 0) {
+      load_by_proc_new[r] -= right[LOAD];
+      bytes_sent += right[BYTES];
+    } else {
+      load_by_proc_new[r] += right[LOAD];
+    }
+    max_bytes_sent = std::max(max_bytes_sent, bytes_sent);
+  }
+
+  double gain =
+    *std::max_element(load_by_proc_old.begin(), load_by_proc_old.end()) -
+    *std::max_element(load_by_proc_new.begin(), load_by_proc_new.end());
+  if (gain * prm.n_steps <= prm.cost_per_byte * max_bytes_sent) {
+    if (load_by_proc) {
+      *load_by_proc = load_by_proc_old;
+    }
+    return n_patches_by_proc_old;
+  }
+
+  if (load_by_proc) {
+    *load_by_proc = load_by_proc_new;
+  }
+  return n_patches_by_proc_new;
+}
+
+inline std::vector<int> incremental_mapping(
+  MPI_Comm comm, const std::vector<double>& loads,
+  const std::vector<double>& bytes,
+  const std::vector<int>& n_patches_by_proc_old,
+  const std::vector<int>& n_patches_by_proc_target, const incremental& prm,
+  std::vector<double>* load_by_proc = nullptr)
+{
+  return incremental_mapping(comm, std::vector<std::vector<double>>{loads},
+                             std::vector<std::vector<double>>{bytes},
+                             n_patches_by_proc_old, n_patches_by_proc_target,
+                             prm, load_by_proc);
+}
+
 inline void print_stats(const input& input,
                         const std::vector<int>& nr_patches_all_new,
                         bool verbose)
@@ -199,6 +539,37 @@ inline void print_stats(const input& input,
           100 * min_diff / load_target, 100 * max_diff / load_target);
 }
 
+// ----------------------------------------------------------------------
+// print_stats
+//
+// same as above, given only the total load on each proc
+
+inline void print_stats(const std::vector<double>& capability,
+                        const std::vector<double>& load_by_proc,
+                        const std::vector<int>& nr_patches_all_new,
+                        bool verbose)
+{
+  int n_procs = capability.size();
+  double load_target =
+    std::accumulate(load_by_proc.begin(), load_by_proc.end(), 0.) /
+    std::accumulate(capability.begin(), capability.end(), 0.);
+
+  double min_diff = 0, max_diff = 0;
+  for (int p = 0; p < n_procs; p++) {
+    double diff = load_by_proc[p] - load_target * capability[p];
+    if (verbose) {
+      mprintf("p %d # = %d load %g / %g : diff %g %%\n", p,
+              nr_patches_all_new[p], load_by_proc[p],
+              load_target * capability[p],
+              100. * diff / (load_target * capability[p]));
+    }
+    min_diff = std::min(min_diff, diff);
+    max_diff = std::max(max_diff, diff);
+  }
+  mprintf("psc_balance: achieved target %g (%g %% -- %g %%)\n", load_target,
+          100 * min_diff / load_target, 100 * max_diff / load_target);
+}
+
 inline void write_loads(const input& input,
                         const std::vector<int>& nr_patches_all_new,
                         int timestep)
@@ -257,8 +628,13 @@ public:
           n_prts_by_patch[p] + factor_fields_ * ldims[0] * ldims[1] * ldims[2];
         // mprintf("loads p %d %g %g ratio %g\n", p, loads[p], comp_time,
         // loads[p] / comp_time);
+      } else if (psc_balance_cost_by_patch) {
+        // measured cost
+        load = psc_balance_cost_by_patch[p];
       } else {
-        load = psc_balance_comp_time_by_patch[p];
+        // no measurements yet (same on all procs), so go by particle count
+        const int* ldims = grid.ldims;
+        load = n_prts_by_patch[p] + ldims[0] * ldims[1] * ldims[2];
       }
 #if 0
       int rank;
@@ -267,6 +643,10 @@ public:
 #endif
       loads.push_back(load);
     }
+    if (factor_fields_ < 0. && !psc_balance_cost_by_patch) {
+      mpi_printf(grid.comm(), "psc_balance: no measured cost yet, balancing "
+                              "on particle count + cells\n");
+    }
     return loads;
   }
 
@@ -326,6 +706,81 @@ inline std::vector<double> gather_loads(const Grid_t& grid,
   return loads_all;
 }
 
+// ======================================================================
+// halo_stats
+//
+// how much each proc's patches border on patches that live on other
+// procs: the number of face cells between them (surface), and the number
+// of other procs they touch (across faces, edges or corners)
+
+struct halo_stats
+{
+  double surface_avg;
+  double surface_max;
+  double n_neighbors_avg;
+  double n_neighbors_max;
+};
+
+inline halo_stats get_halo_stats(const Grid_t& grid)
+{
+  const MrcDomain& domain = grid.mrc_domain();
+  MPI_Comm comm = domain.comm();
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  auto& ldims = grid.ldims;
+  double surface = 0.;
+  std::vector<int> neighbors;
+  for (int p = 0; p < grid.n_patches(); p++) {
+    int dir[3];
+    for (dir[2] = -1; dir[2] <= 1; dir[2]++) {
+      for (dir[1] = -1; dir[1] <= 1; dir[1]++) {
+        for (dir[0] = -1; dir[0] <= 1; dir[0]++) {
+          int n_dirs = 0, d_face = 0;
+          for (int d = 0; d < 3; d++) {
+            if (dir[d] != 0) {
+              if (grid.isInvar(d)) {
+                n_dirs = -1;
+                break;
+              }
+              n_dirs++;
+              d_face = d;
+            }
+          }
+          if (n_dirs <= 0) {
+            continue;
+          }
+
+          int nei_rank, nei_patch;
+          domain.neighborRankPatch(p, dir, &nei_rank, &nei_patch);
+          if (nei_rank < 0 || nei_rank == rank) {
+            continue;
+          }
+          neighbors.push_back(nei_rank);
+          if (n_dirs == 1) {
+            surface += ldims[0] * ldims[1] * ldims[2] / ldims[d_face];
+          }
+        }
+      }
+    }
+  }
+  std::sort(neighbors.begin(), neighbors.end());
+  double n_neighbors =
+    std::unique(neighbors.begin(), neighbors.end()) - neighbors.begin();
+
+  halo_stats stats;
+  MPI_Allreduce(&surface, &stats.surface_avg, 1, MPI_DOUBLE, MPI_SUM, comm);
+  MPI_Allreduce(&surface, &stats.surface_max, 1, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(&n_neighbors, &stats.n_neighbors_avg, 1, MPI_DOUBLE, MPI_SUM,
+                comm);
+  MPI_Allreduce(&n_neighbors, &stats.n_neighbors_max, 1, MPI_DOUBLE, MPI_MAX,
+                comm);
+  stats.surface_avg /= size;
+  stats.n_neighbors_avg /= size;
+  return stats;
+}
+
 } // namespace balance
 } // namespace psc
 
@@ -491,21 +946,34 @@ public:
     }
 
     prof_start(pr);
+    auto n_prts_by_patch_new = new_by_patch(n_prts_by_patch_old, MPI_INT);
+    prof_stop(pr);
+    return n_prts_by_patch_new;
+  }
 
-    std::vector<uint> n_prts_by_patch_new(nr_patches_new_);
+  // ----------------------------------------------------------------------
+  // new_by_patch
+  //
+  // redistribute one value per patch from the old to the new decomposition
+
+  template <typename T>
+  std::vector<T> new_by_patch(const std::vector<T>& n_prts_by_patch_old,
+                              MPI_Datatype dtype)
+  {
+    std::vector<T> n_prts_by_patch_new(nr_patches_new_);
     // post receives
 
     std::vector<MPI_Request> recv_reqs(nr_patches_new_);
     int nr_recv_reqs = 0;
 
-    std::vector<std::vector<int>> nr_particles_recv_by_ri(nr_recv_ranks_);
+    std::vector<std::vector<T>> nr_particles_recv_by_ri(nr_recv_ranks_);
     for (int ri = 0; ri < nr_recv_ranks_; ri++) {
       struct by_ri* recv = &recv_by_ri_[ri];
       nr_particles_recv_by_ri[ri].resize(recv->nr_patches);
 
       if (recv->rank != mpi_rank_) {
         // mprintf("recv <- %d (len %d)\n", r, nr_patches_recv_by_ri[ri]);
-        MPI_Irecv(nr_particles_recv_by_ri[ri].data(), recv->nr_patches, MPI_INT,
+        MPI_Irecv(nr_particles_recv_by_ri[ri].data(), recv->nr_patches, dtype,
                   recv->rank, 10, comm_, &recv_reqs[nr_recv_reqs++]);
       }
     }
@@ -515,7 +983,7 @@ public:
     std::vector<MPI_Request> send_reqs(nr_send_ranks_);
     int nr_send_reqs = 0;
 
-    std::vector<std::vector<int>> nr_particles_send_by_ri(nr_send_ranks_);
+    std::vector<std::vector<T>> nr_particles_send_by_ri(nr_send_ranks_);
     for (int ri = 0; ri < nr_send_ranks_; ri++) {
       struct by_ri* send = &send_by_ri_[ri];
       nr_particles_send_by_ri[ri].resize(send->nr_patches);
@@ -527,7 +995,7 @@ public:
 
       if (send->rank != mpi_rank_) {
         // mprintf("send -> %d (len %d)\n", r, nr_patches_send_by_ri[ri]);
-        MPI_Isend(nr_particles_send_by_ri[ri].data(), send->nr_patches, MPI_INT,
+        MPI_Isend(nr_particles_send_by_ri[ri].data(), send->nr_patches, dtype,
                   send->rank, 10, comm_, &send_reqs[nr_send_reqs++]);
       }
     }
@@ -563,9 +1031,6 @@ public:
 
     MPI_Waitall(nr_send_reqs, send_reqs.data(), MPI_STATUSES_IGNORE);
 
-    // return result
-
-    prof_stop(pr);
     return n_prts_by_patch_new;
   }
 
@@ -589,7 +1054,20 @@ public:
 
     auto n_prts_by_patch_new = new_n_prts(mp_old.sizeByPatch());
 
+    // local particles: patches that stay on this proc just hand their buffer
+    // over to the new storage, so there's nothing to allocate or copy
+    for (int p = 0; p < nr_patches_new_; p++) {
+      if (recv_info_[p].rank != mpi_rank_) {
+        continue;
+      }
+
+      auto& buf_old = mp_old.storage().buffer(recv_info_[p].patch);
+      assert(buf_old.size() == n_prts_by_patch_new[p]);
+      mp_new.storage().buffer(p) = std::move(buf_old);
+    }
+
     // prof_start(pr_A);
+    // (no-op for the buffers moved above)
     mp_new.reserve_all(n_prts_by_patch_new);
     mp_new.resize_all(n_prts_by_patch_new);
 
@@ -638,33 +1116,6 @@ public:
     }
     // prof_stop(pr_B);
 
-    // prof_start(pr_C);
-    // local particles
-    // OPT: could keep the alloced arrays, just move pointers...
-    for (int p = 0; p < nr_patches_new_; p++) {
-      if (recv_info_[p].rank != mpi_rank_) {
-        continue;
-      }
-
-      auto&& prts_old = mp_old[recv_info_[p].patch];
-      auto&& prts_new = mp_new[p];
-      assert(prts_old.size() == prts_new.size());
-#if 1
-      for (int n = 0; n < prts_new.size(); n++) {
-        prts_new[n] = prts_old[n];
-      }
-#else
-      // FIXME, this needs at least a proper interface -- if not separately
-      // alloc'ed, bad things are going to happen
-      free(c_new->particles);
-      c_new->particles = c_old->particles;
-      c_new->n_alloced = c_old->n_alloced;
-      c_old->particles = NULL; // prevent from being freed
-      c_old->n_alloced = 0;
-#endif
-    }
-    // prof_stop(pr_C);
-
     // prof_start(pr_D);
     MPI_Waitall(nr_send_reqs, send_reqs.data(), MPI_STATUSES_IGNORE);
     MPI_Waitall(nr_recv_reqs, recv_reqs.data(), MPI_STATUSES_IGNORE);
@@ -727,19 +1178,32 @@ public:
 
     prof_start(pr);
     // local fields
-    // OPT: could keep the alloced arrays, just move pointers...
-    for (int p = 0; p < nr_patches_new_; p++) {
+    // all patches share a single allocation, so they can't be handed over
+    // one by one like the particles. But patches are contiguous in memory,
+    // and with a space-filling curve decomposition the ones that stay here
+    // are consecutive in both the old and new numbering, so this ends up
+    // being a single memcpy.
+    for (int p = 0; p < nr_patches_new_;) {
       if (recv_info_[p].rank != mpi_rank_) {
+        p++;
         continue;
       }
 
-      auto flds_old = mf_old[recv_info_[p].patch];
+      int p_old = recv_info_[p].patch;
+      int n = 1;
+      while (p + n < nr_patches_new_ && recv_info_[p + n].rank == mpi_rank_ &&
+             recv_info_[p + n].patch == p_old + n) {
+        n++;
+      }
+
+      auto flds_old = mf_old[p_old];
       auto flds_new = mf_new[p];
       assert(flds_old.storage().shape() == flds_new.storage().shape());
-      int size = flds_old.storage().size();
+      size_t size = flds_old.storage().size() * n;
       void* addr_new = flds_new.storage().data();
       void* addr_old = flds_old.storage().data();
       memcpy(addr_new, addr_old, size * sizeof(typename Mfields::real_t));
+      p += n;
     }
     prof_stop(pr);
 
@@ -777,25 +1241,64 @@ struct Balance_
   using Particle = typename Mparticles::Particle;
   using real_t = typename Mparticles::real_t;
 
+  // with factor_fields < 0, the load of a patch is its measured compute
+  // time (see PatchTimer), smoothed over steps with weight cost_alpha for
+  // the most recent step. Otherwise, it's
+  // n_prts + factor_fields * n_cells.
+  // With incremental.max_bytes > 0, rebalancing only moves patches between
+  // neighboring procs, see psc::balance::incremental.
   Balance_(double factor_fields = 1., bool print_loads = false,
-           bool write_loads = false)
+           bool write_loads = false, double cost_alpha = .2,
+           psc::balance::incremental incremental = {})
     : factor_fields_(factor_fields),
       get_loads_{factor_fields},
       print_loads_(print_loads),
-      write_loads_(write_loads)
+      write_loads_(write_loads),
+      cost_alpha_(cost_alpha),
+      incremental_(incremental)
   {}
 
-  ~Balance_()
+  ~Balance_() { free_cost(); }
+
+  // ----------------------------------------------------------------------
+  // update_cost
+  //
+  // to be called once at the end of every step: folds the compute time
+  // measured in this step into the smoothed per-patch cost
+
+  void update_cost(const Grid_t& grid)
   {
-    delete[] psc_balance_comp_time_by_patch;
-    psc_balance_comp_time_by_patch = nullptr;
+    if (factor_fields_ >= 0.) {
+      return;
+    }
+
+    int n_patches = grid.n_patches();
+    if (!psc_balance_comp_time_by_patch) {
+      // start measuring with the next step
+      psc_balance_comp_time_by_patch = new double[n_patches]{};
+      return;
+    }
+
+    if (!psc_balance_cost_by_patch) {
+      psc_balance_cost_by_patch = new double[n_patches];
+      std::copy(psc_balance_comp_time_by_patch,
+                psc_balance_comp_time_by_patch + n_patches,
+                psc_balance_cost_by_patch);
+    } else {
+      for (int p = 0; p < n_patches; p++) {
+        psc_balance_cost_by_patch[p] =
+          cost_alpha_ * psc_balance_comp_time_by_patch[p] +
+          (1. - cost_alpha_) * psc_balance_cost_by_patch[p];
+      }
+    }
+    std::fill(psc_balance_comp_time_by_patch,
+              psc_balance_comp_time_by_patch + n_patches, 0.);
   }
 
   void initial(Grid_t*& grid, std::vector<uint>& n_prts_by_patch)
   {
     auto loads = get_loads_.initial(*grid, n_prts_by_patch);
-    auto loads_all = psc::balance::gather_loads(*grid, loads);
-    n_prts_by_patch = balance(grid, loads_all, nullptr, n_prts_by_patch);
+    n_prts_by_patch = balance(grid, loads, nullptr, n_prts_by_patch);
   }
 
   void operator()(Grid_t*& grid, MparticlesBase& mprts)
@@ -807,14 +1310,57 @@ struct Balance_
 
     psc_stats_start(st_time_balance);
     auto loads = get_loads_(mprts.grid(), mprts);
-    auto loads_all = psc::balance::gather_loads(*grid, loads);
-    balance(grid, loads_all, &mprts);
+    std::vector<double> bytes;
+    if (incremental_.max_bytes > 0.) {
+      bytes = get_bytes(mprts.grid(), mprts);
+    }
+    balance(grid, loads, &mprts, {}, bytes);
     psc_stats_stop(st_time_balance);
   }
 
 private:
-  int find_best_mapping(const Grid_t& grid,
-                        const std::vector<double>& loads_all)
+  static void free_cost()
+  {
+    delete[] psc_balance_comp_time_by_patch;
+    psc_balance_comp_time_by_patch = nullptr;
+    delete[] psc_balance_cost_by_patch;
+    psc_balance_cost_by_patch = nullptr;
+  }
+
+  // ----------------------------------------------------------------------
+  // get_bytes
+  //
+  // how much data needs to be sent to migrate each patch
+
+  std::vector<double> get_bytes(const Grid_t& grid, MparticlesBase& mprts)
+  {
+    double bytes_flds = 0.;
+    auto add_flds = [&](int n_comps, Int3 ibn, std::size_t element_size) {
+      Int3 im = grid.ldims + 2 * ibn;
+      bytes_flds += double(n_comps) * im[0] * im[1] * im[2] * element_size;
+    };
+    for (auto mf : MfieldsBase::instances) {
+      add_flds(mf->_n_comps(), mf->ibn(), mf->element_size());
+    }
+    // unless the state fields keep their data in an Mfields, which has
+    // been counted above
+    for (auto mf : MfieldsStateBase::instances) {
+      if (!mf->mfields_base()) {
+        add_flds(mf->_n_comps(), mf->ibn(), mf->element_size());
+      }
+    }
+
+    auto n_prts_by_patch = mprts.sizeByPatch();
+    std::vector<double> bytes;
+    bytes.reserve(n_prts_by_patch.size());
+    for (auto n_prts : n_prts_by_patch) {
+      bytes.push_back(bytes_flds + double(n_prts) * sizeof(Particle));
+    }
+    return bytes;
+  }
+
+  int find_best_mapping(const Grid_t& grid, const std::vector<double>& loads,
+                        const std::vector<double>& bytes)
   {
     const MrcDomain& domain = grid.mrc_domain_;
 
@@ -829,39 +1375,45 @@ private:
     MPI_Allgather(&nr_patches_old, 1, MPI_INT, nr_patches_all_old.data(), 1,
                   MPI_INT, comm);
 
-    int nr_patches_new;
+    // every proc gets the complete new mapping
+    std::vector<double> load_by_proc;
+    auto nr_patches_all_new =
+      psc::balance::best_mapping(comm, loads, &load_by_proc);
+    if (!bytes.empty()) {
+      nr_patches_all_new = psc::balance::incremental_mapping(
+        comm, loads, bytes, nr_patches_all_old, nr_patches_all_new,
+        incremental_, &load_by_proc);
+    }
 
-    if (rank == 0) { // do the mapping on proc 0
+    if (rank == 0) {
       std::vector<double> capability(size);
       for (int p = 0; p < size; p++) {
         capability[p] = capability_default(p);
       }
-
-      auto nr_patches_all_new =
-        psc::balance::best_mapping({capability, loads_all});
-      psc::balance::print_stats({capability, loads_all}, nr_patches_all_new,
+      psc::balance::print_stats(capability, load_by_proc, nr_patches_all_new,
                                 print_loads_);
-      if (write_loads_) {
+    }
+    if (write_loads_) {
+      // debugging only, this does collect all loads on proc 0
+      auto loads_all = psc::balance::gather_loads(grid, loads);
+      if (rank == 0) {
+        std::vector<double> capability(size, 1.);
         psc::balance::write_loads({capability, loads_all}, nr_patches_all_new,
                                   grid.timestep());
       }
+    }
 
-      if (nr_patches_all_new == nr_patches_all_old) {
-        std::fill(nr_patches_all_new.begin(), nr_patches_all_new.end(),
-                  -1); // unchanged mapping, no communication etc needed
-      }
-
-      MPI_Scatter(nr_patches_all_new.data(), 1, MPI_INT, &nr_patches_new, 1,
-                  MPI_INT, 0, comm);
-    } else {
-      MPI_Scatter(nullptr, 1, MPI_INT, &nr_patches_new, 1, MPI_INT, 0, comm);
+    if (nr_patches_all_new == nr_patches_all_old) {
+      return -1; // unchanged mapping, no communication etc needed
     }
-    return nr_patches_new;
+    return nr_patches_all_new[rank];
   }
 
-  std::vector<uint> balance(Grid_t*& gridp, std::vector<double> loads_all,
+  // with bytes (per patch) given, the mapping is changed incrementally
+  std::vector<uint> balance(Grid_t*& gridp, const std::vector<double>& loads,
                             MparticlesBase* mp,
-                            std::vector<uint> n_prts_by_patch_old = {})
+                            std::vector<uint> n_prts_by_patch_old = {},
+                            const std::vector<double>& bytes = {})
   {
     static int pr_bal_load, pr_bal_ctx, pr_bal_prts, pr_bal_flds;
     if (!pr_bal_load) {
@@ -873,7 +1425,7 @@ private:
 
     prof_start(pr_bal_load);
     auto old_grid = gridp;
-    int n_patches_new = find_best_mapping(*old_grid, loads_all);
+    int n_patches_new = find_best_mapping(*old_grid, loads, bytes);
     prof_stop(pr_bal_load);
 
     if (n_patches_new < 0) { // unchanged mapping, nothing tbd
@@ -889,13 +1441,24 @@ private:
     new_grid->ibn = old_grid->ibn; // FIXME, sucky ibn handling...
     new_grid->timestep_ = old_grid->timestep_;
 
-    delete[] psc_balance_comp_time_by_patch;
-    psc_balance_comp_time_by_patch = new double[new_grid->n_patches()];
-
     prof_start(pr_bal_ctx);
     communicate_ctx ctx(old_grid->mrc_domain(), new_grid->mrc_domain());
     prof_stop(pr_bal_ctx);
 
+    // the measured cost moves along with the patches
+    if (psc_balance_cost_by_patch) {
+      std::vector<double> cost_old(
+        psc_balance_cost_by_patch,
+        psc_balance_cost_by_patch + old_grid->n_patches());
+      auto cost_new = ctx.new_by_patch(cost_old, MPI_DOUBLE);
+      free_cost();
+      psc_balance_comp_time_by_patch = new double[new_grid->n_patches()]{};
+      psc_balance_cost_by_patch = new double[new_grid->n_patches()];
+      std::copy(cost_new.begin(), cost_new.end(), psc_balance_cost_by_patch);
+    } else if (psc_balance_comp_time_by_patch) {
+      free_cost();
+    }
+
     MEM_STATS();
     // copy particles to host, free on gpu
     Mparticles* p_mp_host = nullptr;
@@ -1020,6 +1583,16 @@ private:
     gridp = new_grid;
     psc_balance_generation_cnt++;
 
+    if (print_loads_) {
+      auto halo = psc::balance::get_halo_stats(*new_grid);
+      mpi_printf(new_grid->comm(),
+                 "***** Balance: %s curve, halo surface avg %g max %g, "
+                 "neighbor procs avg %g max %g\n",
+                 psc::grid::to_string(new_grid->domain.curve),
+                 halo.surface_avg, halo.surface_max, halo.n_neighbors_avg,
+                 halo.n_neighbors_max);
+    }
+
     return n_prts_by_patch_new;
   }
 
@@ -1028,4 +1601,6 @@ private:
   psc::balance::get_loads get_loads_;
   bool print_loads_;
   bool write_loads_;
+  double cost_alpha_;
+  psc::balance::incremental incremental_;
 };
@@ -8,6 +8,17 @@
 #include <mrc_profile.h>
 #include <mrc_ddc.h>
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+// ======================================================================
+// BndContext
+//
+// callbacks for mrc_ddc, packing / unpacking the halo slabs straight
+// from / to host fields
+
 template <typename S>
 struct BndContext
 {
@@ -86,12 +97,119 @@ public:
 template <typename S>
 constexpr mrc_ddc_funcs BndContext<S>::ddc_funcs;
 
+// ======================================================================
+// BndContextDevice
+//
+// same for fields that live on the device: each slab is gathered into a
+// contiguous device array and only that gets copied to / from the
+// (host) ddc buffer, so the data moved scales with the halo surface
+// rather than the whole field volume. The device array is kept in the
+// context and reused for all slabs, growing to the largest one.
+
+template <typename S>
+struct BndContextDevice
+{
+  using storage_type = S;
+  using real_t = typename storage_type::value_type;
+  using space_type = typename storage_type::space_type;
+
+  storage_type& mflds_gt;
+  const Int3& ib;
+  gt::gtensor<real_t, 1, space_type> d_staging;
+
+private:
+  static auto slab(BndContextDevice* ctx, int mb, int me, int p, int ilo[3],
+                   int ihi[3])
+  {
+    const Int3& ib = ctx->ib;
+    return ctx->mflds_gt.view(_s(ilo[0] - ib[0], ihi[0] - ib[0]),
+                              _s(ilo[1] - ib[1], ihi[1] - ib[1]),
+                              _s(ilo[2] - ib[2], ihi[2] - ib[2]), _s(mb, me),
+                              p);
+  }
+
+  static auto slab_shape(int mb, int me, int ilo[3], int ihi[3])
+  {
+    return gt::shape(ihi[0] - ilo[0], ihi[1] - ilo[1], ihi[2] - ilo[2],
+                     me - mb);
+  }
+
+  // the staging array, viewed as a slab of the given shape
+  static auto staging(BndContextDevice* ctx, const gt::shape_type<4>& shape)
+  {
+    auto size = shape[0] * shape[1] * shape[2] * shape[3];
+    if (ctx->d_staging.size() < size) {
+      ctx->d_staging = gt::gtensor<real_t, 1, space_type>(gt::shape(size));
+    }
+    return gt::adapt_device<4>(ctx->d_staging.data().get(), shape);
+  }
+
+  static void copy_to_buf(int mb, int me, int p, int ilo[3], int ihi[3],
+                          void* _buf, void* _ctx)
+  {
+    auto ctx = static_cast<BndContextDevice*>(_ctx);
+    auto shape = slab_shape(mb, me, ilo, ihi);
+    auto d_buf = staging(ctx, shape);
+    d_buf.view() = slab(ctx, mb, me, p, ilo, ihi);
+    auto h_buf = gt::adapt<4>(static_cast<real_t*>(_buf), shape);
+    gt::copy(d_buf, h_buf);
+  }
+
+  static void add_from_buf(int mb, int me, int p, int ilo[3], int ihi[3],
+                           void* _buf, void* _ctx)
+  {
+    auto ctx = static_cast<BndContextDevice*>(_ctx);
+    auto shape = slab_shape(mb, me, ilo, ihi);
+    auto d_buf = staging(ctx, shape);
+    gt::copy(gt::adapt<4>(static_cast<real_t*>(_buf), shape), d_buf);
+    auto&& s = slab(ctx, mb, me, p, ilo, ihi);
+    s = s + d_buf;
+  }
+
+  static void copy_from_buf(int mb, int me, int p, int ilo[3], int ihi[3],
+                            void* _buf, void* _ctx)
+  {
+    auto ctx = static_cast<BndContextDevice*>(_ctx);
+    auto shape = slab_shape(mb, me, ilo, ihi);
+    auto d_buf = staging(ctx, shape);
+    gt::copy(gt::adapt<4>(static_cast<real_t*>(_buf), shape), d_buf);
+    slab(ctx, mb, me, p, ilo, ihi) = d_buf;
+  }
+
+public:
+  constexpr static mrc_ddc_funcs ddc_funcs = {
+    .copy_to_buf = copy_to_buf,
+    .copy_from_buf = copy_from_buf,
+    .add_from_buf = add_from_buf,
+  };
+};
+
+template <typename S>
+constexpr mrc_ddc_funcs BndContextDevice<S>::ddc_funcs;
+
+// ----------------------------------------------------------------------
+// make_BndContext
+//
+// picks the host or device flavor depending on where the fields live
+
 template <typename E>
-auto make_BndContext(E& mflds_gt, const Int3& ib)
+auto make_BndContext(E& mflds_gt, const Int3& ib,
+                     std::enable_if_t<std::is_same<typename E::space_type,
+                                                   gt::space::host>::value,
+                                      int> = 0)
 {
   return BndContext<E>{mflds_gt, ib};
 }
 
+template <typename E>
+auto make_BndContext(E& mflds_gt, const Int3& ib,
+                     std::enable_if_t<!std::is_same<typename E::space_type,
+                                                    gt::space::host>::value,
+                                      int> = 0)
+{
+  return BndContextDevice<E>{mflds_gt, ib};
+}
+
 struct Bnd_ : BndBase
 {
   // ----------------------------------------------------------------------
@@ -112,14 +230,11 @@ struct Bnd_ : BndBase
     assert(Int3(mflds_gt.shape(0), mflds_gt.shape(1), mflds_gt.shape(2)) ==
            grid.ldims + 2 * grid.ibn);
 
-    auto&& h_mflds_gt = gt::host_mirror(mflds_gt);
-    gt::copy(mflds_gt, h_mflds_gt);
-    auto ctx = make_BndContext(h_mflds_gt, ib);
+    auto ctx = make_BndContext(mflds_gt, ib);
     mrc_ddc_set_param_int(grid.ddc(), "size_of_type",
                           sizeof(typename S::value_type));
     mrc_ddc_set_funcs(grid.ddc(), const_cast<mrc_ddc_funcs*>(&ctx.ddc_funcs));
     mrc_ddc_add_ghosts(grid.ddc(), mb, me, &ctx);
-    gt::copy(h_mflds_gt, mflds_gt);
   }
 
   template <typename Mfields>
@@ -141,14 +256,11 @@ struct Bnd_ : BndBase
     assert(Int3(mflds_gt.shape(0), mflds_gt.shape(1), mflds_gt.shape(2)) ==
            grid.ldims + 2 * grid.ibn);
 
-    auto&& h_mflds_gt = gt::host_mirror(mflds_gt);
-    gt::copy(mflds_gt, h_mflds_gt);
-    auto ctx = make_BndContext(h_mflds_gt, ib);
+    auto ctx = make_BndContext(mflds_gt, ib);
     mrc_ddc_set_param_int(grid.ddc(), "size_of_type",
                           sizeof(typename S::value_type));
     mrc_ddc_set_funcs(grid.ddc(), const_cast<mrc_ddc_funcs*>(&ctx.ddc_funcs));
     mrc_ddc_fill_ghosts(grid.ddc(), mb, me, &ctx);
-    gt::copy(h_mflds_gt, mflds_gt);
   }
 
   template <typename Mfields>
@@ -156,4 +268,125 @@ struct Bnd_ : BndBase
   {
     fill_ghosts(mflds.grid(), mflds.storage(), mflds.ib(), mb, me);
   }
+
+  // ----------------------------------------------------------------------
+  // fill_ghosts, narrow
+  //
+  // like fill_ghosts(), but only fills the first `n_ghosts` layers of ghost
+  // points, for when the stencil that's applied next doesn't need all of
+  // them. That means less to pack and send.
+
+  template <typename S>
+  void fill_ghosts(const Grid_t& grid, S& mflds_gt, const Int3& ib, int mb,
+                   int me, int n_ghosts)
+  {
+    assert(Int3(mflds_gt.shape(0), mflds_gt.shape(1), mflds_gt.shape(2)) ==
+           grid.ldims + 2 * grid.ibn);
+
+    mrc_ddc* ddc = narrow_ddc(grid, n_ghosts);
+    auto ctx = make_BndContext(mflds_gt, ib);
+    mrc_ddc_set_param_int(ddc, "size_of_type", sizeof(typename S::value_type));
+    mrc_ddc_set_funcs(ddc, const_cast<mrc_ddc_funcs*>(&ctx.ddc_funcs));
+    mrc_ddc_fill_ghosts(ddc, mb, me, &ctx);
+  }
+
+  // ----------------------------------------------------------------------
+  // fill_ghosts_begin / fill_ghosts_end
+  //
+  // split version of fill_ghosts(): begin() posts the messages and does
+  // the on-rank copies, end() waits for and unpacks the messages from other
+  // ranks. In between, the interior of the fields may be read and
+  // updated, as end() only writes ghost points, but the ghost points
+  // aren't valid yet. Only one fill may be in flight at a time.
+
+  template <typename S>
+  void fill_ghosts_begin(const Grid_t& grid, S& mflds_gt, const Int3& ib,
+                         int mb, int me)
+  {
+    assert(!pending_end_);
+    assert(Int3(mflds_gt.shape(0), mflds_gt.shape(1), mflds_gt.shape(2)) ==
+           grid.ldims + 2 * grid.ibn);
+
+    // the context needs to stay around until the end
+    using Ctx = decltype(make_BndContext(mflds_gt, ib));
+    struct Pending
+    {
+      Pending(S& mflds_gt, const Int3& ib) : ib{ib}, ctx{mflds_gt, this->ib} {}
+
+      Int3 ib;
+      Ctx ctx;
+    };
+    auto pending = std::make_shared<Pending>(mflds_gt, ib);
+
+    mrc_ddc_set_param_int(grid.ddc(), "size_of_type",
+                          sizeof(typename S::value_type));
+    mrc_ddc_set_funcs(grid.ddc(),
+                      const_cast<mrc_ddc_funcs*>(&pending->ctx.ddc_funcs));
+    mrc_ddc_fill_ghosts_begin(grid.ddc(), mb, me, &pending->ctx);
+    mrc_ddc_fill_ghosts_local(grid.ddc(), mb, me, &pending->ctx);
+
+    pending_end_ = [&grid, mb, me, pending]() {
+      mrc_ddc_set_param_int(grid.ddc(), "size_of_type",
+                            sizeof(typename S::value_type));
+      mrc_ddc_set_funcs(grid.ddc(),
+                        const_cast<mrc_ddc_funcs*>(&pending->ctx.ddc_funcs));
+      mrc_ddc_fill_ghosts_end(grid.ddc(), mb, me, &pending->ctx);
+    };
+  }
+
+  template <typename Mfields>
+  void fill_ghosts_begin(Mfields& mflds, int mb, int me)
+  {
+    fill_ghosts_begin(mflds.grid(), mflds.storage(), mflds.ib(), mb, me);
+  }
+
+  void fill_ghosts_end()
+  {
+    assert(pending_end_);
+    pending_end_();
+    pending_end_ = nullptr;
+  }
+
+  template <typename Mfields>
+  void fill_ghosts_end(Mfields& mflds, int mb, int me)
+  {
+    fill_ghosts_end();
+  }
+
+private:
+  // ----------------------------------------------------------------------
+  // narrow_ddc
+  //
+  // a ddc like grid.ddc(), but for at most `n_ghosts` ghost layers. It's
+  // kept around until the grid / decomposition changes.
+
+  mrc_ddc* narrow_ddc(const Grid_t& grid, int n_ghosts)
+  {
+    Int3 ibn;
+    for (int d = 0; d < 3; d++) {
+      ibn[d] = std::min(n_ghosts, grid.ibn[d]);
+    }
+    if (ibn == grid.ibn) {
+      return grid.ddc();
+    }
+
+    if (!narrow_ddc_ || ibn != narrow_ibn_ || &grid != narrow_grid_ ||
+        narrow_generation_ != psc_balance_generation_cnt) {
+      mrc_ddc* ddc = grid.create_ddc();
+      mrc_ddc_set_param_int3(ddc, "ibn", ibn);
+      mrc_ddc_set_param_int(ddc, "max_n_fields", 24);
+      mrc_ddc_setup(ddc);
+      narrow_ddc_.reset(ddc, mrc_ddc_destroy);
+      narrow_ibn_ = ibn;
+      narrow_grid_ = &grid;
+      narrow_generation_ = psc_balance_generation_cnt;
+    }
+    return narrow_ddc_.get();
+  }
+
+  std::function<void()> pending_end_;
+  std::shared_ptr<mrc_ddc> narrow_ddc_;
+  Int3 narrow_ibn_;
+  const Grid_t* narrow_grid_ = nullptr;
+  int narrow_generation_ = -1;
 };
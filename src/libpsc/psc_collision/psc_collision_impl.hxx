@@ -5,7 +5,9 @@
 #include "binary_collision.hxx"
 #include "fields.hxx"
 #include "fields3d.hxx"
+#include "scratch_arena.hxx"
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 
@@ -40,9 +42,15 @@ struct CollisionHost
     real_t s[NR_STATS];
   };
 
-  CollisionHost(const Grid_t& grid, int interval, double nu)
+  // stats_interval: how often (in steps) mflds_stats_ and mflds_rei_ get
+  // updated, 0 for never. Collision steps in between skip gathering them,
+  // and leave them zeroed rather than holding stats from an earlier step.
+
+  CollisionHost(const Grid_t& grid, int interval, double nu,
+                int stats_interval = 1)
     : interval_{interval},
       nu_{nu},
+      stats_interval_{stats_interval},
       mflds_stats_{grid, NR_STATS, grid.ibn},
       mflds_rei_{grid, NR_STATS, grid.ibn}
   {
@@ -52,92 +60,89 @@ struct CollisionHost
 
   // ----------------------------------------------------------------------
   // collide
+  //
+  // Once the particles are sorted by cell, the cells are independent, so
+  // they're processed in parallel, each thread using its own scratch arena
+  // and each cell its own random numbers.
 
   void operator()(Mparticles& mprts)
   {
     auto& grid = mprts.grid();
+    auto& arena = psc::ScratchArena::get();
+    bool do_stats =
+      stats_interval_ > 0 && grid.timestep() % stats_interval_ == 0;
+    uint32_t timestep = grid.timestep();
+
+    if (!do_stats && have_stats_) {
+      mflds_stats_.storage().view(_all, _all, _all, _all, _all) =
+        typename Mfields::Real{};
+      mflds_rei_.storage().view(_all, _all, _all, _all, _all) =
+        typename Mfields::Real{};
+    }
+    have_stats_ = do_stats;
 
     for (int p = 0; p < mprts.n_patches(); p++) {
+      PatchTimer timer(p);
+      psc::ScratchArena::Scope scope(arena);
       auto prts = mprts[p];
 
-      const int* ldims = grid.ldims;
+      Int3 ldims = grid.ldims;
       int nr_cells = ldims[0] * ldims[1] * ldims[2];
-      int* offsets = (int*)calloc(nr_cells + 1, sizeof(*offsets));
-      struct psc_collision_stats stats_total = {};
+      int* offsets = arena.calloc<int>(nr_cells + 1);
 
       find_cell_offsets(prts, offsets);
 
       auto F = make_Fields3d<dim_xyz>(mflds_stats_[p]);
-      grid.Foreach_3d(0, 0, [&](int ix, int iy, int iz) {
-        int c = (iz * ldims[1] + iy) * ldims[0] + ix;
-
-        update_rei_before(prts, offsets[c], offsets[c + 1], p, ix, iy, iz);
+      const auto& gdims = grid.domain.gdims;
+      const auto& off = grid.patches[p].off;
+#pragma omp parallel for schedule(dynamic, 64)
+      for (int c = 0; c < nr_cells; c++) {
+        int ix = c % ldims[0];
+        int iy = (c / ldims[0]) % ldims[1];
+        int iz = c / (ldims[0] * ldims[1]);
+        uint64_t c_global =
+          (uint64_t(iz + off[2]) * gdims[1] + (iy + off[1])) * gdims[0] +
+          (ix + off[0]);
+        Rng rng{c_global, RNG_STREAM_COLLISION, timestep};
+
+        if (do_stats) {
+          update_rei_before(prts, offsets[c], offsets[c + 1], p, ix, iy, iz);
+        }
 
         struct psc_collision_stats stats = {};
-        // mprintf("p %d ijk %d:%d:%d # %d\n", p, ix, iy, iz, offsets[c+1] -
-        // offsets[c]);
-        auto permute = randomize_in_cell(offsets[c], offsets[c + 1]);
-        collide_in_cell(prts, permute, &stats);
-
-        update_rei_after(prts, offsets[c], offsets[c + 1], p, ix, iy, iz);
-
-        for (int s = 0; s < NR_STATS; s++) {
-          F(s, ix, iy, iz) = stats.s[s];
-          stats_total.s[s] += stats.s[s];
+        auto& cell_arena = psc::ScratchArena::get();
+        psc::ScratchArena::Scope cell_scope(cell_arena);
+        int nn = offsets[c + 1] - offsets[c];
+        int* permute = cell_arena.alloc<int>(nn);
+        randomize_in_cell(offsets[c], offsets[c + 1], permute, rng);
+        collide_in_cell(prts, permute, nn, do_stats ? &stats : nullptr, rng);
+
+        if (do_stats) {
+          update_rei_after(prts, offsets[c], offsets[c + 1], p, ix, iy, iz);
+          for (int s = 0; s < NR_STATS; s++) {
+            F(s, ix, iy, iz) = stats.s[s];
+          }
         }
-      });
-
-#if 0
-      mprintf("p%d: min %g med %g max %g nlarge %g ncoll %g\n", p,
-	      stats_total.s[STATS_MIN] / nr_cells,
-	      stats_total.s[STATS_MED] / nr_cells,
-	      stats_total.s[STATS_MAX] / nr_cells,
-	      stats_total.s[STATS_NLARGE] / nr_cells,
-	      stats_total.s[STATS_NCOLL] / nr_cells);
-#endif
-
-      free(offsets);
+      }
     }
   }
 
   // ----------------------------------------------------------------------
   // calc_stats
-
-  static int compare(const void* _a, const void* _b)
-  {
-    const real_t* a = (const real_t*)_a;
-    const real_t* b = (const real_t*)_b;
-
-    if (*a < *b) {
-      return -1;
-    } else if (*a > *b) {
-      return 1;
-    } else {
-      return 0;
-    }
-  }
+  //
+  // reorders nudts
 
   static void calc_stats(struct psc_collision_stats* stats, real_t* nudts,
                          int cnt)
   {
-    qsort(nudts, cnt, sizeof(*nudts), compare);
-    stats->s[STATS_NLARGE] = 0;
-    for (int n = cnt - 1; n >= 0; n--) {
-      if (nudts[n] < 1.) {
-        break;
-      }
-      stats->s[STATS_NLARGE]++;
-    }
-    stats->s[STATS_MIN] = nudts[0];
-    stats->s[STATS_MAX] = nudts[cnt - 1];
+    auto minmax = std::minmax_element(nudts, nudts + cnt);
+    stats->s[STATS_MIN] = *minmax.first;
+    stats->s[STATS_MAX] = *minmax.second;
+    stats->s[STATS_NLARGE] = std::count_if(
+      nudts, nudts + cnt, [](real_t nudt) { return nudt >= real_t(1.); });
+    std::nth_element(nudts, nudts + cnt / 2, nudts + cnt);
     stats->s[STATS_MED] = nudts[cnt / 2];
     stats->s[STATS_NCOLL] = cnt;
-    /* mprintf("min %g med %g max %g nlarge %g ncoll %g\n", */
-    /* 	  stats->s[STATS_MIN], */
-    /* 	  stats->s[STATS_MED], */
-    /* 	  stats->s[STATS_MAX], */
-    /* 	  stats->s[STATS_NLARGE], */
-    /* 	  stats->s[STATS_NCOLL]); */
   }
 
   // ----------------------------------------------------------------------
@@ -163,13 +168,19 @@ struct CollisionHost
 
   // ----------------------------------------------------------------------
   // randomize_in_cell
+  //
+  // fill `permute` with a random permutation of [n_start, n_end)
 
-  static std::vector<int> randomize_in_cell(int n_start, int n_end)
+  static void randomize_in_cell(int n_start, int n_end, int* permute,
+                                Rng& rng)
   {
-    std::vector<int> permute(n_end - n_start);
-    std::iota(permute.begin(), permute.end(), n_start);
-    std::random_shuffle(permute.begin(), permute.end());
-    return permute;
+    int nn = n_end - n_start;
+    std::iota(permute, permute + nn, n_start);
+    // Fisher-Yates
+    for (int i = nn - 1; i > 0; i--) {
+      int j = std::min(int(rng.uniform() * (i + 1)), i);
+      std::swap(permute[i], permute[j]);
+    }
   }
 
   // ----------------------------------------------------------------------
@@ -216,12 +227,13 @@ struct CollisionHost
 
   // ----------------------------------------------------------------------
   // collide_in_cell
+  //
+  // stats may be nullptr if they're not needed
 
-  void collide_in_cell(Particles& prts, const std::vector<int>& permute,
-                       struct psc_collision_stats* stats)
+  void collide_in_cell(Particles& prts, const int* permute, int nn,
+                       struct psc_collision_stats* stats, Rng& rng)
   {
     const auto& grid = prts.grid();
-    int nn = permute.size();
 
     if (nn < 2) { // can't collide only one (or zero) particles
       return;
@@ -232,27 +244,34 @@ struct CollisionHost
     real_t wni = mprts.prt_w(prts[permute[0]]);
     real_t nudt1 = wni * grid.norm.cori * nn * this->interval_ * grid.dt * nu_;
 
-    real_t* nudts = (real_t*)malloc((nn / 2 + 2) * sizeof(*nudts));
+    // only keep track of the nudts if we need the stats
+    real_t* nudts =
+      stats ? psc::ScratchArena::get().alloc<real_t>(nn / 2 + 2) : nullptr;
     int cnt = 0;
+    auto record = [&](real_t nudt) {
+      if (stats) {
+        nudts[cnt++] = nudt;
+      }
+    };
 
     int n = 0;
     if (nn % 2 == 1) { // odd # of particles: do 3-collision
-      nudts[cnt++] = do_bc(prts, permute[0], permute[1], .5 * nudt1);
-      nudts[cnt++] = do_bc(prts, permute[0], permute[2], .5 * nudt1);
-      nudts[cnt++] = do_bc(prts, permute[1], permute[2], .5 * nudt1);
+      record(do_bc(prts, permute[0], permute[1], .5 * nudt1, rng));
+      record(do_bc(prts, permute[0], permute[2], .5 * nudt1, rng));
+      record(do_bc(prts, permute[1], permute[2], .5 * nudt1, rng));
       n = 3;
     }
     for (; n < nn; n += 2) { // do remaining particles as pair
-      nudts[cnt++] = do_bc(prts, permute[n], permute[n + 1], nudt1);
+      record(do_bc(prts, permute[n], permute[n + 1], nudt1, rng));
     }
 
-    calc_stats(stats, nudts, cnt);
-    free(nudts);
+    if (stats) {
+      calc_stats(stats, nudts, cnt);
+    }
   }
 
-  real_t do_bc(Particles& prts, int n1, int n2, real_t nudt1)
+  real_t do_bc(Particles& prts, int n1, int n2, real_t nudt1, Rng& rng)
   {
-    Rng rng;
     const auto& mprts = prts.mprts();
     BinaryCollision<Mparticles, Particle> bc(mprts);
     return bc(prts[n1], prts[n2], nudt1, rng);
@@ -264,6 +283,8 @@ private:
   // parameters
   double nu_;
   int interval_;
+  int stats_interval_;
+  bool have_stats_ = false;
 
 public: // FIXME
   // for output
@@ -273,4 +294,4 @@ public: // FIXME
 
 template <typename _Mparticles, typename _MfieldsState, typename _Mfields>
 using Collision_ = CollisionHost<_Mparticles, _MfieldsState, _Mfields,
-                                 RngC<typename _Mparticles::real_t>>;
+                                 RngPhilox<typename _Mparticles::real_t>>;
@@ -1,5 +1,7 @@
 
 #include "heating.hxx"
+#include "psc_bits.h"
+#include "rng_philox.hxx"
 
 #include <functional>
 #include <stdlib.h>
@@ -26,22 +28,12 @@ struct Heating__ : HeatingBase
   // ----------------------------------------------------------------------
   // kick_particle
 
-  void kick_particle(Particle& prt, real_t H)
+  template <typename Rng>
+  void kick_particle(Particle& prt, real_t H, Rng& rng)
   {
-    float ran1, ran2, ran3, ran4, ran5, ran6;
-    do {
-      ran1 = random() / ((float)RAND_MAX + 1);
-      ran2 = random() / ((float)RAND_MAX + 1);
-      ran3 = random() / ((float)RAND_MAX + 1);
-      ran4 = random() / ((float)RAND_MAX + 1);
-      ran5 = random() / ((float)RAND_MAX + 1);
-      ran6 = random() / ((float)RAND_MAX + 1);
-    } while (ran1 >= 1.f || ran2 >= 1.f || ran3 >= 1.f || ran4 >= 1.f ||
-             ran5 >= 1.f || ran6 >= 1.f);
-
-    real_t ranx = sqrtf(-2.f * logf(1.0 - ran1)) * cosf(2.f * M_PI * ran2);
-    real_t rany = sqrtf(-2.f * logf(1.0 - ran3)) * cosf(2.f * M_PI * ran4);
-    real_t ranz = sqrtf(-2.f * logf(1.0 - ran5)) * cosf(2.f * M_PI * ran6);
+    real_t ranx = rng.normal();
+    real_t rany = rng.normal();
+    real_t ranz = rng.normal();
 
     real_t Dpxi = sqrtf(H * heating_dt_);
     real_t Dpyi = sqrtf(H * heating_dt_);
@@ -52,13 +44,23 @@ struct Heating__ : HeatingBase
     prt.u[2] += Dpzi * ranz;
   }
 
+  // The random numbers for each particle are keyed by its global cell
+  // and its index in the patch, so the kicks don't depend on the order
+  // the patches are processed in, and patches can go in parallel.
+
   void operator()(Mparticles& mprts)
   {
+    const auto& grid = mprts.grid();
+    const auto& gdims = grid.domain.gdims;
+    uint32_t timestep = grid.timestep();
+
+#pragma omp parallel for
     for (int p = 0; p < mprts.n_patches(); p++) {
+      PatchTimer timer(p);
       auto&& prts = mprts[p];
-      auto& patch = mprts.grid().patches[p];
+      auto& patch = grid.patches[p];
+      uint32_t n = 0;
       for (auto& prt : prts) {
-
         double xx[3] = {
           prt.x[0] + patch.xb[0],
           prt.x[1] + patch.xb[1],
@@ -66,8 +68,16 @@ struct Heating__ : HeatingBase
         };
         double H = get_H_(xx, prt.kind);
         if (H > 0.f) {
-          kick_particle(prt, H);
+          Int3 idx;
+          for (int d = 0; d < 3; d++) {
+            idx[d] = patch.off[d] + fint(prt.x[d] / grid.domain.dx[d]);
+          }
+          uint64_t c_global =
+            (uint64_t(idx[2]) * gdims[1] + idx[1]) * gdims[0] + idx[0];
+          RngPhilox<real_t> rng{c_global, RNG_STREAM_HEATING, timestep, n};
+          kick_particle(prt, H, rng);
         }
+        n++;
       }
     }
   }
@@ -61,15 +61,17 @@ Int3 getBnd(const E& flds, const Grid_t& grid)
 
 // ======================================================================
 // div_nc
+//
+// The version taking `res` writes the result into existing storage (of
+// shape ldims x 1 x n_patches), rather than allocating it.
 
-template <typename E>
-static auto div_nc(const Grid_t& grid, const E& flds)
+template <typename E, typename R>
+static void div_nc(const Grid_t& grid, const E& flds, R&& res)
 {
   Int3 bnd = getBnd(flds, grid);
   auto dxyz = grid.domain.dx;
 
-  auto res = gt::full<gt::expr_value_type<E>, gt::expr_space_type<E>>(
-    {grid.ldims[0], grid.ldims[1], grid.ldims[2], 1, grid.n_patches()}, 0);
+  res.view(_all, _all, _all, 0) = 0.;
 
   // initial values for slices
   gt::gslice trims[3] = {_all, _all, _all};
@@ -99,7 +101,14 @@ static auto div_nc(const Grid_t& grid, const E& flds)
           dxyz[a];
     }
   }
+}
 
+template <typename E>
+static auto div_nc(const Grid_t& grid, const E& flds)
+{
+  auto res = gt::empty<gt::expr_value_type<E>, gt::expr_space_type<E>>(
+    {grid.ldims[0], grid.ldims[1], grid.ldims[2], 1, grid.n_patches()});
+  div_nc(grid, flds, res);
   return res;
 }
 
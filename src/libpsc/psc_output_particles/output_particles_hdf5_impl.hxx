@@ -5,6 +5,11 @@
 #include <hdf5.h>
 #include <hdf5_hl.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "io_thread.hxx"
 #include "output_particles.hxx"
 
 #include "psc_particles_single.h"
@@ -88,8 +93,27 @@ private:
   hid_t id_;
 };
 
+// ======================================================================
+// Hdf5ParticleChunk
+//
+// what one writing rank puts into the file: a contiguous range of the
+// particles, and, on rank 0, the global per-cell index
+
+struct Hdf5ParticleChunk
+{
+  std::vector<hdf5_prt> prts;
+  size_t n_off = 0; // where `prts` go in the file
+  size_t n_total = 0;
+  std::vector<size_t> gidx_begin; // rank 0 only
+  std::vector<size_t> gidx_end;
+};
+
 // ======================================================================
 // OutputParticlesHdf5
+//
+// collects the particles to be written, sorted by cell and kind, into a
+// Hdf5ParticleChunk on every rank, or, if aggregating (`node_comm` is set),
+// on the first rank of every node
 
 template <typename Mparticles>
 struct OutputParticlesHdf5
@@ -97,13 +121,14 @@ struct OutputParticlesHdf5
   using Particles = typename Mparticles::Patch;
 
   OutputParticlesHdf5(const Grid_t& grid, const Int3& lo, const Int3& hi,
-                      const Int3& wdims, hid_t prt_type)
+                      const Int3& wdims, MPI_Comm node_comm, MPI_Comm io_comm)
     : lo_{lo},
       hi_{hi},
       wdims_{wdims},
       kinds_{grid.kinds},
       comm_{grid.comm()},
-      prt_type_{prt_type}
+      node_comm_{node_comm},
+      io_comm_{io_comm}
   {}
 
   // ----------------------------------------------------------------------
@@ -196,12 +221,53 @@ struct OutputParticlesHdf5
     return kinds_.size() * ld[0] * ld[1] * ld[2];
   }
 
+  // ----------------------------------------------------------------------
+  // find_offsets
+  //
+  // where this rank's particles go in the file. When aggregating, each
+  // node's particles need to end up in one contiguous range, ordered by
+  // rank within the node.
+
+  void find_offsets(size_t n_write, size_t* p_n_off, size_t* p_n_total)
+  {
+    assert(sizeof(size_t) == sizeof(unsigned long));
+    size_t n_total, n_off = 0;
+    if (node_comm_ == MPI_COMM_NULL) {
+      MPI_Allreduce(&n_write, &n_total, 1, MPI_LONG, MPI_SUM, comm_);
+      MPI_Exscan(&n_write, &n_off, 1, MPI_LONG, MPI_SUM, comm_);
+    } else {
+      int node_rank;
+      MPI_Comm_rank(node_comm_, &node_rank);
+      size_t n_node = 0, n_off_in_node = 0;
+      MPI_Reduce(&n_write, &n_node, 1, MPI_LONG, MPI_SUM, 0, node_comm_);
+      MPI_Exscan(&n_write, &n_off_in_node, 1, MPI_LONG, MPI_SUM, node_comm_);
+
+      size_t node[2] = {}; // offset of this node's particles, total
+      if (node_rank == 0) {
+        int io_rank;
+        MPI_Comm_rank(io_comm_, &io_rank);
+        n_off_in_node = 0;
+        MPI_Exscan(&n_node, &node[0], 1, MPI_LONG, MPI_SUM, io_comm_);
+        MPI_Allreduce(&n_node, &node[1], 1, MPI_LONG, MPI_SUM, io_comm_);
+        if (io_rank == 0) {
+          node[0] = 0;
+        }
+      }
+      MPI_Bcast(node, 2, MPI_LONG, 0, node_comm_);
+      n_off = node[0] + n_off_in_node;
+      n_total = node[1];
+    }
+    *p_n_off = n_off;
+    *p_n_total = n_total;
+  }
+
   // ----------------------------------------------------------------------
   // make_local_particle_array
 
-  hdf5_prt* make_local_particle_array(Mparticles& mprts, int** off, int** map,
-                                      size_t** idx, size_t* p_n_write,
-                                      size_t* p_n_off, size_t* p_n_total)
+  std::vector<hdf5_prt> make_local_particle_array(Mparticles& mprts, int** off,
+                                                  int** map, size_t** idx,
+                                                  size_t* p_n_off,
+                                                  size_t* p_n_total)
   {
     const auto& grid = mprts.grid();
     int nr_kinds = grid.kinds.size();
@@ -225,12 +291,10 @@ struct OutputParticlesHdf5
       }
     }
 
-    assert(sizeof(size_t) == sizeof(unsigned long));
-    size_t n_total, n_off = 0;
-    MPI_Allreduce(&n_write, &n_total, 1, MPI_LONG, MPI_SUM, comm_);
-    MPI_Exscan(&n_write, &n_off, 1, MPI_LONG, MPI_SUM, comm_);
+    size_t n_off, n_total;
+    find_offsets(n_write, &n_off, &n_total);
 
-    struct hdf5_prt* arr = (struct hdf5_prt*)malloc(n_write * sizeof(*arr));
+    std::vector<hdf5_prt> arr(n_write);
 
     // copy particles to be written into temp array
     int nn = 0;
@@ -274,153 +338,34 @@ struct OutputParticlesHdf5
         }
       }
     }
-    *p_n_write = n_write;
     *p_n_off = n_off;
     *p_n_total = n_total;
     return arr;
   }
 
-  void write_particles(size_t n_write, size_t n_off, size_t n_total,
-                       hdf5_prt* arr, hid_t group, hid_t dxpl)
-  {
-    herr_t ierr;
-
-    hsize_t mdims[1] = {n_write};
-    hsize_t fdims[1] = {n_total};
-    hsize_t foff[1] = {n_off};
-    hid_t memspace = H5Screate_simple(1, mdims, NULL);
-    H5_CHK(memspace);
-    hid_t filespace = H5Screate_simple(1, fdims, NULL);
-    H5_CHK(filespace);
-    ierr =
-      H5Sselect_hyperslab(filespace, H5S_SELECT_SET, foff, NULL, mdims, NULL);
-    CE;
-
-    hid_t dset = H5Dcreate(group, "1d", prt_type_, filespace, H5P_DEFAULT,
-                           H5P_DEFAULT, H5P_DEFAULT);
-    H5_CHK(dset);
-    ierr = H5Dwrite(dset, prt_type_, memspace, filespace, dxpl, arr);
-    CE;
-
-    ierr = H5Dclose(dset);
-    CE;
-    ierr = H5Sclose(filespace);
-    CE;
-    ierr = H5Sclose(memspace);
-    CE;
-  }
-
-  void write_idx(size_t* gidx_begin, size_t* gidx_end, hid_t group, hid_t dxpl)
-  {
-    herr_t ierr;
-
-    hsize_t fdims[4];
-    fdims[0] = kinds_.size();
-    fdims[1] = wdims_[2];
-    fdims[2] = wdims_[1];
-    fdims[3] = wdims_[0];
-    hid_t filespace = H5Screate_simple(4, fdims, NULL);
-    H5_CHK(filespace);
-    hid_t memspace;
-
-    assert(sizeof(size_t) == sizeof(hsize_t));
-    int rank;
-    MPI_Comm_rank(comm_, &rank);
-    if (rank == 0) {
-      memspace = H5Screate_simple(4, fdims, NULL);
-      H5_CHK(memspace);
-    } else {
-      memspace = H5Screate(H5S_NULL);
-      H5Sselect_none(memspace);
-      H5Sselect_none(filespace);
-    }
-
-    hid_t dset = H5Dcreate(group, "idx_begin", H5T_NATIVE_HSIZE, filespace,
-                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    H5_CHK(dset);
-    ierr =
-      H5Dwrite(dset, H5T_NATIVE_HSIZE, memspace, filespace, dxpl, gidx_begin);
-    CE;
-    ierr = H5Dclose(dset);
-    CE;
-
-    dset = H5Dcreate(group, "idx_end", H5T_NATIVE_HSIZE, filespace, H5P_DEFAULT,
-                     H5P_DEFAULT, H5P_DEFAULT);
-    H5_CHK(dset);
-    ierr =
-      H5Dwrite(dset, H5T_NATIVE_HSIZE, memspace, filespace, dxpl, gidx_end);
-    CE;
-    ierr = H5Dclose(dset);
-    CE;
-
-    ierr = H5Sclose(filespace);
-    CE;
-    ierr = H5Sclose(memspace);
-    CE;
-  }
-
   // ----------------------------------------------------------------------
-  // operator()
+  // gather_idx
+  //
+  // assemble the global per-cell index on rank 0
 
-  void operator()(Mparticles& mprts, const std::string& filename,
-                  const OutputParticlesParams& params)
+  void gather_idx(Mparticles& mprts, size_t** idx, Hdf5ParticleChunk& chunk)
   {
     const auto& grid = mprts.grid();
-    herr_t ierr;
-
-    static int pr_A, pr_B, pr_C, pr_D, pr_E;
-    if (!pr_A) {
-      pr_A = prof_register("outp: local", 1., 0, 0);
-      pr_B = prof_register("outp: comm", 1., 0, 0);
-      pr_C = prof_register("outp: write prep", 1., 0, 0);
-      pr_D = prof_register("outp: write idx", 1., 0, 0);
-      pr_E = prof_register("outp: write prts", 1., 0, 0);
-    }
+    int nr_kinds = grid.kinds.size();
+    struct mrc_patch_info info;
 
-    prof_start(pr_A);
     int rank, size;
     MPI_Comm_rank(comm_, &rank);
     MPI_Comm_size(comm_, &size);
 
-    struct mrc_patch_info info;
-    int nr_kinds = mprts.grid().kinds.size();
-
-    int** off = (int**)malloc(mprts.n_patches() * sizeof(*off));
-    int** map = (int**)malloc(mprts.n_patches() * sizeof(*off));
-
-    count_sort(mprts, map, off);
-
-    size_t** idx = (size_t**)malloc(mprts.n_patches() * sizeof(*idx));
-
-    size_t *gidx_begin = NULL, *gidx_end = NULL;
     if (rank == 0) {
       // alloc global idx array
-      gidx_begin = (size_t*)malloc(nr_kinds * wdims_[0] * wdims_[1] *
-                                   wdims_[2] * sizeof(*gidx_begin));
-      gidx_end = (size_t*)malloc(nr_kinds * wdims_[0] * wdims_[1] * wdims_[2] *
-                                 sizeof(*gidx_end));
-      for (int jz = 0; jz < wdims_[2]; jz++) {
-        for (int jy = 0; jy < wdims_[1]; jy++) {
-          for (int jx = 0; jx < wdims_[0]; jx++) {
-            for (int kind = 0; kind < nr_kinds; kind++) {
-              int ii =
-                ((kind * wdims_[2] + jz) * wdims_[1] + jy) * wdims_[0] + jx;
-              gidx_begin[ii] = size_t(-1);
-              gidx_end[ii] = size_t(-1);
-            }
-          }
-        }
-      }
-    }
+      size_t n_idx = nr_kinds * wdims_[0] * wdims_[1] * wdims_[2];
+      chunk.gidx_begin.assign(n_idx, size_t(-1));
+      chunk.gidx_end.assign(n_idx, size_t(-1));
+      size_t* gidx_begin = chunk.gidx_begin.data();
+      size_t* gidx_end = chunk.gidx_end.data();
 
-    // find local particle and idx arrays
-    size_t n_write, n_off, n_total;
-    hdf5_prt* arr = make_local_particle_array(mprts, map, off, idx, &n_write,
-                                              &n_off, &n_total);
-    prof_stop(pr_A);
-
-    prof_start(pr_B);
-    if (rank == 0) {
       int nr_global_patches = grid.nGlobalPatches();
 
       int* remote_sz = (int*)calloc(size, sizeof(*remote_sz));
@@ -534,9 +479,212 @@ struct OutputParticlesHdf5
 
       free(l_idx);
     }
+  }
+
+  // ----------------------------------------------------------------------
+  // aggregate
+  //
+  // gather the particles of all ranks on a node onto the node's first
+  // rank, which is the only one that'll write. The particles end up in the
+  // right order already, as the offsets were determined accordingly.
+
+  void aggregate(Hdf5ParticleChunk& chunk)
+  {
+    if (node_comm_ == MPI_COMM_NULL) {
+      return;
+    }
+
+    int node_rank, node_size;
+    MPI_Comm_rank(node_comm_, &node_rank);
+    MPI_Comm_size(node_comm_, &node_size);
+
+    MPI_Datatype mpi_prt;
+    MPI_Type_contiguous(sizeof(hdf5_prt), MPI_BYTE, &mpi_prt);
+    MPI_Type_commit(&mpi_prt);
+
+    int n_write = chunk.prts.size();
+    std::vector<int> counts, displs;
+    if (node_rank == 0) {
+      counts.resize(node_size);
+      displs.resize(node_size);
+    }
+    MPI_Gather(&n_write, 1, MPI_INT, counts.data(), 1, MPI_INT, 0,
+               node_comm_);
+
+    std::vector<hdf5_prt> node_prts;
+    if (node_rank == 0) {
+      int n_node = 0;
+      for (int r = 0; r < node_size; r++) {
+        displs[r] = n_node;
+        n_node += counts[r];
+      }
+      node_prts.resize(n_node);
+    }
+    MPI_Gatherv(chunk.prts.data(), n_write, mpi_prt, node_prts.data(),
+                counts.data(), displs.data(), mpi_prt, 0, node_comm_);
+    MPI_Type_free(&mpi_prt);
+
+    chunk.prts.swap(node_prts);
+  }
+
+  // ----------------------------------------------------------------------
+  // operator()
+
+  Hdf5ParticleChunk operator()(Mparticles& mprts)
+  {
+    static int pr_A, pr_B, pr_C;
+    if (!pr_A) {
+      pr_A = prof_register("outp: local", 1., 0, 0);
+      pr_B = prof_register("outp: comm", 1., 0, 0);
+      pr_C = prof_register("outp: aggregate", 1., 0, 0);
+    }
+
+    Hdf5ParticleChunk chunk;
+
+    prof_start(pr_A);
+    int** off = (int**)malloc(mprts.n_patches() * sizeof(*off));
+    int** map = (int**)malloc(mprts.n_patches() * sizeof(*off));
+
+    count_sort(mprts, off, map);
+
+    size_t** idx = (size_t**)malloc(mprts.n_patches() * sizeof(*idx));
+
+    // find local particle and idx arrays
+    chunk.prts = make_local_particle_array(mprts, off, map, idx, &chunk.n_off,
+                                           &chunk.n_total);
+    prof_stop(pr_A);
+
+    prof_start(pr_B);
+    gather_idx(mprts, idx, chunk);
     prof_stop(pr_B);
 
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      free(off[p]);
+      free(map[p]);
+      free(idx[p]);
+    }
+    free(off);
+    free(map);
+    free(idx);
+
     prof_start(pr_C);
+    aggregate(chunk);
+    prof_stop(pr_C);
+
+    return chunk;
+  }
+
+private:
+  Int3 lo_;
+  Int3 hi_;
+  Int3 wdims_;
+  Grid_t::Kinds kinds_;
+  MPI_Comm comm_;
+  MPI_Comm node_comm_; // MPI_COMM_NULL unless aggregating
+  MPI_Comm io_comm_;   // the writing ranks
+};
+
+// ======================================================================
+// OutputParticlesHdf5Writer
+//
+// writes a Hdf5ParticleChunk from every rank in `comm` into one file.
+// It only uses what's passed in, so it can run on the I/O thread.
+
+class OutputParticlesHdf5Writer
+{
+public:
+  OutputParticlesHdf5Writer(const Int3& lo, const Int3& hi, const Int3& wdims,
+                            int n_kinds, hid_t prt_type)
+    : lo_{lo}, hi_{hi}, wdims_{wdims}, n_kinds_{n_kinds}, prt_type_{prt_type}
+  {}
+
+  void write_particles(size_t n_write, size_t n_off, size_t n_total,
+                       const hdf5_prt* arr, hid_t group, hid_t dxpl) const
+  {
+    herr_t ierr;
+
+    hsize_t mdims[1] = {n_write};
+    hsize_t fdims[1] = {n_total};
+    hsize_t foff[1] = {n_off};
+    hid_t memspace = H5Screate_simple(1, mdims, NULL);
+    H5_CHK(memspace);
+    hid_t filespace = H5Screate_simple(1, fdims, NULL);
+    H5_CHK(filespace);
+    ierr =
+      H5Sselect_hyperslab(filespace, H5S_SELECT_SET, foff, NULL, mdims, NULL);
+    CE;
+
+    hid_t dset = H5Dcreate(group, "1d", prt_type_, filespace, H5P_DEFAULT,
+                           H5P_DEFAULT, H5P_DEFAULT);
+    H5_CHK(dset);
+    ierr = H5Dwrite(dset, prt_type_, memspace, filespace, dxpl, arr);
+    CE;
+
+    ierr = H5Dclose(dset);
+    CE;
+    ierr = H5Sclose(filespace);
+    CE;
+    ierr = H5Sclose(memspace);
+    CE;
+  }
+
+  void write_idx(const size_t* gidx_begin, const size_t* gidx_end, hid_t group,
+                 hid_t dxpl, MPI_Comm comm) const
+  {
+    herr_t ierr;
+
+    hsize_t fdims[4];
+    fdims[0] = n_kinds_;
+    fdims[1] = wdims_[2];
+    fdims[2] = wdims_[1];
+    fdims[3] = wdims_[0];
+    hid_t filespace = H5Screate_simple(4, fdims, NULL);
+    H5_CHK(filespace);
+    hid_t memspace;
+
+    assert(sizeof(size_t) == sizeof(hsize_t));
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0) {
+      memspace = H5Screate_simple(4, fdims, NULL);
+      H5_CHK(memspace);
+    } else {
+      memspace = H5Screate(H5S_NULL);
+      H5Sselect_none(memspace);
+      H5Sselect_none(filespace);
+    }
+
+    hid_t dset = H5Dcreate(group, "idx_begin", H5T_NATIVE_HSIZE, filespace,
+                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5_CHK(dset);
+    ierr =
+      H5Dwrite(dset, H5T_NATIVE_HSIZE, memspace, filespace, dxpl, gidx_begin);
+    CE;
+    ierr = H5Dclose(dset);
+    CE;
+
+    dset = H5Dcreate(group, "idx_end", H5T_NATIVE_HSIZE, filespace, H5P_DEFAULT,
+                     H5P_DEFAULT, H5P_DEFAULT);
+    H5_CHK(dset);
+    ierr =
+      H5Dwrite(dset, H5T_NATIVE_HSIZE, memspace, filespace, dxpl, gidx_end);
+    CE;
+    ierr = H5Dclose(dset);
+    CE;
+
+    ierr = H5Sclose(filespace);
+    CE;
+    ierr = H5Sclose(memspace);
+    CE;
+  }
+
+  // ----------------------------------------------------------------------
+  // operator()
+
+  void operator()(const Hdf5ParticleChunk& chunk, const std::string& filename,
+                  const OutputParticlesParams& params, MPI_Comm comm) const
+  {
+    herr_t ierr;
 
     hid_t plist = H5Pcreate(H5P_FILE_ACCESS);
 
@@ -551,7 +699,7 @@ struct OutputParticlesHdf5
       MPI_Info_set(mpi_info, (char*)"romio_ds_write",
                    (char*)params.romio_ds_write);
     }
-    H5Pset_fapl_mpio(plist, comm_, mpi_info);
+    H5Pset_fapl_mpio(plist, comm, mpi_info);
 #else
     mprintf("ERROR: particle output requires parallel hdf5\n");
     abort();
@@ -585,14 +733,11 @@ struct OutputParticlesHdf5
       CE;
     }
 #endif
-    prof_stop(pr_C);
-
-    prof_start(pr_D);
-    write_idx(gidx_begin, gidx_end, groupp, dxpl);
-    prof_stop(pr_D);
 
-    prof_start(pr_E);
-    write_particles(n_write, n_off, n_total, arr, groupp, dxpl);
+    write_idx(chunk.gidx_begin.data(), chunk.gidx_end.data(), groupp, dxpl,
+              comm);
+    write_particles(chunk.prts.size(), chunk.n_off, chunk.n_total,
+                    chunk.prts.data(), groupp, dxpl);
 
     ierr = H5Pclose(dxpl);
     CE;
@@ -600,38 +745,33 @@ struct OutputParticlesHdf5
     H5Gclose(groupp);
     H5Gclose(group);
     H5Fclose(file);
-    prof_stop(pr_E);
-
-    free(arr);
-    free(gidx_begin);
-    free(gidx_end);
-
-    for (int p = 0; p < mprts.n_patches(); p++) {
-      free(off[p]);
-      free(map[p]);
-      free(idx[p]);
-    }
-    free(off);
-    free(map);
-    free(idx);
   }
 
 private:
   Int3 lo_;
   Int3 hi_;
   Int3 wdims_;
+  int n_kinds_;
   hid_t prt_type_;
-  Grid_t::Kinds kinds_;
-  MPI_Comm comm_;
 };
 
 } // namespace detail
 
+// ======================================================================
+// OutputParticlesHdf5
+//
+// With `aggregate`, the ranks on each node send their particles to the
+// node's first rank, and only those ranks open the file and write, in
+// large contiguous pieces. With `async`, the actual writing happens on a
+// background thread (at most one output is kept pending), which needs
+// MPI_THREAD_MULTIPLE and a thread-safe HDF5, as other output may be
+// using HDF5 at the same time. Without either, output is synchronous.
+
 class OutputParticlesHdf5 : OutputParticlesBase
 {
 public:
   OutputParticlesHdf5(const Grid_t& grid, const OutputParticlesParams& params)
-    : prm_{params}
+    : prm_{params}, n_kinds_(grid.kinds.size())
   {
     // set hi to gdims by default (if not set differently before)
     // and calculate wdims (global dims of region we're writing)
@@ -642,6 +782,63 @@ public:
       assert(hi_[d] <= grid.domain.gdims[d]);
     }
     wdims_ = hi_ - lo_;
+
+    MPI_Comm comm = grid.comm();
+    if (prm_.aggregate) {
+      int rank, node_rank;
+      MPI_Comm_rank(comm, &rank);
+      MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                          &node_comm_);
+      MPI_Comm_rank(node_comm_, &node_rank);
+      MPI_Comm_split(comm, node_rank == 0 ? 0 : MPI_UNDEFINED, rank,
+                     &io_comm_);
+    } else {
+      // writing uses its own communicator, so it can happen on the I/O
+      // thread without interfering with anything else
+      MPI_Comm_dup(comm, &io_comm_);
+    }
+
+    if (prm_.async) {
+      int provided;
+      MPI_Query_thread(&provided);
+      hbool_t h5_threadsafe = false;
+      H5is_library_threadsafe(&h5_threadsafe);
+      if (provided != MPI_THREAD_MULTIPLE) {
+        mpi_printf(comm, "WARNING: asynchronous particle output needs "
+                         "MPI_THREAD_MULTIPLE, writing synchronously.\n");
+      } else if (!h5_threadsafe) {
+        mpi_printf(comm, "WARNING: asynchronous particle output needs a "
+                         "thread-safe HDF5, writing synchronously.\n");
+      } else {
+        io_thread_.reset(new IOThread);
+      }
+    }
+  }
+
+  // only to be moved before any output has been written
+  OutputParticlesHdf5(OutputParticlesHdf5&& o)
+    : prm_{o.prm_},
+      lo_{o.lo_},
+      hi_{o.hi_},
+      wdims_{o.wdims_},
+      n_kinds_{o.n_kinds_},
+      node_comm_{o.node_comm_},
+      io_comm_{o.io_comm_},
+      io_thread_{std::move(o.io_thread_)}
+  {
+    o.node_comm_ = MPI_COMM_NULL;
+    o.io_comm_ = MPI_COMM_NULL;
+  }
+
+  ~OutputParticlesHdf5()
+  {
+    io_thread_.reset(); // finishes pending output
+    if (node_comm_ != MPI_COMM_NULL) {
+      MPI_Comm_free(&node_comm_);
+    }
+    if (io_comm_ != MPI_COMM_NULL) {
+      MPI_Comm_free(&io_comm_);
+    }
   }
 
   template <typename Mparticles>
@@ -657,9 +854,9 @@ public:
     sprintf(filename, "%s/%s.%06d_p%06d.h5", prm_.data_dir, prm_.basename,
             grid.timestep(), 0);
 
-    detail::OutputParticlesHdf5<Mparticles> impl{grid, lo_, hi_, wdims_,
-                                                 prt_type_};
-    impl(mprts, filename, prm_);
+    detail::OutputParticlesHdf5<Mparticles> impl{
+      grid, lo_, hi_, wdims_, node_comm_, io_comm_};
+    write(impl(mprts), filename);
   }
 
   // FIXME, handles MparticlesVpic by conversion for now
@@ -695,9 +892,40 @@ public:
 #endif
 
 private:
+  void write(detail::Hdf5ParticleChunk&& chunk, const std::string& filename)
+  {
+    static int pr;
+    if (!pr) {
+      pr = prof_register("outp: write", 1., 0, 0);
+    }
+
+    if (io_comm_ == MPI_COMM_NULL) { // our particles went to the aggregator
+      return;
+    }
+
+    prof_start(pr);
+    detail::OutputParticlesHdf5Writer writer{lo_, hi_, wdims_, n_kinds_,
+                                             prt_type_};
+    if (io_thread_) {
+      io_thread_->wait();
+      io_thread_->push([writer, chunk = std::move(chunk), filename,
+                        prm = prm_, comm = io_comm_]() {
+        writer(chunk, filename, prm, comm);
+      });
+    } else {
+      writer(chunk, filename, prm_, io_comm_);
+    }
+    prof_stop(pr);
+  }
+
   const OutputParticlesParams prm_;
   detail::Hdf5ParticleType prt_type_;
   Int3 lo_; // dimensions of the subdomain we're actually writing
   Int3 hi_;
   Int3 wdims_;
+  int n_kinds_;
+  MPI_Comm node_comm_ = MPI_COMM_NULL; // ranks on the same node, if
+                                       // aggregating
+  MPI_Comm io_comm_ = MPI_COMM_NULL;   // ranks that write
+  std::unique_ptr<IOThread> io_thread_;
 };
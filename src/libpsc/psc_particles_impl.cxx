@@ -79,6 +79,36 @@ const MparticlesBase::Convert MparticlesDouble::convert_to_ = {};
 template <>
 const MparticlesBase::Convert MparticlesDouble::convert_from_ = {};
 
+// ======================================================================
+// psc_mparticles: subclass "single", SoA storage
+
+template <>
+const MparticlesBase::Convert MparticlesSingleSoA::convert_to_ = {
+  {std::type_index(typeid(MparticlesSingle)),
+   psc_mparticles_copy_to<MparticlesSingleSoA, MparticlesSingle>},
+};
+
+template <>
+const MparticlesBase::Convert MparticlesSingleSoA::convert_from_ = {
+  {std::type_index(typeid(MparticlesSingle)),
+   psc_mparticles_copy_from<MparticlesSingleSoA, MparticlesSingle>},
+};
+
+// ======================================================================
+// psc_mparticles: subclass "double", SoA storage
+
+template <>
+const MparticlesBase::Convert MparticlesDoubleSoA::convert_to_ = {
+  {std::type_index(typeid(MparticlesDouble)),
+   psc_mparticles_copy_to<MparticlesDoubleSoA, MparticlesDouble>},
+};
+
+template <>
+const MparticlesBase::Convert MparticlesDoubleSoA::convert_from_ = {
+  {std::type_index(typeid(MparticlesDouble)),
+   psc_mparticles_copy_from<MparticlesDoubleSoA, MparticlesDouble>},
+};
+
 // ======================================================================
 // MparticlesSimple<ParticleWithId<float>>
 
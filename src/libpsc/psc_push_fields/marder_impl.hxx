@@ -11,6 +11,8 @@
 #include <gtensor/reductions.h>
 #include <mrc_io.h>
 
+#include <vector>
+
 namespace psc
 {
 namespace marder
@@ -47,6 +49,43 @@ inline void find_limits(const Grid_t& grid, int p, Int3& lx, Int3& rx, Int3& ly,
   rz = Int3{r_nc[0], r_nc[1], r_cc[2]} + grid.ldims + grid.ibn;
 }
 
+// ----------------------------------------------------------------------
+// fill_ghosts
+//
+// fills only the first `n_ghosts` layers of ghost points, if the Bnd
+// supports that, otherwise all of them
+
+template <typename Bnd, typename S, typename = void>
+struct fill_ghosts_narrow
+{
+  static void run(Bnd& bnd, const Grid_t& grid, S& mflds, const Int3& ib,
+                  int mb, int me, int n_ghosts)
+  {
+    bnd.fill_ghosts(grid, mflds, ib, mb, me);
+  }
+};
+
+template <typename Bnd, typename S>
+struct fill_ghosts_narrow<
+  Bnd, S,
+  gt::meta::void_t<decltype(std::declval<Bnd&>().fill_ghosts(
+    std::declval<const Grid_t&>(), std::declval<S&>(),
+    std::declval<const Int3&>(), 0, 0, 0))>>
+{
+  static void run(Bnd& bnd, const Grid_t& grid, S& mflds, const Int3& ib,
+                  int mb, int me, int n_ghosts)
+  {
+    bnd.fill_ghosts(grid, mflds, ib, mb, me, n_ghosts);
+  }
+};
+
+template <typename Bnd, typename S>
+inline void fill_ghosts(Bnd& bnd, const Grid_t& grid, S& mflds, const Int3& ib,
+                        int mb, int me, int n_ghosts)
+{
+  fill_ghosts_narrow<Bnd, S>::run(bnd, grid, mflds, ib, mb, me, n_ghosts);
+}
+
 } // namespace detail
 
 // ----------------------------------------------------------------------
@@ -210,35 +249,94 @@ public:
 
   // FIXME: checkpointing won't properly restore state
 
-  MarderCommon(const Grid_t& grid, real_t diffusion, int loop, bool dump)
-    : diffusion_{diffusion}, loop_{loop}, dump_{dump}
+  // The error (max |div E - rho|) is found every `err_interval` iterations,
+  // and after the last one (err_interval = 0: only after the last one).
+  MarderCommon(const Grid_t& grid, real_t diffusion, int loop, bool dump,
+               int err_interval = 0)
+    : diffusion_{diffusion},
+      loop_{loop},
+      dump_{dump},
+      err_interval_{err_interval}
   {
     if (dump_) {
       io_.open("marder");
     }
   }
 
+  // err_req_ refers to errs_global_, so this can't be copied
+  MarderCommon(const MarderCommon&) = delete;
+  MarderCommon& operator=(const MarderCommon&) = delete;
+
+  ~MarderCommon()
+  {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+      finish_err_reduction();
+    }
+  }
+
   // ----------------------------------------------------------------------
-  // print_progress
+  // start_err_reduction
+  //
+  // The errors found during one correction are reduced across procs all
+  // at once, non-blocking, and only waited for (and printed) at the start
+  // of the next correction (or on destruction), so no one waits on the
+  // allreduce in the meantime.
 
-  template <typename E1, typename E2, typename E3>
-  void print_progress(const Grid_t& grid, const E1& rho, const E2& dive,
-                      const E3& res)
+  void start_err_reduction(MPI_Comm comm)
   {
-    real_t max_err = gt::norm_linf(res);
-    MPI_Allreduce(MPI_IN_PLACE, &max_err, 1,
-                  MpiDtypeTraits<gt::expr_value_type<E3>>::value(), MPI_MAX,
-                  grid.comm());
-    mpi_printf(grid.comm(), "marder: err %g\n", max_err);
+    errs_global_.resize(errs_.size());
+    if (errs_.empty()) {
+      return;
+    }
 
-    if (dump_) {
-      static int cnt;
-      io_.begin_step(cnt, cnt);
-      cnt++;
-      io_.write(rho, grid, "rho", {"rho"});
-      io_.write(dive, grid, "dive", {"dive"});
-      io_.end_step();
+    MPI_Iallreduce(errs_.data(), errs_global_.data(), errs_.size(),
+                   MpiDtypeTraits<real_t>::value(), MPI_MAX, comm, &err_req_);
+    err_comm_ = comm;
+  }
+
+  // ----------------------------------------------------------------------
+  // finish_err_reduction
+
+  void finish_err_reduction()
+  {
+    if (err_req_ == MPI_REQUEST_NULL) {
+      return;
     }
+
+    MPI_Wait(&err_req_, MPI_STATUS_IGNORE);
+    for (auto err : errs_global_) {
+      mpi_printf(err_comm_, "marder: err %g\n", err);
+    }
+    errs_.clear();
+  }
+
+  // ----------------------------------------------------------------------
+  // errs
+  //
+  // the errors found during the last correction, max'ed over all procs
+
+  const std::vector<real_t>& errs()
+  {
+    finish_err_reduction();
+    return errs_global_;
+  }
+
+  // ----------------------------------------------------------------------
+  // dump
+
+  template <typename E1, typename E2>
+  void dump(const Grid_t& grid, const E1& rho, const E2& efield)
+  {
+    auto dive = psc::mflds::interior(grid, psc::item::div_nc(grid, efield));
+
+    static int cnt;
+    io_.begin_step(cnt, cnt);
+    cnt++;
+    io_.write(rho, grid, "rho", {"rho"});
+    io_.write(dive, grid, "dive", {"dive"});
+    io_.end_step();
   }
 
   // ----------------------------------------------------------------------
@@ -251,6 +349,8 @@ public:
   void operator()(const Grid_t& grid, storage_type& mflds, const Int3& mflds_ib,
                   Mparticles& mprts)
   {
+    finish_err_reduction();
+
     auto efield = mflds.view(_all, _all, _all, _s(EX, EX + 3), _all);
     auto efield_ib = mflds_ib;
 
@@ -266,22 +366,38 @@ public:
     auto item_rho = Item_rho_t{grid};
     auto rho = psc::mflds::interior(grid, item_rho(mprts));
 
-    // FIXME: it's not well defined whether E ghost points are filled at entry,
-    // and expected to be filled when done, so we're playing it safe for the
-    // time being.
-    for (int i = 0; i < loop_; i++) {
-      bnd_.fill_ghosts(grid, mflds, mflds_ib, EX, EX + 3);
-      auto dive = psc::mflds::interior(grid, psc::item::div_nc(grid, efield));
-
-      Int3 res_ib = -grid.ibn;
-      auto res = storage_type{psc::mflds::make_shape(grid, 1, res_ib)};
-      psc::mflds::interior(grid, res) = dive - rho;
-      bnd_.fill_ghosts(grid, res, res_ib, 0, 1);
+    Int3 res_ib = -grid.ibn;
+    auto res_shape = psc::mflds::make_shape(grid, 1, res_ib);
+    if (!(res_.shape() == res_shape)) {
+      res_ = storage_type(res_shape);
+      res_.view() = 0.;
+    }
 
-      print_progress(grid, rho, dive, res);
+    // div_nc() only looks at one layer of E ghost points, and correct() at
+    // one layer of res ghost points, so that's all that needs exchanging
+    // within the loop.
+    for (int i = 0; i < loop_; i++) {
+      psc::marder::detail::fill_ghosts(bnd_, grid, mflds, mflds_ib, EX, EX + 3,
+                                       1);
+      psc::item::div_nc(grid, efield, psc::mflds::interior(grid, res_));
+      psc::mflds::interior(grid, res_) =
+        psc::mflds::interior(grid, res_) - rho;
+      psc::marder::detail::fill_ghosts(bnd_, grid, res_, res_ib, 0, 1, 1);
+
+      if (i == loop_ - 1 ||
+          (err_interval_ > 0 && (i + 1) % err_interval_ == 0)) {
+        errs_.push_back(gt::norm_linf(psc::mflds::interior(grid, res_)));
+      }
+      if (dump_) {
+        dump(grid, rho, efield);
+      }
 
-      psc::marder::correct(grid, efield, efield_ib, res, res_ib, diffusion);
+      psc::marder::correct(grid, efield, efield_ib, res_, res_ib, diffusion);
     }
+    start_err_reduction(grid.comm());
+
+    // FIXME: it's not well defined whether E ghost points are expected to be
+    // filled when done, so we're playing it safe for the time being.
     bnd_.fill_ghosts(grid, mflds, mflds_ib, EX, EX + 3);
   }
 
@@ -302,8 +418,16 @@ public:
   real_t diffusion_; //< diffusion coefficient for Marder correction
   int loop_;         //< execute this many relaxation steps in a loop
   bool dump_;        //< dump div_E, rho
+  int err_interval_; //< find the error every so many steps
   Bnd bnd_;
   WriterMRC io_; //< for debug dumping
+
+private:
+  storage_type res_; //< div E - rho, kept around between calls
+  std::vector<real_t> errs_;
+  std::vector<real_t> errs_global_;
+  MPI_Request err_req_ = MPI_REQUEST_NULL;
+  MPI_Comm err_comm_;
 };
 
 template <typename S, typename D>
@@ -0,0 +1,686 @@
+
+#pragma once
+
+#include "fields.hxx"
+#include "../libpsc/psc_output_fields/fields_item_moments_1st.hxx"
+#include "../libpsc/psc_bnd/psc_bnd_impl.hxx"
+
+#include <mrc_profile.h>
+
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// ======================================================================
+// PoissonParams
+
+struct PoissonParams
+{
+  double tol = 1e-8;     // stop once |residual| < tol * |rhs| (L2 norms)
+  int max_cycles = 50;   // give up after this many V-cycles
+  int n_smooth = 2;      // red-black Gauss-Seidel sweeps before and after
+                         // each coarse grid correction
+  int max_coarse = 1000; // max CG iterations on the coarsest level
+  bool verbose = false;  // print number of cycles and residual
+};
+
+namespace psc
+{
+namespace poisson
+{
+
+// ======================================================================
+// Multigrid
+//
+// Geometric multigrid solver for
+//
+//   Lap phi = rhs
+//
+// on the grid's nodes, with the standard 2nd order (7-point, in 3-d)
+// discretization. That's the discretization that div_nc() of grad_ec()
+// amounts to, so subtracting grad phi from E changes div_nc(E) by exactly
+// rhs, up to the solver tolerance.
+//
+// Each level is coarsened by 2 in all non-invariant directions for as long
+// as the patch size allows, keeping the fine grid's decomposition into
+// patches. Restriction (full weighting) and prolongation (linear) are
+// hence patch-local, and every level exchanges ghost points using its own
+// coarse Grid_t's ddc. The coarsest level is solved with CG.
+//
+// Periodic boundaries are taken care of by the ghost point exchange,
+// otherwise phi = 0 on the boundary (ie, conducting walls). If all
+// directions are periodic, the problem is singular: the mean of rhs gets
+// taken out (ie., a neutralizing background is assumed), and phi is
+// returned with zero mean.
+
+class Multigrid
+{
+public:
+  using real_t = double;
+  using storage_type = gt::gtensor<real_t, 5>;
+
+  Multigrid(const PoissonParams& prm = {}) : prm_{prm} {}
+
+  // ----------------------------------------------------------------------
+  // setup
+  //
+  // (re)builds the level hierarchy if `grid` differs from last time, or
+  // the decomposition has changed since. Collective.
+
+  void setup(const Grid_t& grid)
+  {
+    if (!levels_.empty() && &grid == grid_ &&
+        generation_ == psc_balance_generation_cnt) {
+      return;
+    }
+
+    levels_.clear();
+    levels_.emplace_back(grid);
+    while (can_coarsen(*levels_.back().grid)) {
+      levels_.emplace_back(make_coarse_grid(*levels_.back().grid));
+    }
+    auto& coarsest = levels_.back();
+    coarsest.p = psc::mflds::zeros<real_t>(*coarsest.grid, 1, coarsest.ib);
+    coarsest.q = psc::mflds::zeros<real_t>(*coarsest.grid, 1, coarsest.ib);
+
+    singular_ = true;
+    for (int d = 0; d < 3; d++) {
+      if (!is_periodic(grid, d)) {
+        singular_ = false;
+      }
+    }
+
+    grid_ = &grid;
+    generation_ = psc_balance_generation_cnt;
+  }
+
+  // ----------------------------------------------------------------------
+  // rhs, phi
+  //
+  // The fine level's rhs and solution, which are shaped like the grid's
+  // fields (including ghost points, 1 component). Valid after setup().
+  // rhs is only read on the interior points, and after solve(), phi has
+  // its first layer of ghost points filled.
+
+  storage_type& rhs() { return levels_[0].rhs; }
+  storage_type& phi() { return levels_[0].phi; }
+
+  // ----------------------------------------------------------------------
+  // solve
+  //
+  // returns the number of V-cycles it took
+
+  int solve()
+  {
+    auto& fine = levels_[0];
+
+    if (singular_) {
+      remove_mean(fine, fine.rhs);
+    }
+    real_t rhs_norm = norm(fine, fine.rhs);
+
+    fine.phi.view() = 0.;
+    residual_ = 0.;
+    int n_cycles = 0;
+    if (rhs_norm > 0.) {
+      while (n_cycles < prm_.max_cycles) {
+        vcycle(0);
+        n_cycles++;
+        residual(fine);
+        residual_ = norm(fine, fine.res) / rhs_norm;
+        if (residual_ < prm_.tol) {
+          break;
+        }
+      }
+    }
+
+    if (singular_) {
+      remove_mean(fine, fine.phi);
+    }
+    fill_ghosts(fine, fine.phi);
+    return n_cycles;
+  }
+
+  // relative residual at the end of the last solve()
+  real_t residual() const { return residual_; }
+
+  int n_levels() const { return levels_.size(); }
+
+private:
+  // ======================================================================
+  // Level
+
+  struct Level
+  {
+    Level(const Grid_t& grid)
+      : grid{&grid},
+        ib{-grid.ibn},
+        phi{psc::mflds::zeros<real_t>(grid, 1, ib)},
+        rhs{psc::mflds::zeros<real_t>(grid, 1, ib)},
+        res{psc::mflds::zeros<real_t>(grid, 1, ib)}
+    {}
+
+    Level(std::unique_ptr<Grid_t>&& coarse_grid) : Level{*coarse_grid}
+    {
+      owned_grid = std::move(coarse_grid);
+    }
+
+    const Grid_t* grid;
+    std::unique_ptr<Grid_t> owned_grid; // coarse levels only
+    Int3 ib;
+    storage_type phi;
+    storage_type rhs;
+    storage_type res;
+    storage_type p, q; // CG work arrays, coarsest level only
+    Bnd_ bnd; // per level, so its cached narrow ddc matches this grid
+  };
+
+  static bool is_periodic(const Grid_t& grid, int d)
+  {
+    return grid.isInvar(d) || grid.bc.fld_lo[d] == BND_FLD_PERIODIC;
+  }
+
+  // ----------------------------------------------------------------------
+  // can_coarsen
+  //
+  // coarse patches should still have at least 2 points in each
+  // (non-invariant) direction
+
+  static bool can_coarsen(const Grid_t& grid)
+  {
+    bool any = false;
+    for (int d = 0; d < 3; d++) {
+      if (!grid.isInvar(d)) {
+        if (grid.ldims[d] % 2 != 0 || grid.ldims[d] < 4) {
+          return false;
+        }
+        any = true;
+      }
+    }
+    return any;
+  }
+
+  // ----------------------------------------------------------------------
+  // make_coarse_grid
+  //
+  // same patches as `grid` (the decomposition follows from np, the curve
+  // and the number of local patches), but half the points
+
+  static std::unique_ptr<Grid_t> make_coarse_grid(const Grid_t& grid)
+  {
+    Int3 gdims = grid.domain.gdims;
+    Int3 ibn = {};
+    for (int d = 0; d < 3; d++) {
+      if (!grid.isInvar(d)) {
+        gdims[d] /= 2;
+        ibn[d] = 1;
+      }
+    }
+    auto domain = Grid_t::Domain{gdims, grid.domain.length, grid.domain.corner,
+                                 grid.domain.np};
+    domain.curve = grid.domain.curve;
+
+    auto coarse = std::unique_ptr<Grid_t>(new Grid_t{
+      domain, grid.bc, {}, grid.norm, grid.dt, grid.n_patches(), ibn});
+    for (int p = 0; p < grid.n_patches(); p++) {
+      for (int d = 0; d < 3; d++) {
+        assert(grid.isInvar(d) ||
+               2 * coarse->patches[p].off[d] == grid.patches[p].off[d]);
+      }
+    }
+    return coarse;
+  }
+
+  // ----------------------------------------------------------------------
+  // foreach_node
+  //
+  // calls f(p, idx) for all interior nodes, other than those on a
+  // (non-periodic) boundary, where phi is fixed at 0
+
+  template <typename F>
+  static void foreach_node(const Grid_t& grid, F&& f)
+  {
+    const Int3& ldims = grid.ldims;
+    for (int p = 0; p < grid.n_patches(); p++) {
+      Int3 ilo = {};
+      for (int d = 0; d < 3; d++) {
+        if (!is_periodic(grid, d) && grid.atBoundaryLo(p, d)) {
+          ilo[d] = 1;
+        }
+      }
+      Int3 idx;
+      for (idx[2] = ilo[2]; idx[2] < ldims[2]; idx[2]++) {
+        for (idx[1] = ilo[1]; idx[1] < ldims[1]; idx[1]++) {
+          for (idx[0] = ilo[0]; idx[0] < ldims[0]; idx[0]++) {
+            f(p, idx);
+          }
+        }
+      }
+    }
+  }
+
+  static real_t& at(const Level& lvl, storage_type& fld, int p,
+                    const Int3& idx)
+  {
+    return fld(idx[0] - lvl.ib[0], idx[1] - lvl.ib[1], idx[2] - lvl.ib[2], 0,
+               p);
+  }
+
+  static Int3 shift(Int3 idx, int d, int s)
+  {
+    idx[d] += s;
+    return idx;
+  }
+
+  // 1 / dx^2, or 0 in invariant directions
+  static Vec3<real_t> inv_dx2(const Grid_t& grid)
+  {
+    Vec3<real_t> w;
+    for (int d = 0; d < 3; d++) {
+      w[d] = grid.isInvar(d) ? 0. : 1. / sqr(grid.domain.dx[d]);
+    }
+    return w;
+  }
+
+  // ----------------------------------------------------------------------
+  // fill_ghosts
+  //
+  // fills the first layer of ghost points, and sets the ones on / beyond
+  // a non-periodic boundary to 0
+
+  void fill_ghosts(Level& lvl, storage_type& fld)
+  {
+    const Grid_t& grid = *lvl.grid;
+    lvl.bnd.fill_ghosts(grid, fld, lvl.ib, 0, 1, 1);
+
+    for (int p = 0; p < grid.n_patches(); p++) {
+      for (int d = 0; d < 3; d++) {
+        if (is_periodic(grid, d) || !grid.atBoundaryHi(p, d)) {
+          continue;
+        }
+        Int3 ilo = {}, ihi = grid.ldims;
+        for (int dd = 0; dd < 3; dd++) {
+          if (!grid.isInvar(dd)) {
+            ilo[dd] = -1;
+            ihi[dd] = grid.ldims[dd] + 1;
+          }
+        }
+        ilo[d] = grid.ldims[d];
+        Int3 idx;
+        for (idx[2] = ilo[2]; idx[2] < ihi[2]; idx[2]++) {
+          for (idx[1] = ilo[1]; idx[1] < ihi[1]; idx[1]++) {
+            for (idx[0] = ilo[0]; idx[0] < ihi[0]; idx[0]++) {
+              at(lvl, fld, p, idx) = 0.;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // laplace
+  //
+  // Lap fld at idx, ghost points need to be filled
+
+  static real_t laplace(const Level& lvl, storage_type& fld, int p,
+                        const Int3& idx, const Vec3<real_t>& w)
+  {
+    real_t val = 0.;
+    for (int d = 0; d < 3; d++) {
+      if (w[d] != 0.) {
+        val += w[d] * (at(lvl, fld, p, shift(idx, d, 1)) -
+                       2. * at(lvl, fld, p, idx) +
+                       at(lvl, fld, p, shift(idx, d, -1)));
+      }
+    }
+    return val;
+  }
+
+  // ----------------------------------------------------------------------
+  // smooth
+  //
+  // red-black Gauss-Seidel, colored by global index
+
+  void smooth(Level& lvl, int n_sweeps)
+  {
+    const Grid_t& grid = *lvl.grid;
+    auto w = inv_dx2(grid);
+    real_t diag = 2. * (w[0] + w[1] + w[2]);
+
+    for (int n = 0; n < n_sweeps; n++) {
+      for (int color = 0; color < 2; color++) {
+        fill_ghosts(lvl, lvl.phi);
+        foreach_node(grid, [&](int p, const Int3& idx) {
+          const Int3& off = grid.patches[p].off;
+          if (((idx[0] + off[0] + idx[1] + off[1] + idx[2] + off[2]) & 1) !=
+              color) {
+            return;
+          }
+          real_t& phi = at(lvl, lvl.phi, p, idx);
+          real_t lap = laplace(lvl, lvl.phi, p, idx, w);
+          phi += (lap - at(lvl, lvl.rhs, p, idx)) / diag;
+        });
+      }
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // residual
+  //
+  // res = rhs - Lap phi (and 0 on the boundary)
+
+  void residual(Level& lvl)
+  {
+    const Grid_t& grid = *lvl.grid;
+    auto w = inv_dx2(grid);
+
+    fill_ghosts(lvl, lvl.phi);
+    lvl.res.view() = 0.;
+    foreach_node(grid, [&](int p, const Int3& idx) {
+      at(lvl, lvl.res, p, idx) =
+        at(lvl, lvl.rhs, p, idx) - laplace(lvl, lvl.phi, p, idx, w);
+    });
+  }
+
+  // ----------------------------------------------------------------------
+  // restrict_residual
+  //
+  // full weighting of fine.res into coarse.rhs
+
+  void restrict_residual(Level& fine, Level& coarse)
+  {
+    const Grid_t& grid = *coarse.grid;
+    fill_ghosts(fine, fine.res);
+
+    Int3 olo, ohi;
+    for (int d = 0; d < 3; d++) {
+      olo[d] = grid.isInvar(d) ? 0 : -1;
+      ohi[d] = grid.isInvar(d) ? 0 : 1;
+    }
+
+    coarse.rhs.view() = 0.;
+    foreach_node(grid, [&](int p, const Int3& idx) {
+      real_t val = 0.;
+      Int3 o;
+      for (o[2] = olo[2]; o[2] <= ohi[2]; o[2]++) {
+        for (o[1] = olo[1]; o[1] <= ohi[1]; o[1]++) {
+          for (o[0] = olo[0]; o[0] <= ohi[0]; o[0]++) {
+            real_t wgt = 1.;
+            Int3 fidx;
+            for (int d = 0; d < 3; d++) {
+              if (!grid.isInvar(d)) {
+                wgt *= o[d] == 0 ? .5 : .25;
+              }
+              fidx[d] = 2 * idx[d] + o[d];
+            }
+            val += wgt * at(fine, fine.res, p, fidx);
+          }
+        }
+      }
+      at(coarse, coarse.rhs, p, idx) = val;
+    });
+  }
+
+  // ----------------------------------------------------------------------
+  // prolong_add
+  //
+  // fine.phi += linear interpolation of coarse.phi
+
+  void prolong_add(Level& coarse, Level& fine)
+  {
+    const Grid_t& grid = *fine.grid;
+    fill_ghosts(coarse, coarse.phi);
+
+    foreach_node(grid, [&](int p, const Int3& idx) {
+      // in each direction, the coarse node(s) this fine node lies between
+      Int3 clo, chi;
+      for (int d = 0; d < 3; d++) {
+        clo[d] = idx[d] / 2;
+        chi[d] = (idx[d] + 1) / 2;
+      }
+      real_t val = 0.;
+      int n = 0;
+      Int3 cidx;
+      for (cidx[2] = clo[2]; cidx[2] <= chi[2]; cidx[2]++) {
+        for (cidx[1] = clo[1]; cidx[1] <= chi[1]; cidx[1]++) {
+          for (cidx[0] = clo[0]; cidx[0] <= chi[0]; cidx[0]++) {
+            val += at(coarse, coarse.phi, p, cidx);
+            n++;
+          }
+        }
+      }
+      at(fine, fine.phi, p, idx) += val / n;
+    });
+  }
+
+  // ----------------------------------------------------------------------
+  // dot, norm, remove_mean
+
+  real_t dot(Level& lvl, storage_type& a, storage_type& b)
+  {
+    real_t local = 0.;
+    foreach_node(*lvl.grid, [&](int p, const Int3& idx) {
+      local += at(lvl, a, p, idx) * at(lvl, b, p, idx);
+    });
+    real_t global;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_SUM, lvl.grid->comm());
+    return global;
+  }
+
+  real_t norm(Level& lvl, storage_type& fld)
+  {
+    return std::sqrt(dot(lvl, fld, fld));
+  }
+
+  void remove_mean(Level& lvl, storage_type& fld)
+  {
+    const Grid_t& grid = *lvl.grid;
+    real_t local = 0.;
+    foreach_node(grid, [&](int p, const Int3& idx) {
+      local += at(lvl, fld, p, idx);
+    });
+    real_t sum;
+    MPI_Allreduce(&local, &sum, 1, MPI_DOUBLE, MPI_SUM, grid.comm());
+
+    const Int3& gdims = grid.domain.gdims;
+    real_t mean = sum / (real_t(gdims[0]) * gdims[1] * gdims[2]);
+    foreach_node(grid,
+                 [&](int p, const Int3& idx) { at(lvl, fld, p, idx) -= mean; });
+  }
+
+  // ----------------------------------------------------------------------
+  // solve_coarse
+  //
+  // CG on -Lap phi = -rhs (-Lap is positive definite), starting from the
+  // current phi
+
+  void solve_coarse(Level& lvl)
+  {
+    const Grid_t& grid = *lvl.grid;
+    auto w = inv_dx2(grid);
+    auto& r = lvl.res;
+    auto& p = lvl.p;
+    auto& q = lvl.q;
+
+    // the residual of -Lap phi = -rhs is -(rhs - Lap phi)
+    residual(lvl);
+    if (singular_) {
+      remove_mean(lvl, r);
+    }
+    p.view() = 0.;
+    foreach_node(grid, [&](int pp, const Int3& idx) {
+      at(lvl, r, pp, idx) = -at(lvl, r, pp, idx);
+      at(lvl, p, pp, idx) = at(lvl, r, pp, idx);
+    });
+
+    // the coarse solve only needs to be about as good as what the smoother
+    // achieves on the finer levels
+    const real_t coarse_tol = 1e-3;
+    real_t rr = dot(lvl, r, r);
+    real_t rr_stop = sqr(coarse_tol) * rr;
+    for (int it = 0; it < prm_.max_coarse && rr > rr_stop; it++) {
+      fill_ghosts(lvl, p);
+      foreach_node(grid, [&](int pp, const Int3& idx) {
+        at(lvl, q, pp, idx) = -laplace(lvl, p, pp, idx, w);
+      });
+      real_t alpha = rr / dot(lvl, p, q);
+      foreach_node(grid, [&](int pp, const Int3& idx) {
+        at(lvl, lvl.phi, pp, idx) += alpha * at(lvl, p, pp, idx);
+        at(lvl, r, pp, idx) -= alpha * at(lvl, q, pp, idx);
+      });
+      real_t rr_new = dot(lvl, r, r);
+      real_t beta = rr_new / rr;
+      rr = rr_new;
+      foreach_node(grid, [&](int pp, const Int3& idx) {
+        at(lvl, p, pp, idx) = at(lvl, r, pp, idx) + beta * at(lvl, p, pp, idx);
+      });
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // vcycle
+
+  void vcycle(int l)
+  {
+    auto& lvl = levels_[l];
+    if (l == int(levels_.size()) - 1) {
+      solve_coarse(lvl);
+      return;
+    }
+
+    auto& coarse = levels_[l + 1];
+    smooth(lvl, prm_.n_smooth);
+    residual(lvl);
+    restrict_residual(lvl, coarse);
+    coarse.phi.view() = 0.;
+    vcycle(l + 1);
+    prolong_add(coarse, lvl);
+    smooth(lvl, prm_.n_smooth);
+  }
+
+  PoissonParams prm_;
+  std::vector<Level> levels_;
+  bool singular_;
+  real_t residual_ = 0.;
+  const Grid_t* grid_ = nullptr;
+  int generation_ = -1;
+};
+
+} // namespace poisson
+} // namespace psc
+
+// ======================================================================
+// PoissonProjectionCommon
+//
+// Makes E consistent with the particles' charge density in one go, by
+// solving Lap phi = div E - rho and then subtracting grad phi from E, which
+// leaves the divergence-free part of E alone. It has the same interface
+// as MarderCommon, so it can take its place as a (one-shot) divergence
+// cleaner, and it can be called once before the first step to set up the
+// electrostatic field belonging to the initial particles (on top of
+// whatever setupFields() put there).
+//
+// Host fields only.
+
+template <typename S, typename D, typename ITEM_RHO, typename BND>
+class PoissonProjectionCommon
+{
+public:
+  using storage_type = S;
+  using dim_t = D;
+  using Item_rho_t = ITEM_RHO;
+  using Bnd = BND;
+  using real_t = typename storage_type::value_type;
+
+  PoissonProjectionCommon(const Grid_t& grid, const PoissonParams& prm = {})
+    : prm_{prm}, mg_{prm}
+  {}
+
+  template <typename Mparticles>
+  void operator()(const Grid_t& grid, storage_type& mflds, const Int3& mflds_ib,
+                  Mparticles& mprts)
+  {
+    auto item_rho = Item_rho_t{grid};
+    auto rho = item_rho(mprts);
+    Int3 rho_ib = -grid.ibn;
+    auto dx = grid.domain.dx;
+
+    mg_.setup(grid);
+    auto& rhs = mg_.rhs();
+    auto& phi = mg_.phi();
+
+    // rhs = div_nc(E) - rho
+    bnd_.fill_ghosts(grid, mflds, mflds_ib, EX, EX + 3, 1);
+    foreach_interior(grid, [&](int p, int i, int j, int k) {
+      real_t dive = 0.;
+      for (int d = 0; d < 3; d++) {
+        if (!grid.isInvar(d)) {
+          Int3 m = {i, j, k};
+          m[d]--;
+          dive += (mflds(i - mflds_ib[0], j - mflds_ib[1], k - mflds_ib[2],
+                         EX + d, p) -
+                   mflds(m[0] - mflds_ib[0], m[1] - mflds_ib[1],
+                         m[2] - mflds_ib[2], EX + d, p)) /
+                  dx[d];
+        }
+      }
+      rhs(i - rho_ib[0], j - rho_ib[1], k - rho_ib[2], 0, p) =
+        dive - rho(i - rho_ib[0], j - rho_ib[1], k - rho_ib[2], 0, p);
+    });
+
+    int n_cycles = mg_.solve();
+
+    // E -= grad_ec(phi)
+    foreach_interior(grid, [&](int p, int i, int j, int k) {
+      for (int d = 0; d < 3; d++) {
+        if (!grid.isInvar(d)) {
+          Int3 n = {i, j, k};
+          n[d]++;
+          mflds(i - mflds_ib[0], j - mflds_ib[1], k - mflds_ib[2], EX + d, p) -=
+            (phi(n[0] - rho_ib[0], n[1] - rho_ib[1], n[2] - rho_ib[2], 0, p) -
+             phi(i - rho_ib[0], j - rho_ib[1], k - rho_ib[2], 0, p)) /
+            dx[d];
+        }
+      }
+    });
+    bnd_.fill_ghosts(grid, mflds, mflds_ib, EX, EX + 3);
+
+    if (prm_.verbose) {
+      mpi_printf(grid.comm(),
+                 "poisson: %d levels, %d cycles, relative residual %g\n",
+                 mg_.n_levels(), n_cycles, mg_.residual());
+    }
+  }
+
+  template <typename MfieldsState, typename Mparticles>
+  void operator()(MfieldsState& mflds, Mparticles& mprts)
+  {
+    static int pr;
+    if (!pr) {
+      pr = prof_register("poisson_projection", 1., 0, 0);
+    }
+
+    prof_start(pr);
+    (*this)(mprts.grid(), mflds.storage(), mflds.ib(), mprts);
+    prof_stop(pr);
+  }
+
+private:
+  template <typename F>
+  static void foreach_interior(const Grid_t& grid, F&& f)
+  {
+    for (int p = 0; p < grid.n_patches(); p++) {
+      grid.Foreach_3d(0, 0, [&](int i, int j, int k) { f(p, i, j, k); });
+    }
+  }
+
+  PoissonParams prm_;
+  psc::poisson::Multigrid mg_;
+  Bnd bnd_;
+};
+
+template <typename S, typename D>
+using PoissonProjection_ =
+  PoissonProjectionCommon<S, D, Moment_rho_1st_nc<S, D>, Bnd_>;
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "dim.hxx"
+#include "psc.h"
+#include "kg/Vec3.h"
+
+#include <algorithm>
+#include <vector>
+
+// ======================================================================
+// Field tiles
+//
+// CPU counterparts to cuda's FldCache / SCurr: rather than having the
+// pusher hit the (large, strided) patch fields for every particle, E/H for
+// a small block of cells are copied into a contiguous tile up front, and J
+// is accumulated in a tile-local buffer that gets added back into the patch
+// once per block.
+//
+// A tile covers the cells [lo, hi) of the block plus N_GHOSTS_L / N_GHOSTS_R
+// on either side, which is as far as a 1st order particle starting in the
+// block can reach within one step. Indices are the usual patch-relative cell
+// indices, so InterpolateEM / the current deposition can use a tile in place
+// of Fields3d / curr_cache_t without changes. Invariant directions always
+// map to index 0.
+
+template <typename D>
+class TileIndexer
+{
+public:
+  using dim = D;
+
+  static const int N_GHOSTS_L = 1;
+  static const int N_GHOSTS_R = 2;
+
+  TileIndexer(const Int3& block) : block_{block}, lo_{}, hi_{}
+  {
+    for (int d = 0; d < 3; d++) {
+      dims_[d] = invar(d) ? 1 : block[d] + N_GHOSTS_L + N_GHOSTS_R;
+    }
+  }
+
+  static bool invar(int d)
+  {
+    return (d == 0 && dim::InvarX::value) || (d == 1 && dim::InvarY::value) ||
+           (d == 2 && dim::InvarZ::value);
+  }
+
+  int size() const { return dims_[0] * dims_[1] * dims_[2]; }
+
+  // ----------------------------------------------------------------------
+  // contains
+  //
+  // whether cell `l` is in the interior of the block
+
+  bool contains(const int l[3]) const
+  {
+    for (int d = 0; d < 3; d++) {
+      if (!invar(d) && (l[d] < lo_[d] || l[d] >= hi_[d])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // ----------------------------------------------------------------------
+  // set_block
+  //
+  // position the tile to start at cell `l`, clipped to the `ldims` interior
+  // cells of the patch
+
+  void set_block(const int l[3], const Int3& ldims)
+  {
+    for (int d = 0; d < 3; d++) {
+      lo_[d] = invar(d) ? 0 : l[d];
+      hi_[d] = invar(d) ? 1 : std::min(l[d] + block_[d], ldims[d]);
+    }
+  }
+
+  Int3 lo() const { return lo_; }
+  Int3 hi() const { return hi_; }
+
+  int index(int i, int j, int k) const
+  {
+    i = dim::InvarX::value ? 0 : i - lo_[0] + N_GHOSTS_L;
+    j = dim::InvarY::value ? 0 : j - lo_[1] + N_GHOSTS_L;
+    k = dim::InvarZ::value ? 0 : k - lo_[2] + N_GHOSTS_L;
+    return (k * dims_[1] + j) * dims_[0] + i;
+  }
+
+  // ----------------------------------------------------------------------
+  // for_each_cell
+  //
+  // visit all cells covered by the tile (incl. ghosts) that also exist in
+  // the patch fields described by `ib`, `im`
+
+  template <typename F>
+  void for_each_cell(const Int3& ib, const Int3& im, F&& f) const
+  {
+    int b[3], e[3];
+    for (int d = 0; d < 3; d++) {
+      if (invar(d)) {
+        b[d] = 0;
+        e[d] = 1;
+      } else {
+        b[d] = std::max(lo_[d] - N_GHOSTS_L, ib[d]);
+        e[d] = std::min(hi_[d] + N_GHOSTS_R, ib[d] + im[d]);
+      }
+    }
+    for (int k = b[2]; k < e[2]; k++) {
+      for (int j = b[1]; j < e[1]; j++) {
+        for (int i = b[0]; i < e[0]; i++) {
+          f(i, j, k);
+        }
+      }
+    }
+  }
+
+private:
+  Int3 block_;
+  Int3 dims_;
+  Int3 lo_;
+  Int3 hi_;
+};
+
+// ======================================================================
+// FldTile
+//
+// read-only copy of EX .. HZ
+
+template <typename R, typename D>
+class FldTile
+{
+public:
+  using value_type = R;
+  using real_t = R;
+  using dim = D;
+
+  FldTile(const Int3& block) : idx_{block}, data_(6 * idx_.size()) {}
+
+  bool contains(const int l[3]) const { return idx_.contains(l); }
+
+  // ----------------------------------------------------------------------
+  // load
+  //
+  // position the tile at cell `l` and copy the fields over from `EM`
+
+  template <typename F>
+  void load(const F& EM, const int l[3], const Int3& ldims)
+  {
+    idx_.set_block(l, ldims);
+    Int3 im = {EM.shape(0), EM.shape(1), EM.shape(2)};
+    idx_.for_each_cell(EM.ib(), im, [&](int i, int j, int k) {
+      int n = idx_.index(i, j, k);
+      for (int m = 0; m < 6; m++) {
+        data_[m * idx_.size() + n] = EM(EX + m, i, j, k);
+      }
+    });
+  }
+
+  real_t operator()(int m, int i, int j, int k) const
+  {
+    return data_[(m - EX) * idx_.size() + idx_.index(i, j, k)];
+  }
+
+private:
+  TileIndexer<D> idx_;
+  std::vector<real_t> data_;
+};
+
+// ======================================================================
+// CurrTile
+//
+// tile-local JXI .. JZI accumulator. The current deposition takes its
+// fields by value, so it gets handed a lightweight CurrTile::View.
+
+template <typename R, typename D>
+class CurrTile
+{
+public:
+  using value_type = R;
+  using real_t = R;
+  using dim = D;
+
+  class View
+  {
+  public:
+    using value_type = R;
+    using real_t = R;
+
+    View(real_t* data, const TileIndexer<D>& idx) : data_{data}, idx_{&idx} {}
+
+    void add(int m, int i, int j, int k, real_t val)
+    {
+      data_[m * idx_->size() + idx_->index(i, j, k)] += val;
+    }
+
+  private:
+    real_t* data_;
+    const TileIndexer<D>* idx_;
+  };
+
+  CurrTile(const Int3& block) : idx_{block}, data_(3 * idx_.size()) {}
+
+  bool contains(const int l[3]) const { return idx_.contains(l); }
+
+  View view() { return {data_.data(), idx_}; }
+
+  // ----------------------------------------------------------------------
+  // start
+  //
+  // position the (zeroed) tile at cell `l`
+
+  void start(const int l[3], const Int3& ldims) { idx_.set_block(l, ldims); }
+
+  // ----------------------------------------------------------------------
+  // flush
+  //
+  // add what's been accumulated to the patch current and zero the tile.
+  // `ib`, `im` describe the extent of the patch fields, `J` is a
+  // curr_cache_t-like object
+
+  template <typename J>
+  void flush(J& curr, const Int3& ib, const Int3& im)
+  {
+    idx_.for_each_cell(ib, im, [&](int i, int j, int k) {
+      int n = idx_.index(i, j, k);
+      for (int m = 0; m < 3; m++) {
+        real_t& val = data_[m * idx_.size() + n];
+        if (val != real_t(0)) {
+          curr.add(m, i, j, k, val);
+          val = real_t(0);
+        }
+      }
+    });
+  }
+
+private:
+  TileIndexer<D> idx_;
+  std::vector<real_t> data_;
+};
@@ -13,10 +13,13 @@ struct Current1vb2d
   using curr_cache_t = CURR_CACHE;
   using real_t = typename curr_cache_t::real_t;
 
-  Current1vb2d(const Grid_t& grid) : dt_(grid.dt), fnqs_(grid.norm.fnqs)
+  Current1vb2d(const Grid_t& grid) : Current1vb2d(grid, grid.dt) {}
+
+  // depositing the current for particles moved over `dt`
+  Current1vb2d(const Grid_t& grid, double dt) : dt_(dt), fnqs_(grid.norm.fnqs)
   {
-    fnqys_ = grid.domain.dx[1] * grid.norm.fnqs / grid.dt;
-    fnqzs_ = grid.domain.dx[2] * grid.norm.fnqs / grid.dt;
+    fnqys_ = grid.domain.dx[1] * grid.norm.fnqs / dt;
+    fnqzs_ = grid.domain.dx[2] * grid.norm.fnqs / dt;
   }
 
   // ----------------------------------------------------------------------
@@ -19,12 +19,15 @@ struct Current1vbVar1
   using real_t = typename fields_t::real_t;
   using Real3 = Vec3<real_t>;
 
-  Current1vbVar1(const Grid_t& grid)
-    : dt_(grid.dt), dxi_{Real3{1., 1., 1.} / Real3(grid.domain.dx)}
+  Current1vbVar1(const Grid_t& grid) : Current1vbVar1(grid, grid.dt) {}
+
+  // depositing the current for particles moved over `dt`
+  Current1vbVar1(const Grid_t& grid, double dt)
+    : dt_(dt), dxi_{Real3{1., 1., 1.} / Real3(grid.domain.dx)}
   {
-    fnqxs_ = grid.domain.dx[0] * grid.norm.fnqs / grid.dt;
-    fnqys_ = grid.domain.dx[1] * grid.norm.fnqs / grid.dt;
-    fnqzs_ = grid.domain.dx[2] * grid.norm.fnqs / grid.dt;
+    fnqxs_ = grid.domain.dx[0] * grid.norm.fnqs / dt;
+    fnqys_ = grid.domain.dx[1] * grid.norm.fnqs / dt;
+    fnqzs_ = grid.domain.dx[2] * grid.norm.fnqs / dt;
   }
 
   void calc_j(fields_t curr_cache, real_t* xm, real_t* xp, int* lf, int* lg,
@@ -13,10 +13,13 @@ struct CurrentZigzag
   using real_t = typename fields_t::value_type;
   using Real3 = Vec3<real_t>;
 
-  CurrentZigzag(const Grid_t& grid)
-    : dt_(grid.dt),
+  CurrentZigzag(const Grid_t& grid) : CurrentZigzag(grid, grid.dt) {}
+
+  // depositing the current for particles moved over `dt`
+  CurrentZigzag(const Grid_t& grid, double dt)
+    : dt_(dt),
       dxi_{Real3{1., 1., 1.} / Real3(grid.domain.dx)},
-      deposition_(real_t(grid.norm.fnqs / grid.dt) * Real3(grid.domain.dx))
+      deposition_(real_t(grid.norm.fnqs / dt) * Real3(grid.domain.dx))
   {}
 
   void calc_j2_one_cell(fields_t curr_cache, real_t qni_wni, real_t xm[3],
@@ -11,8 +11,10 @@
 #include "push_particles.hxx"
 #include "push_particles_esirkepov.hxx"
 #include "push_particles_1vb.hxx"
+#include "field_tiles.hxx"
 
 #include <psc/gtensor.h>
+#include <psc/simd.hxx>
 
 template <typename fields_t>
 class curr_cache_t
@@ -58,11 +60,51 @@ struct PushpConfigVb
   using MfieldsState = _MfieldsState;
   using Dim = _Dim;
   using InterpolateEM_t = _InterpolateEM;
-  using Current_t =
-    _Current<_Order, _Dim, curr_cache_t<typename _MfieldsState::fields_view_t>>;
+  using CurrCache_t = curr_cache_t<typename _MfieldsState::fields_view_t>;
+  using Current_t = _Current<_Order, _Dim, CurrCache_t>;
   using AdvanceParticle_t = AdvanceParticle<typename Mparticles::real_t, Dim>;
 };
 
+// ----------------------------------------------------------------------
+// PushpConfigVbSimd
+//
+// same as PushpConfigVb, but PushParticlesVb will push Simd::size()
+// particles at a time
+
+template <typename _Mparticles, typename _MfieldsState, typename _InterpolateEM,
+          typename _Dim, typename _Order,
+          template <typename, typename, typename> class _Current,
+          typename _Simd = psc::simd::native<typename _Mparticles::real_t>>
+struct PushpConfigVbSimd
+  : PushpConfigVb<_Mparticles, _MfieldsState, _InterpolateEM, _Dim, _Order,
+                  _Current>
+{
+  using Simd = _Simd;
+};
+
+// ----------------------------------------------------------------------
+// PushpConfigVbTile
+//
+// same as PushpConfigVb, but PushParticlesVb will interpolate from / deposit
+// into per-block FldTile / CurrTile copies of the fields rather than the
+// patch fields themselves
+
+template <typename _Mparticles, typename _MfieldsState, typename _InterpolateEM,
+          typename _Dim, typename _Order,
+          template <typename, typename, typename> class _Current,
+          int _BlockSize = 16>
+struct PushpConfigVbTile
+  : PushpConfigVb<_Mparticles, _MfieldsState, _InterpolateEM, _Dim, _Order,
+                  _Current>
+{
+  using real_t = typename _Mparticles::real_t;
+  using FldTile_t = FldTile<real_t, _Dim>;
+  using CurrTile_t = CurrTile<real_t, _Dim>;
+  using Current_t = _Current<_Order, _Dim, typename CurrTile_t::View>;
+
+  static const int block_size = _BlockSize;
+};
+
 #include "psc_particles_double.h"
 #include "psc_particles_single.h"
 #include "psc_fields_c.h"
@@ -93,6 +135,38 @@ using Config1vbecSplit =
                   Fields3d<typename MfieldsState::fields_view_t::Storage>, dim>,
                 dim, opt_order_1st, Current1vbSplit>;
 
+template <typename Mparticles, typename MfieldsState, typename dim>
+using Config1vbecSimd =
+  PushpConfigVbSimd<Mparticles, MfieldsState,
+                    InterpolateEM1vbec<
+                      Fields3d<typename MfieldsState::fields_view_t::Storage>,
+                      dim>,
+                    dim, opt_order_1st, Current1vbVar1>;
+
+template <typename Mparticles, typename MfieldsState, typename dim>
+using Config1vbecSplitSimd =
+  PushpConfigVbSimd<Mparticles, MfieldsState,
+                    InterpolateEM1vbec<
+                      Fields3d<typename MfieldsState::fields_view_t::Storage>,
+                      dim>,
+                    dim, opt_order_1st, Current1vbSplit>;
+
+template <typename Mparticles, typename MfieldsState, typename dim>
+using Config1vbecTile =
+  PushpConfigVbTile<Mparticles, MfieldsState,
+                    InterpolateEM1vbec<
+                      Fields3d<typename MfieldsState::fields_view_t::Storage>,
+                      dim>,
+                    dim, opt_order_1st, Current1vbVar1>;
+
+template <typename Mparticles, typename MfieldsState, typename dim>
+using Config1vbecSplitTile =
+  PushpConfigVbTile<Mparticles, MfieldsState,
+                    InterpolateEM1vbec<
+                      Fields3d<typename MfieldsState::fields_view_t::Storage>,
+                      dim>,
+                    dim, opt_order_1st, Current1vbSplit>;
+
 template <typename dim>
 using Config1vbecDouble =
   Config1vbec<MparticlesDouble, MfieldsStateDouble, dim>;
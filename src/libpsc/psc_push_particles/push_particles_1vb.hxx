@@ -1,11 +1,20 @@
 
+#pragma once
+
+#include "particles_simple.hxx"
+
+#include <psc/simd.hxx>
+
+#include <algorithm>
+#include <type_traits>
+
 // ======================================================================
 // PushParticlesVb
 
 template <typename C>
 struct PushParticlesVb
 {
-  static const int MAX_NR_KINDS = 10;
+  static const int MAX_NR_KINDS = 32; // one bit each in kind_mask
 
   using Mparticles = typename C::Mparticles;
   using MfieldsState = typename C::MfieldsState;
@@ -18,74 +27,460 @@ struct PushParticlesVb
 
   using checks_order = checks_order_1st;
 
+  static const unsigned ALL_KINDS = ~0u;
+
   // ----------------------------------------------------------------------
   // push_mprts
 
   static void push_mprts(Mparticles& mprts, MfieldsState& mflds)
+  {
+    push_mprts(mprts, mflds, ALL_KINDS, 1);
+  }
+
+  // ----------------------------------------------------------------------
+  // push_mprts
+  //
+  // only pushes the kinds whose bit is set in `kind_mask`, by n_sub * dt,
+  // depositing their current averaged over that time (for subcycling)
+
+  static void push_mprts(Mparticles& mprts, MfieldsState& mflds,
+                         unsigned kind_mask, int n_sub)
   {
     const auto& grid = mprts.grid();
     PI<real_t> pi(grid);
     Real3 dxi = Real3{1., 1., 1.} / Real3(grid.domain.dx);
+    double dt = n_sub * grid.dt;
     real_t dq_kind[MAX_NR_KINDS];
     auto& kinds = grid.kinds;
     assert(kinds.size() <= MAX_NR_KINDS);
     for (int k = 0; k < kinds.size(); k++) {
-      dq_kind[k] = .5f * grid.norm.eta * grid.dt * kinds[k].q / kinds[k].m;
+      dq_kind[k] = .5f * grid.norm.eta * dt * kinds[k].q / kinds[k].m;
     }
-    InterpolateEM_t ip;
-    AdvanceParticle_t advance(grid.dt);
-    Current current(grid);
+    AdvanceParticle_t advance(dt);
 
+    // patches are independent: each one only deposits into its own JXI..JZI
+    // slab (incl. ghosts, which get added up later), so they can be pushed
+    // concurrently. the interpolation coefficients / current state live in
+    // ip / current, so those have to be private to each thread.
     auto accessor = mprts.accessor_();
+#pragma omp parallel for schedule(dynamic)
     for (int p = 0; p < mflds.n_patches(); p++) {
+      PatchTimer timer(p);
+      Current current(grid, dt);
       auto flds = mflds[p];
-      auto prts = accessor[p];
       typename InterpolateEM_t::fields_t EM(flds.storage(), flds.ib());
-      typename Current::fields_t J(flds);
+      typename C::CurrCache_t J(flds);
 
       flds.storage().view(_all, _all, _all, _s(JXI, JXI + 3)) = real_t(0);
 
-      for (auto prt : prts) {
-        Real3& x = prt.x();
+      for_each_push_range(mprts, p, kind_mask, [&](const PushRange& range) {
+        push_patch(mprts, accessor, p, EM, J, current, advance, pi, dxi,
+                   dq_kind, range, KernelTag{});
+      });
+    }
+  }
 
-        real_t xm[3];
-        for (int d = 0; d < 3; d++) {
-          xm[d] = x[d] * dxi[d];
-        }
-        ip.set_coeffs(xm);
+private:
+  // which push_patch() to use, depending on what the config asks for
 
-        // FIELD INTERPOLATION
-        Real3 E = {ip.ex(EM), ip.ey(EM), ip.ez(EM)};
-        Real3 H = {ip.hx(EM), ip.hy(EM), ip.hz(EM)};
+  struct ScalarKernel
+  {};
+  struct SimdKernel
+  {};
+  struct TileKernel
+  {};
+
+  template <typename Config, typename Enable = void>
+  struct kernel_tag
+  {
+    using type = ScalarKernel;
+  };
+
+  template <typename Config>
+  struct kernel_tag<Config, gt::meta::void_t<typename Config::Simd>>
+  {
+    using type = SimdKernel;
+  };
+
+  template <typename Config>
+  struct kernel_tag<Config, gt::meta::void_t<typename Config::FldTile_t>>
+  {
+    using type = TileKernel;
+  };
+
+  using KernelTag = typename kernel_tag<C>::type;
+
+  // ----------------------------------------------------------------------
+  // push_patch
+  //
+  // scalar version, one particle at a time
 
-        // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
-        real_t dq = dq_kind[prt.kind()];
-        advance.push_p(prt.u(), E, H, dq);
+  template <typename Accessor, typename FE, typename FJ>
+  static void push_patch(Mparticles& mprts, Accessor& accessor, int p,
+                         const FE& EM, FJ& J, Current& current,
+                         AdvanceParticle_t& advance, PI<real_t>& pi,
+                         const Real3& dxi, const real_t* dq_kind,
+                         const PushRange& range, ScalarKernel)
+  {
+    InterpolateEM_t ip;
+    auto prts = accessor[p];
+    real_t dq_range = range.kind >= 0 ? dq_kind[range.kind] : real_t(0);
+
+    for (unsigned int n = range.begin; n < range.end; n++) {
+      auto prt = prts[n];
+      if (range.kind < 0 && !range.pushes(prt.kind())) {
+        continue;
+      }
+      Real3& x = prt.x();
+
+      real_t xm[3];
+      for (int d = 0; d < 3; d++) {
+        xm[d] = x[d] * dxi[d];
+      }
+      ip.set_coeffs(xm);
+
+      // FIELD INTERPOLATION
+      Real3 E = {ip.ex(EM), ip.ey(EM), ip.ez(EM)};
+      Real3 H = {ip.hx(EM), ip.hy(EM), ip.hz(EM)};
+
+      // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
+      real_t dq = range.kind >= 0 ? dq_range : dq_kind[prt.kind()];
+      advance.push_p(prt.u(), E, H, dq);
+
+      // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
+      auto v = advance.calc_v(prt.u());
+      advance.push_x(x, v);
+
+      int lf[3];
+      real_t of[3], xp[3];
+      pi.find_idx_off_pos_1st_rel(x, lf, of, xp, real_t(0.));
+
+      // CURRENT DENSITY BETWEEN (n+.5)*dt and (n+1.5)*dt
+      int lg[3];
+      if (!Dim::InvarX::value) {
+        lg[0] = ip.cx.g.l;
+      }
+      if (!Dim::InvarY::value) {
+        lg[1] = ip.cy.g.l;
+      }
+      if (!Dim::InvarZ::value) {
+        lg[2] = ip.cz.g.l;
+      }
+      current.calc_j(J, xm, xp, lf, lg, prt.qni_wni(), v);
+    }
+  }
 
-        // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
-        auto v = advance.calc_v(prt.u());
-        advance.push_x(x, v);
+  // ----------------------------------------------------------------------
+  // push_patch
+  //
+  // SIMD version: particles are pushed in batches of Simd::size() lanes.
+  // The field gather is a loop over lanes (which the compiler can turn into
+  // vector gathers), the momentum / position update is done on whole packs
+  // using the same AdvanceParticle code as the scalar version, and the
+  // current deposition, which scatters into overlapping cells, is done one
+  // lane at a time.
+
+  template <typename Accessor, typename FE, typename FJ>
+  static void push_patch(Mparticles& mprts, Accessor& accessor, int p,
+                         const FE& EM, FJ& J, Current& current,
+                         AdvanceParticle_t& advance, PI<real_t>& pi,
+                         const Real3& dxi, const real_t* dq_kind,
+                         const PushRange& range, SimdKernel)
+  {
+    using Simd = typename C::Simd;
+    using Simd3 = Vec3<Simd>;
+    constexpr int N = Simd::size();
+
+    AdvanceParticle<Simd, Dim> advance_simd(advance.dt());
+    auto&& buf = mprts.storage()[p];
+    int n_end = range.end;
+
+    for (int n0 = range.begin; n0 < n_end; n0 += N) {
+      int n_lanes = std::min(N, n_end - n0);
+
+      Simd3 x, u;
+      Simd qni_wni;
+      int kind[N];
+      load_lanes(buf, n0, n_lanes, x, u, qni_wni, kind);
+
+      // lanes of kinds that aren't being pushed go along for the ride, but
+      // aren't deposited and get their original x, u stored back
+      bool active[N];
+      int n_active = 0;
+      for (int l = 0; l < n_lanes; l++) {
+        active[l] = range.pushes(kind[l]);
+        n_active += active[l];
+      }
+      if (n_active == 0) {
+        continue;
+      }
+      Simd3 x0 = x, u0 = u;
+
+      Simd3 xm;
+      for (int d = 0; d < 3; d++) {
+        xm[d] = x[d] * Simd(dxi[d]);
+      }
+
+      // FIELD INTERPOLATION
+      Simd3 E, H;
+      Simd dq;
+      int lg[3][N];
+      PSC_PRAGMA_SIMD
+      for (int l = 0; l < N; l++) {
+        InterpolateEM_t ip;
+        real_t xm_l[3] = {xm[0][l], xm[1][l], xm[2][l]};
+        ip.set_coeffs(xm_l);
+        E[0][l] = ip.ex(EM);
+        E[1][l] = ip.ey(EM);
+        E[2][l] = ip.ez(EM);
+        H[0][l] = ip.hx(EM);
+        H[1][l] = ip.hy(EM);
+        H[2][l] = ip.hz(EM);
+        lg[0][l] = ip.cx.g.l;
+        lg[1][l] = ip.cy.g.l;
+        lg[2][l] = ip.cz.g.l;
+        dq[l] = dq_kind[range.kind >= 0 ? range.kind : kind[l]];
+      }
+
+      // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
+      advance_simd.push_p(u, E, H, dq);
 
-        int lf[3];
-        real_t of[3], xp[3];
-        pi.find_idx_off_pos_1st_rel(x, lf, of, xp, real_t(0.));
+      // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
+      auto v = advance_simd.calc_v(u);
+      advance_simd.push_x(x, v);
+
+      Simd3 xp;
+      for (int d = 0; d < 3; d++) {
+        xp[d] = x[d] * Simd(dxi[d]);
+      }
 
-        // CURRENT DENSITY BETWEEN (n+.5)*dt and (n+1.5)*dt
-        int lg[3];
-        if (!Dim::InvarX::value) {
-          lg[0] = ip.cx.g.l;
+      // CURRENT DENSITY BETWEEN (n+.5)*dt and (n+1.5)*dt
+      for (int l = 0; l < n_lanes; l++) {
+        if (!active[l]) {
+          continue;
         }
-        if (!Dim::InvarY::value) {
-          lg[1] = ip.cy.g.l;
+        real_t xm_l[3], xp_l[3], v_l[3];
+        int lf_l[3], lg_l[3];
+        for (int d = 0; d < 3; d++) {
+          xm_l[d] = xm[d][l];
+          xp_l[d] = xp[d][l];
+          v_l[d] = v[d][l];
+          lf_l[d] = fint(xp_l[d]);
+          lg_l[d] = lg[d][l];
+        }
+        current.calc_j(J, xm_l, xp_l, lf_l, lg_l, qni_wni[l], v_l);
+      }
+
+      if (n_active < n_lanes) {
+        for (int l = 0; l < n_lanes; l++) {
+          if (!active[l]) {
+            for (int d = 0; d < 3; d++) {
+              x[d][l] = x0[d][l];
+              u[d][l] = u0[d][l];
+            }
+          }
         }
-        if (!Dim::InvarZ::value) {
-          lg[2] = ip.cz.g.l;
+      }
+      store_lanes(buf, n0, n_lanes, x, u);
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // push_patch
+  //
+  // tiled version: E/H are read from, and J deposited into, small FldTile /
+  // CurrTile copies covering the block of cells the current particle is in.
+  // Whenever a particle falls outside the current block, the J tile is added
+  // back to the patch and both tiles are moved to a new block starting at
+  // that particle's cell. Blocks are runs of C::block_size cells along the
+  // first non-invariant direction, so with cell-sorted particles, each
+  // block is visited just once.
+
+  template <typename Accessor, typename FE, typename FJ>
+  static void push_patch(Mparticles& mprts, Accessor& accessor, int p,
+                         const FE& EM, FJ& J, Current& current,
+                         AdvanceParticle_t& advance, PI<real_t>& pi,
+                         const Real3& dxi, const real_t* dq_kind,
+                         const PushRange& range, TileKernel)
+  {
+    using FldTile = typename C::FldTile_t;
+    using CurrTile = typename C::CurrTile_t;
+    using InterpolateTile_t =
+      typename InterpolateEM_t::template rebind<FldTile>;
+
+    const Int3& ldims = mprts.grid().ldims;
+    Int3 block = {1, 1, 1};
+    for (int d = 0; d < 3; d++) {
+      if (ldims[d] > 1) {
+        block[d] = C::block_size;
+        break;
+      }
+    }
+    Int3 ib = EM.ib();
+    Int3 im = {EM.shape(0), EM.shape(1), EM.shape(2)};
+
+    FldTile em_tile(block);
+    CurrTile j_tile(block);
+    auto J_tile = j_tile.view();
+    bool have_tile = false;
+
+    InterpolateTile_t ip;
+    auto prts = accessor[p];
+    real_t dq_range = range.kind >= 0 ? dq_kind[range.kind] : real_t(0);
+
+    for (unsigned int n = range.begin; n < range.end; n++) {
+      auto prt = prts[n];
+      if (range.kind < 0 && !range.pushes(prt.kind())) {
+        continue;
+      }
+      Real3& x = prt.x();
+
+      real_t xm[3];
+      int l[3];
+      for (int d = 0; d < 3; d++) {
+        xm[d] = x[d] * dxi[d];
+        l[d] = fint(xm[d]);
+      }
+
+      if (!have_tile || !em_tile.contains(l)) {
+        if (have_tile) {
+          j_tile.flush(J, ib, im);
         }
-        current.calc_j(J, xm, xp, lf, lg, prt.qni_wni(), v);
+        em_tile.load(EM, l, ldims);
+        j_tile.start(l, ldims);
+        have_tile = true;
+      }
+
+      ip.set_coeffs(xm);
+
+      // FIELD INTERPOLATION
+      Real3 E = {ip.ex(em_tile), ip.ey(em_tile), ip.ez(em_tile)};
+      Real3 H = {ip.hx(em_tile), ip.hy(em_tile), ip.hz(em_tile)};
+
+      // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
+      real_t dq = range.kind >= 0 ? dq_range : dq_kind[prt.kind()];
+      advance.push_p(prt.u(), E, H, dq);
+
+      // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
+      auto v = advance.calc_v(prt.u());
+      advance.push_x(x, v);
+
+      int lf[3];
+      real_t of[3], xp[3];
+      pi.find_idx_off_pos_1st_rel(x, lf, of, xp, real_t(0.));
+
+      // CURRENT DENSITY BETWEEN (n+.5)*dt and (n+1.5)*dt
+      int lg[3];
+      if (!Dim::InvarX::value) {
+        lg[0] = ip.cx.g.l;
+      }
+      if (!Dim::InvarY::value) {
+        lg[1] = ip.cy.g.l;
+      }
+      if (!Dim::InvarZ::value) {
+        lg[2] = ip.cz.g.l;
+      }
+      current.calc_j(J_tile, xm, xp, lf, lg, prt.qni_wni(), v);
+    }
+
+    if (have_tile) {
+      j_tile.flush(J, ib, im);
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // load_lanes / store_lanes
+  //
+  // move particles n0 .. n0 + n_lanes between storage and packs. Unused
+  // lanes of the last batch are filled with copies of the last particle,
+  // so that they still interpolate from valid cells, and are never stored.
+
+  template <typename Simd>
+  static void load_lanes(Span<typename Mparticles::Particle> buf, int n0,
+                         int n_lanes, Vec3<Simd>& x, Vec3<Simd>& u,
+                         Simd& qni_wni, int* kind)
+  {
+    for (int l = 0; l < Simd::size(); l++) {
+      const auto& prt = buf.begin()[n0 + std::min(l, n_lanes - 1)];
+      for (int d = 0; d < 3; d++) {
+        x[d][l] = prt.x[d];
+        u[d][l] = prt.u[d];
+      }
+      qni_wni[l] = prt.qni_wni;
+      kind[l] = prt.kind;
+    }
+  }
+
+  template <typename Simd>
+  static void store_lanes(Span<typename Mparticles::Particle> buf, int n0,
+                          int n_lanes, const Vec3<Simd>& x, const Vec3<Simd>& u)
+  {
+    for (int l = 0; l < n_lanes; l++) {
+      auto& prt = buf.begin()[n0 + l];
+      for (int d = 0; d < 3; d++) {
+        prt.x[d] = x[d][l];
+        prt.u[d] = u[d][l];
+      }
+    }
+  }
+
+  // with structure-of-arrays storage, full batches are plain vector loads
+
+  template <typename Simd, typename P>
+  static void load_lanes(ParticleBufferSoA<P>& buf, int n0, int n_lanes,
+                         Vec3<Simd>& x, Vec3<Simd>& u, Simd& qni_wni,
+                         int* kind)
+  {
+    if (n_lanes < Simd::size()) {
+      load_lanes_partial(buf, n0, n_lanes, x, u, qni_wni, kind);
+      return;
+    }
+    for (int d = 0; d < 3; d++) {
+      x[d] = Simd::load(buf.x(d) + n0);
+      u[d] = Simd::load(buf.u(d) + n0);
+    }
+    qni_wni = Simd::load(buf.qni_wni() + n0);
+    for (int l = 0; l < Simd::size(); l++) {
+      kind[l] = buf.kind()[n0 + l];
+    }
+  }
+
+  template <typename Simd, typename P>
+  static void load_lanes_partial(ParticleBufferSoA<P>& buf, int n0,
+                                 int n_lanes, Vec3<Simd>& x, Vec3<Simd>& u,
+                                 Simd& qni_wni, int* kind)
+  {
+    for (int l = 0; l < Simd::size(); l++) {
+      int n = n0 + std::min(l, n_lanes - 1);
+      for (int d = 0; d < 3; d++) {
+        x[d][l] = buf.x(d)[n];
+        u[d][l] = buf.u(d)[n];
+      }
+      qni_wni[l] = buf.qni_wni()[n];
+      kind[l] = buf.kind()[n];
+    }
+  }
+
+  template <typename Simd, typename P>
+  static void store_lanes(ParticleBufferSoA<P>& buf, int n0, int n_lanes,
+                          const Vec3<Simd>& x, const Vec3<Simd>& u)
+  {
+    if (n_lanes == Simd::size()) {
+      for (int d = 0; d < 3; d++) {
+        x[d].store(buf.x(d) + n0);
+        u[d].store(buf.u(d) + n0);
+      }
+      return;
+    }
+    for (int l = 0; l < n_lanes; l++) {
+      for (int d = 0; d < 3; d++) {
+        buf.x(d)[n0 + l] = x[d][l];
+        buf.u(d)[n0 + l] = u[d][l];
       }
     }
   }
 
+public:
   // ----------------------------------------------------------------------
   // stagger_mprts_patch
 
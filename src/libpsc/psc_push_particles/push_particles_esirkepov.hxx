@@ -10,7 +10,7 @@
 template <typename C>
 struct PushParticlesEsirkepov
 {
-  static const int MAX_NR_KINDS = 10;
+  static const int MAX_NR_KINDS = 32; // one bit each in kind_mask
 
   using Mparticles = typename C::Mparticles;
   using MfieldsState = typename C::MfieldsState;
@@ -26,25 +26,43 @@ struct PushParticlesEsirkepov
   using checks_order =
     checks_order_2nd; // FIXME, sometimes 1st even with Esirkepov
 
+  static const unsigned ALL_KINDS = ~0u;
+
   // ----------------------------------------------------------------------
   // push_mprts
 
   static void push_mprts(Mparticles& mprts, MfieldsState& mflds)
+  {
+    push_mprts(mprts, mflds, ALL_KINDS, 1);
+  }
+
+  // ----------------------------------------------------------------------
+  // push_mprts
+  //
+  // see PushParticlesVb::push_mprts, only pushes the kinds in `kind_mask`
+  // by n_sub * dt
+
+  static void push_mprts(Mparticles& mprts, MfieldsState& mflds,
+                         unsigned kind_mask, int n_sub)
   {
     const auto& grid = mprts.grid();
     Real3 dxi = Real3{1., 1., 1.} / Real3(grid.domain.dx);
+    double dt = n_sub * grid.dt;
     real_t dq_kind[MAX_NR_KINDS];
     auto& kinds = grid.kinds;
     assert(kinds.size() <= MAX_NR_KINDS);
     for (int k = 0; k < kinds.size(); k++) {
-      dq_kind[k] = .5f * grid.norm.eta * grid.dt * kinds[k].q / kinds[k].m;
+      dq_kind[k] = .5f * grid.norm.eta * dt * kinds[k].q / kinds[k].m;
     }
-    InterpolateEM_t ip;
-    AdvanceParticle_t advance(grid.dt);
-    Current current(grid);
+    AdvanceParticle_t advance(dt);
 
+    // see PushParticlesVb::push_mprts, patches can be pushed concurrently
     auto accessor = mprts.accessor_();
+#pragma omp parallel for schedule(dynamic)
     for (int p = 0; p < mflds.n_patches(); p++) {
+      PatchTimer timer(p);
+      InterpolateEM_t ip;
+      Current current(grid, dt);
       auto flds = mflds[p];
       auto prts = accessor[p];
       typename InterpolateEM_t::fields_t EM(flds.storage(), flds.ib());
@@ -52,37 +70,58 @@ struct PushParticlesEsirkepov
 
       flds.storage().view(_all, _all, _all, _s(JXI, JXI + 3)) = real_t(0);
 
-      for (auto prt : prts) {
-        Real3& x = prt.x();
+      for_each_push_range(mprts, p, kind_mask, [&](const PushRange& range) {
+        push_range(prts, range, ip, current, EM, J, advance, dxi, dq_kind);
+      });
+    }
+  }
 
-        real_t xm[3];
-        for (int d = 0; d < 3; d++) {
-          xm[d] = x[d] * dxi[d];
-        }
-        ip.set_coeffs(xm);
+private:
+  // ----------------------------------------------------------------------
+  // push_range
+
+  template <typename Patch, typename FE, typename FJ>
+  static void push_range(Patch& prts, const PushRange& range,
+                         InterpolateEM_t& ip, Current& current, const FE& EM,
+                         FJ& J, AdvanceParticle_t& advance, const Real3& dxi,
+                         const real_t* dq_kind)
+  {
+    real_t dq_range = range.kind >= 0 ? dq_kind[range.kind] : real_t(0);
+
+    for (unsigned int n = range.begin; n < range.end; n++) {
+      auto prt = prts[n];
+      if (range.kind < 0 && !range.pushes(prt.kind())) {
+        continue;
+      }
+      Real3& x = prt.x();
+
+      real_t xm[3];
+      for (int d = 0; d < 3; d++) {
+        xm[d] = x[d] * dxi[d];
+      }
+      ip.set_coeffs(xm);
 
-        // CHARGE DENSITY FORM FACTOR AT (n+.5)*dt
-        current.charge_before(ip);
+      // CHARGE DENSITY FORM FACTOR AT (n+.5)*dt
+      current.charge_before(ip);
 
-        // FIELD INTERPOLATION
-        Real3 E = {ip.ex(EM), ip.ey(EM), ip.ez(EM)};
-        Real3 H = {ip.hx(EM), ip.hy(EM), ip.hz(EM)};
+      // FIELD INTERPOLATION
+      Real3 E = {ip.ex(EM), ip.ey(EM), ip.ez(EM)};
+      Real3 H = {ip.hx(EM), ip.hy(EM), ip.hz(EM)};
 
-        // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
-        real_t dq = dq_kind[prt.kind()];
-        advance.push_p(prt.u(), E, H, dq);
+      // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
+      real_t dq = range.kind >= 0 ? dq_range : dq_kind[prt.kind()];
+      advance.push_p(prt.u(), E, H, dq);
 
-        // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
-        auto v = advance.calc_v(prt.u());
-        advance.push_x(x, v);
+      // x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
+      auto v = advance.calc_v(prt.u());
+      advance.push_x(x, v);
 
-        // CHARGE DENSITY FORM FACTOR AT (n+1.5)*dt
-        current.charge_after(x);
+      // CHARGE DENSITY FORM FACTOR AT (n+1.5)*dt
+      current.charge_after(x);
 
-        // CURRENT DENSITY AT (n+1.0)*dt
-        current.prep(prt.qni_wni(), v);
-        current.calc(J);
-      }
+      // CURRENT DENSITY AT (n+1.0)*dt
+      current.prep(prt.qni_wni(), v);
+      current.calc(J);
     }
   }
 };
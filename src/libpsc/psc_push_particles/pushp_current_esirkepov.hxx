@@ -172,12 +172,15 @@ struct CurrentEsirkepov
   using Real3 = Vec3<real_t>;
   using fields_t = Fields;
 
-  CurrentEsirkepov(const Grid_t& grid)
+  CurrentEsirkepov(const Grid_t& grid) : CurrentEsirkepov(grid, grid.dt) {}
+
+  // depositing the current for particles moved over `dt`
+  CurrentEsirkepov(const Grid_t& grid, double dt)
     : dxi_{Real3{1., 1., 1.} / Real3(grid.domain.dx)}, fnqs_(grid.norm.fnqs)
   {
-    fnqxs_ = grid.domain.dx[0] * fnqs_ / grid.dt;
-    fnqys_ = grid.domain.dx[1] * fnqs_ / grid.dt;
-    fnqzs_ = grid.domain.dx[2] * fnqs_ / grid.dt;
+    fnqxs_ = grid.domain.dx[0] * fnqs_ / dt;
+    fnqys_ = grid.domain.dx[1] * fnqs_ / dt;
+    fnqzs_ = grid.domain.dx[2] * fnqs_ / dt;
   }
 
   void charge_before(const IP& ip)
@@ -0,0 +1,306 @@
+
+#pragma once
+
+#include "reweight.hxx"
+
+#include "balance.hxx"
+#include "rng_philox.hxx"
+#include <scratch_arena.hxx>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+// ======================================================================
+// Reweight_
+//
+// Keeps the number of macro-particles per cell and kind within
+// [n_min, n_max]:
+//
+// - In cells with more than n_max particles, the lightest ones are merged.
+//   They're grouped by momentum (octant first, then energy), and each
+//   group of k particles is replaced by two particles of half the group's
+//   weight each, at the group's center of charge. Their momenta are chosen
+//   symmetrically around the group's mean momentum so that total charge,
+//   momentum and kinetic energy are conserved exactly (Vranic et al., CPC
+//   191, 65 (2015)).
+//
+// - In cells with fewer than n_min particles, the heaviest ones are split
+//   in two of half the weight and the same momentum, displaced
+//   symmetrically (so the center of charge stays put) by a random amount
+//   that keeps both in the same cell.
+//
+// The particles end up sorted by cell, and by kind within each cell.
+
+template <typename MP>
+struct Reweight_
+{
+  using Mparticles = MP;
+  using Particle = typename Mparticles::Particle;
+  using real_t = typename Particle::real_t;
+  using Real3 = Vec3<real_t>;
+
+  Reweight_(const ReweightParams& params = {}) : prm_{params} {}
+
+  void operator()(Mparticles& mprts)
+  {
+    const auto& grid = mprts.grid();
+    int n_kinds = grid.kinds.size();
+    const Int3& ldims = grid.ldims;
+    unsigned int n_keys = ldims[0] * ldims[1] * ldims[2] * n_kinds;
+    auto& arena = psc::ScratchArena::get();
+
+    out_.resize(mprts.n_patches());
+    std::vector<uint> n_prts_by_patch(mprts.n_patches());
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      PatchTimer timer(p);
+      psc::ScratchArena::Scope scope(arena);
+      auto&& prts = mprts[p];
+      unsigned int n_prts = prts.size();
+
+      // counting sort of the particle indices by (cell, kind)
+      unsigned int* keys = arena.alloc<unsigned int>(n_prts);
+      unsigned int* offsets = arena.calloc<unsigned int>(n_keys + 1);
+      for (unsigned int n = 0; n < n_prts; n++) {
+        const Particle& prt = prts[n];
+        keys[n] = prts.validCellIndex(prt) * n_kinds + prt.kind;
+        offsets[keys[n] + 1]++;
+      }
+      for (unsigned int k = 0; k < n_keys; k++) {
+        offsets[k + 1] += offsets[k];
+      }
+      unsigned int* order = arena.alloc<unsigned int>(n_prts);
+      {
+        unsigned int* pos = arena.alloc<unsigned int>(n_keys);
+        std::copy(offsets, offsets + n_keys, pos);
+        for (unsigned int n = 0; n < n_prts; n++) {
+          order[pos[keys[n]]++] = n;
+        }
+      }
+
+      // gather the new contents of the patch in sorted order. Only the
+      // cells that get merged or split go through cell_ first.
+      auto& out = out_[p];
+      out.clear();
+      out.reserve(n_prts);
+      for (unsigned int k = 0; k < n_keys; k++) {
+        unsigned int n_begin = offsets[k], n_end = offsets[k + 1];
+        int n = n_end - n_begin;
+        bool do_merge = prm_.n_max > 0 && n > prm_.n_max;
+        bool do_split = prm_.n_min > 0 && n > 0 && n < prm_.n_min;
+        if (!do_merge && !do_split) {
+          for (unsigned int i = n_begin; i < n_end; i++) {
+            out.push_back(prts[order[i]]);
+          }
+          continue;
+        }
+
+        cell_.clear();
+        for (unsigned int i = n_begin; i < n_end; i++) {
+          cell_.push_back(prts[order[i]]);
+        }
+        if (do_merge) {
+          merge(mprts, cell_);
+        } else {
+          split(mprts, p, k / n_kinds, cell_);
+        }
+        out.insert(out.end(), cell_.begin(), cell_.end());
+      }
+      n_prts_by_patch[p] = out.size();
+    }
+
+    mprts.reserve_all(n_prts_by_patch);
+    mprts.resize_all(n_prts_by_patch);
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      PatchTimer timer(p);
+      auto&& prts = mprts[p];
+      const auto& out = out_[p];
+      for (unsigned int n = 0; n < out.size(); n++) {
+        prts[n] = out[n];
+      }
+    }
+  }
+
+private:
+  static real_t gamma(const Real3& u)
+  {
+    return std::sqrt(real_t(1.) + sqr(u[0]) + sqr(u[1]) + sqr(u[2]));
+  }
+
+  // ----------------------------------------------------------------------
+  // merge
+  //
+  // reduce the number of particles in `cell` (all of the same kind, in
+  // the same cell) to at most n_max
+
+  void merge(Mparticles& mprts, std::vector<Particle>& cell)
+  {
+    int n = cell.size();
+    int n_max = prm_.n_max;
+    assert(n_max >= 2);
+    // group size such that merging all particles would get to n_max
+    int k = std::max(3, (2 * n + n_max - 1) / n_max);
+    int n_remove = n - n_max;
+    // n / k whole groups may fall short of that, then make them bigger
+    // (k = n always works, as n_max >= 2)
+    while (n / k * (k - 2) < n_remove) {
+      k++;
+    }
+    int n_groups = (n_remove + k - 3) / (k - 2);
+
+    // the lightest n_groups * k particles go to the front, and get
+    // ordered by momentum octant, then energy
+    auto mid = cell.begin() + n_groups * k;
+    std::nth_element(cell.begin(), mid, cell.end(),
+                     [](const Particle& a, const Particle& b) {
+                       return std::abs(a.qni_wni) < std::abs(b.qni_wni);
+                     });
+    auto octant = [](const Particle& prt) {
+      return (prt.u[0] < 0) + 2 * (prt.u[1] < 0) + 4 * (prt.u[2] < 0);
+    };
+    std::sort(cell.begin(), mid, [&](const Particle& a, const Particle& b) {
+      int oa = octant(a), ob = octant(b);
+      return oa < ob || (oa == ob && gamma(a.u) < gamma(b.u));
+    });
+
+    std::vector<Particle> merged;
+    merged.reserve(2 * n_groups + (cell.end() - mid));
+    for (int g = 0; g < n_groups; g++) {
+      merge_group(mprts, &cell[g * k], k, merged);
+    }
+    merged.insert(merged.end(), mid, cell.end());
+    cell.swap(merged);
+  }
+
+  // ----------------------------------------------------------------------
+  // merge_group
+  //
+  // replace the k particles starting at `prts` by two
+
+  void merge_group(Mparticles& mprts, const Particle* prts, int k,
+                   std::vector<Particle>& merged)
+  {
+    // the weights are all of the same sign, as it's one kind
+    double W = 0., G = 0.;
+    Vec3<double> U = {}, X = {};
+    for (int i = 0; i < k; i++) {
+      double w = prts[i].qni_wni;
+      W += w;
+      G += w * gamma(prts[i].u);
+      for (int d = 0; d < 3; d++) {
+        U[d] += w * prts[i].u[d];
+        X[d] += w * prts[i].x[d];
+      }
+    }
+    G /= W;
+    U *= 1. / W;
+    X *= 1. / W;
+
+    // |u_new|^2 = G^2 - 1 >= |U|^2, since gamma(u) is convex
+    double U2 = sqr(U[0]) + sqr(U[1]) + sqr(U[2]);
+    double delta = std::sqrt(std::max(0., sqr(G) - 1. - U2));
+
+    // direction perpendicular to U, taken from the particle that deviates
+    // most from it
+    Vec3<double> e = {};
+    double e2 = 0.;
+    for (int i = 0; i < k; i++) {
+      Vec3<double> d;
+      for (int m = 0; m < 3; m++) {
+        d[m] = prts[i].u[m] - U[m];
+      }
+      if (U2 > 0.) {
+        double proj = (d[0] * U[0] + d[1] * U[1] + d[2] * U[2]) / U2;
+        d -= proj * U;
+      }
+      double d2 = sqr(d[0]) + sqr(d[1]) + sqr(d[2]);
+      if (d2 > e2) {
+        e = d;
+        e2 = d2;
+      }
+    }
+    // a spread at round-off level is noise, which may well point along U
+    if (e2 > 1e-20 * (sqr(G) - 1.)) {
+      e *= 1. / std::sqrt(e2);
+    } else {
+      // all momenta are parallel to U, any perpendicular direction will do:
+      // take the axis U is least aligned with, minus its projection on U
+      e = {};
+      int d = 0;
+      for (int m = 1; m < 3; m++) {
+        if (std::abs(U[m]) < std::abs(U[d])) {
+          d = m;
+        }
+      }
+      e[d] = 1.;
+      if (U2 > 0.) {
+        e -= (U[d] / U2) * U;
+      }
+      e *= 1. / std::sqrt(sqr(e[0]) + sqr(e[1]) + sqr(e[2]));
+    }
+
+    Real3 x = {real_t(X[0]), real_t(X[1]), real_t(X[2])};
+    for (int s = -1; s <= 1; s += 2) {
+      Real3 u;
+      for (int m = 0; m < 3; m++) {
+        u[m] = U[m] + s * delta * e[m];
+      }
+      merged.push_back(Particle{x, u, real_t(.5 * W), prts[0].kind,
+                                mprts.uid_gen(), prts[0].tag()});
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // split
+  //
+  // increase the number of particles in `cell` (all of the same kind, in
+  // cell `c` of patch `p`) to at least n_min
+
+  void split(Mparticles& mprts, int p, int c, std::vector<Particle>& cell)
+  {
+    const auto& grid = mprts.grid();
+    Int3 ldims = grid.ldims;
+    Int3 idx = {c % ldims[0], (c / ldims[0]) % ldims[1],
+                c / (ldims[0] * ldims[1])};
+    const auto& off = grid.patches[p].off;
+    const auto& gdims = grid.domain.gdims;
+    uint64_t c_global =
+      (uint64_t(idx[2] + off[2]) * gdims[1] + (idx[1] + off[1])) * gdims[0] +
+      (idx[0] + off[0]);
+    RngPhilox<real_t> rng{c_global, RNG_STREAM_REWEIGHT,
+                          uint32_t(grid.timestep())};
+
+    while (int(cell.size()) < prm_.n_min) {
+      int n_split = std::min<int>(prm_.n_min - cell.size(), cell.size());
+      std::nth_element(cell.begin(), cell.begin() + n_split, cell.end(),
+                       [](const Particle& a, const Particle& b) {
+                         return std::abs(a.qni_wni) > std::abs(b.qni_wni);
+                       });
+      for (int i = 0; i < n_split; i++) {
+        Particle& prt = cell[i];
+        prt.qni_wni *= real_t(.5);
+        Particle prt2{prt.x, prt.u, prt.qni_wni, prt.kind, mprts.uid_gen(),
+                      prt.tag()};
+        for (int d = 0; d < 3; d++) {
+          if (grid.isInvar(d)) {
+            continue;
+          }
+          // stay clear of the cell boundaries
+          real_t dx = grid.domain.dx[d];
+          real_t lo = prt.x[d] - idx[d] * dx;
+          real_t hi = (idx[d] + 1) * dx - prt.x[d];
+          real_t offset =
+            real_t(.5) * std::min(lo, hi) * (2 * rng.uniform() - 1);
+          prt.x[d] += offset;
+          prt2.x[d] -= offset;
+        }
+        cell.push_back(prt2);
+      }
+    }
+  }
+
+  ReweightParams prm_;
+  std::vector<Particle> cell_;
+  std::vector<std::vector<Particle>> out_;
+};
@@ -6,7 +6,10 @@
 #include <psc_particles.h>
 
 #include <mrc_profile.h>
+#include <scratch_arena.hxx>
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 // ======================================================================
 // SortCountsort
@@ -19,12 +22,17 @@ struct SortCountsort
 
   void operator()(Mparticles& mprts)
   {
+    // sorted by cell only, so no longer by kind
+    mprts.invalidate_kind_offsets();
+    auto& arena = psc::ScratchArena::get();
     for (int p = 0; p < mprts.n_patches(); p++) {
+      PatchTimer timer(p);
+      psc::ScratchArena::Scope scope(arena);
       auto& prts = mprts[p];
       unsigned int n_prts = prts.size();
 
       unsigned int n_cells = prts.pi_.n_cells_;
-      unsigned int* cnts = new unsigned int[n_cells]{};
+      unsigned int* cnts = arena.calloc<unsigned int>(n_cells);
 
       // count
       for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter) {
@@ -42,7 +50,7 @@ struct SortCountsort
       assert(cur == n_prts);
 
       // move into new position
-      auto particles2 = new Particle[n_prts];
+      auto particles2 = arena.alloc<Particle>(n_prts);
       for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter) {
         unsigned int cni = prts.validCellIndex(*prt_iter);
         particles2[cnts[cni]] = *prt_iter;
@@ -51,9 +59,6 @@ struct SortCountsort
 
       // back to in-place
       memcpy(&*prts.begin(), particles2, n_prts * sizeof(*particles2));
-
-      delete[] particles2;
-      delete[] cnts;
     }
   }
 };
@@ -70,12 +75,17 @@ struct SortCountsort2
 
   void operator()(Mparticles& mprts)
   {
+    // sorted by cell only, so no longer by kind
+    mprts.invalidate_kind_offsets();
+    auto& arena = psc::ScratchArena::get();
     for (int p = 0; p < mprts.n_patches(); p++) {
+      PatchTimer timer(p);
+      psc::ScratchArena::Scope scope(arena);
       auto&& prts = mprts[p];
       unsigned int n_prts = prts.size();
 
       unsigned int n_cells = mprts.pi_.n_cells_;
-      unsigned int* cnis = new unsigned int[n_prts];
+      unsigned int* cnis = arena.alloc<unsigned int>(n_prts);
       // FIXME, might as well merge counting here, too
       int i = 0;
       for (auto prt_iter = prts.begin(); prt_iter != prts.end();
@@ -83,7 +93,7 @@ struct SortCountsort2
         cnis[i] = prts.validCellIndex(*prt_iter);
       }
 
-      unsigned int* cnts = new unsigned int[n_cells]{};
+      unsigned int* cnts = arena.calloc<unsigned int>(n_cells);
 
       // count
       for (int i = 0; i < n_prts; i++) {
@@ -101,7 +111,7 @@ struct SortCountsort2
       assert(cur == n_prts);
 
       // move into new position
-      auto particles2 = new Particle[n_prts];
+      auto particles2 = arena.alloc<Particle>(n_prts);
       for (int i = 0; i < n_prts; i++) {
         unsigned int cni = cnis[i];
         int n = 1;
@@ -115,12 +125,169 @@ struct SortCountsort2
 
       // back to in-place
       memcpy(&*prts.begin(), particles2, n_prts * sizeof(*particles2));
+    }
+  }
+};
+
+// ======================================================================
+// SortIncremental
+//
+// Particles move at most one cell per step, so if they were sorted by cell
+// after the last step, most of them still are. Rather than a full counting
+// sort, split each patch into the particles that are still in order
+// (which are compacted in place) and the few "movers" that aren't (those
+// that changed cells, and those newly received from other patches). The
+// movers get sorted by themselves and merged back in from the end.
+//
+// All scratch space is kept around between calls, so after the first few
+// steps no allocations happen. If too many particles are out of order
+// (e.g., the first time around), fall back to a counting sort.
+//
+// With BY_KIND, the particles are grouped by kind first, then sorted by
+// cell within each kind, and the kind ranges are recorded in the
+// Mparticles (see MparticlesSimple::kind_offsets()). Since particles never
+// change kind, that's no more work once the layout is established.
+
+template <typename MP, bool BY_KIND = false>
+struct SortIncremental
+{
+  using Mparticles = MP;
+  using Particle = typename Mparticles::Particle;
+
+  void operator()(Mparticles& mprts)
+  {
+    unsigned int n_cells = mprts.pi_.n_cells_;
+    unsigned int n_kinds = mprts.grid().kinds.size();
+    unsigned int n_keys = BY_KIND ? n_kinds * n_cells : n_cells;
+
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      PatchTimer timer(p);
+      auto&& prts = mprts[p];
+      unsigned int n_prts = prts.size();
+
+      // the sort key is the cell index, preceded by the kind if BY_KIND
+      cnis_.resize(n_prts);
+      for (unsigned int n = 0; n < n_prts; n++) {
+        cnis_[n] = prts.validCellIndex(prts[n]);
+      }
+      if (BY_KIND) {
+        offsets_.assign(n_kinds + 1, 0);
+        for (unsigned int n = 0; n < n_prts; n++) {
+          unsigned int kind = prts[n].kind;
+          cnis_[n] += kind * n_cells;
+          offsets_[kind + 1]++;
+        }
+        for (unsigned int k = 0; k < n_kinds; k++) {
+          offsets_[k + 1] += offsets_[k];
+        }
+        mprts.set_kind_offsets(p, offsets_);
+      } else {
+        mprts.set_kind_offsets(p, {});
+      }
 
-      delete[] particles2;
-      delete[] cnis;
-      delete[] cnts;
+      // a particle stays put if it's in order wrt. both the last particle
+      // that stayed and its successor; that way, a single particle jumping
+      // ahead doesn't turn all of the following ones into movers
+      movers_.clear();
+      mover_cnis_.clear();
+      unsigned int head = 0;
+      unsigned int last_cni = 0;
+      for (unsigned int n = 0; n < n_prts; n++) {
+        unsigned int cni = cnis_[n];
+        if (cni >= last_cni && (n + 1 == n_prts || cni <= cnis_[n + 1])) {
+          if (head != n) {
+            prts[head] = Particle(prts[n]);
+            cnis_[head] = cni;
+          }
+          head++;
+          last_cni = cni;
+        } else {
+          movers_.push_back(prts[n]);
+          mover_cnis_.push_back(cni);
+        }
+      }
+
+      unsigned int n_movers = movers_.size();
+      if (n_movers == 0) {
+        continue;
+      }
+      if (n_movers > n_prts / 4) {
+        restore(prts, head);
+        counting_sort(prts, n_keys);
+        continue;
+      }
+
+      // sort movers by cell
+      perm_.resize(n_movers);
+      for (unsigned int n = 0; n < n_movers; n++) {
+        perm_[n] = n;
+      }
+      std::stable_sort(perm_.begin(), perm_.end(),
+                       [&](unsigned int a, unsigned int b) {
+                         return mover_cnis_[a] < mover_cnis_[b];
+                       });
+
+      // merge backwards, so that stayers are only ever moved to
+      // positions they don't need anymore
+      int i = int(head) - 1;
+      int j = int(n_movers) - 1;
+      for (int n = int(n_prts) - 1; j >= 0; n--) {
+        if (i >= 0 && cnis_[i] > mover_cnis_[perm_[j]]) {
+          prts[n] = Particle(prts[i]);
+          i--;
+        } else {
+          prts[n] = movers_[perm_[j]];
+          j--;
+        }
+      }
+    }
+  }
+
+private:
+  // put the movers back after the compacted stayers, keeping cnis_ in sync
+  template <typename Patch>
+  void restore(Patch& prts, unsigned int head)
+  {
+    for (unsigned int n = 0; n < movers_.size(); n++) {
+      prts[head + n] = movers_[n];
+      cnis_[head + n] = mover_cnis_[n];
     }
   }
+
+  template <typename Patch>
+  void counting_sort(Patch& prts, unsigned int n_keys)
+  {
+    unsigned int n_prts = prts.size();
+
+    cnts_.assign(n_keys, 0);
+    for (unsigned int n = 0; n < n_prts; n++) {
+      cnts_[cnis_[n]]++;
+    }
+
+    unsigned int cur = 0;
+    for (unsigned int c = 0; c < n_keys; c++) {
+      unsigned int cnt = cnts_[c];
+      cnts_[c] = cur;
+      cur += cnt;
+    }
+    assert(cur == n_prts);
+
+    sorted_.resize(n_prts);
+    for (unsigned int n = 0; n < n_prts; n++) {
+      sorted_[cnts_[cnis_[n]]++] = prts[n];
+    }
+    for (unsigned int n = 0; n < n_prts; n++) {
+      prts[n] = sorted_[n];
+    }
+  }
+
+  std::vector<unsigned int> cnis_;
+  std::vector<unsigned int> cnts_;
+  std::vector<unsigned int> mover_cnis_;
+  std::vector<unsigned int> perm_;
+  std::vector<unsigned int> offsets_;
+  std::vector<Particle> movers_;
+  std::vector<Particle> sorted_;
 };
 
 // ======================================================================
@@ -8,6 +8,7 @@
 #include "psc_particles_double.h"
 #include "psc_fields_c.h"
 #include "../libpsc/psc_balance/psc_balance_impl.hxx"
+#include "setup_particles.hxx"
 
 #ifdef USE_CUDA
 #include "../libpsc/cuda/mparticles_cuda.hxx"
@@ -104,6 +105,70 @@ TYPED_TEST(BalanceTest, Constructor)
   auto balance = Balance{1., true};
 }
 
+// -----------------------------------------------------------------------
+// UpdateCost
+//
+// measured cost: the first step only starts the timers, then the per-patch
+// compute times are averaged over steps
+
+TYPED_TEST(BalanceTest, UpdateCost)
+{
+  using Balance = typename TypeParam::Balance;
+  auto& grid = *this->grid_;
+  auto balance = Balance{-1., false, false, .5};
+  int n_patches = grid.n_patches();
+
+  balance.update_cost(grid);
+  ASSERT_TRUE(psc_balance_comp_time_by_patch);
+  EXPECT_FALSE(psc_balance_cost_by_patch);
+
+  for (int p = 0; p < n_patches; p++) {
+    psc_balance_comp_time_by_patch[p] = 4.;
+  }
+  balance.update_cost(grid);
+  ASSERT_TRUE(psc_balance_cost_by_patch);
+  for (int p = 0; p < n_patches; p++) {
+    EXPECT_EQ(psc_balance_cost_by_patch[p], 4.);
+    EXPECT_EQ(psc_balance_comp_time_by_patch[p], 0.);
+  }
+
+  for (int p = 0; p < n_patches; p++) {
+    psc_balance_comp_time_by_patch[p] = 2.;
+  }
+  balance.update_cost(grid);
+  for (int p = 0; p < n_patches; p++) {
+    EXPECT_EQ(psc_balance_cost_by_patch[p], 3.);
+  }
+}
+
+// -----------------------------------------------------------------------
+// InjectCost
+//
+// particle injection counts towards the measured cost of each patch
+
+TEST(BalanceCost, InjectCost)
+{
+  auto domain =
+    Grid_t::Domain{{1, 8, 16}, {10., 80., 160.}, {0., -40., -80.}, {1, 2, 2}};
+  auto kinds = Grid_t::Kinds{{1., 100., "i"}};
+  auto prm = Grid_t::NormalizationParams::dimensionless();
+  prm.nicell = 10;
+  Grid_t grid{domain, {}, kinds, {prm}, .1};
+  MparticlesSingle mprts{grid};
+
+  auto balance =
+    Balance_<MparticlesSingle, MfieldsStateSingle, MfieldsSingle>{-1.};
+  balance.update_cost(grid);
+  ASSERT_TRUE(psc_balance_comp_time_by_patch);
+
+  SetupParticles<MparticlesSingle> setup_particles(grid);
+  setup_particles(
+    mprts, [&](int kind, Double3 crd, psc_particle_npt& npt) { npt.n = 1; });
+  for (int p = 0; p < grid.n_patches(); p++) {
+    EXPECT_GT(psc_balance_comp_time_by_patch[p], 0.);
+  }
+}
+
 #if 0
 // ----------------------------------------------------------------------
 // Initial1
@@ -253,6 +318,120 @@ TEST(Balance, best_mapping)
   psc::balance::print_stats({capability, loads}, n_patches_all, true);
 }
 
+// ----------------------------------------------------------------------
+// best_mapping_distributed
+//
+// each rank stands in for n_local procs, so these get tested for more than
+// one proc even when run on a single rank
+
+TEST(Balance, best_mapping_distributed)
+{
+  int rank, n_ranks;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+
+  for (int n_local = 1; n_local <= 5; n_local++) {
+    int size = n_ranks * n_local;
+
+    // 2 to 4 patches per proc, and the loads vary
+    std::vector<int> n_patches_by_proc(size);
+    for (int p = 0; p < size; p++) {
+      n_patches_by_proc[p] = 2 + p % 3;
+    }
+    int n_patches = std::accumulate(n_patches_by_proc.begin(),
+                                    n_patches_by_proc.end(), 0);
+    std::vector<double> capability(size, 1.);
+    std::vector<double> loads_all(n_patches);
+    for (int i = 0; i < n_patches; i++) {
+      loads_all[i] = 1 + (i * 7) % 5;
+    }
+    std::vector<std::vector<double>> loads(n_local);
+    int off = std::accumulate(n_patches_by_proc.begin(),
+                              n_patches_by_proc.begin() + rank * n_local, 0);
+    for (int l = 0; l < n_local; l++) {
+      int n = n_patches_by_proc[rank * n_local + l];
+      loads[l].assign(&loads_all[off], &loads_all[off + n]);
+      off += n;
+    }
+
+    std::vector<double> load_by_proc;
+    auto n_patches_all =
+      psc::balance::best_mapping(MPI_COMM_WORLD, loads, &load_by_proc);
+    EXPECT_EQ(n_patches_all,
+              psc::balance::best_mapping({capability, loads_all}))
+      << "n_local " << n_local;
+
+    int pp = 0;
+    for (int p = 0; p < size; p++) {
+      double load = 0.;
+      for (int n = 0; n < n_patches_all[p]; n++) {
+        load += loads_all[pp++];
+      }
+      EXPECT_EQ(load_by_proc[p], load);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// incremental_mapping
+
+TEST(Balance, incremental_mapping)
+{
+  int rank, n_ranks;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+
+  for (int n_local = 1; n_local <= 5; n_local++) {
+    int size = n_ranks * n_local;
+    if (size < 2) {
+      continue;
+    }
+
+    // 4 patches per proc, the first proc's are much more expensive
+    std::vector<int> n_patches_old(size, 4);
+    std::vector<std::vector<double>> loads(n_local), bytes(n_local);
+    for (int l = 0; l < n_local; l++) {
+      loads[l].assign(4, rank * n_local + l == 0 ? 10. : 1.);
+      bytes[l].assign(4, 1.);
+    }
+    auto n_patches_target = psc::balance::best_mapping(MPI_COMM_WORLD, loads);
+    EXPECT_NE(n_patches_target, n_patches_old);
+
+    // moving at most 1 patch across each boundary
+    psc::balance::incremental prm;
+    prm.max_bytes = 1.;
+    std::vector<double> load_by_proc;
+    auto n_patches_new = psc::balance::incremental_mapping(
+      MPI_COMM_WORLD, loads, bytes, n_patches_old, n_patches_target, prm,
+      &load_by_proc);
+    EXPECT_NE(n_patches_new, n_patches_old) << "n_local " << n_local;
+    int cut_old = 0, cut_target = 0, cut_new = 0;
+    for (int p = 0; p < size; p++) {
+      EXPECT_GE(n_patches_new[p], 1);
+      EXPECT_LE(std::abs(cut_new - cut_old), 1);
+      if (cut_target == cut_old) {
+        EXPECT_EQ(cut_new, cut_old);
+      }
+      // patch i costs 10 if it's one of proc 0's, 1 otherwise
+      double load = 0.;
+      for (int i = cut_new; i < cut_new + n_patches_new[p]; i++) {
+        load += i < 4 ? 10. : 1.;
+      }
+      EXPECT_EQ(load_by_proc[p], load);
+      cut_old += n_patches_old[p];
+      cut_target += n_patches_target[p];
+      cut_new += n_patches_new[p];
+    }
+    EXPECT_EQ(cut_new, cut_old);
+
+    // unless it's not worth it
+    prm.cost_per_byte = 100.;
+    n_patches_new = psc::balance::incremental_mapping(
+      MPI_COMM_WORLD, loads, bytes, n_patches_old, n_patches_target, prm);
+    EXPECT_EQ(n_patches_new, n_patches_old);
+  }
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
@@ -230,6 +230,194 @@ TYPED_TEST(BndTest, FillGhostsGt)
   }
 }
 
+// same as "FillGhosts", but split into begin / end
+TEST(Bnd_, FillGhostsBeginEnd)
+{
+  using dim = dim_yz;
+
+  auto grid = make_grid<dim>();
+  auto mflds = MfieldsSingle{grid, 1, grid.ibn};
+
+  {
+    auto&& h_mflds = gt::host_mirror(mflds.storage());
+    h_mflds.view() = 0.;
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      int i0 = grid.patches[p].off[0];
+      int j0 = grid.patches[p].off[1];
+      int k0 = grid.patches[p].off[2];
+      auto flds = make_Fields3d<dim_xyz>(
+        h_mflds.view(_all, _all, _all, _all, p), -grid.ibn);
+      grid.Foreach_3d(0, 0, [&](int i, int j, int k) {
+        int ii = i + i0, jj = j + j0, kk = k + k0;
+        flds(0, i, j, k) = 100 * ii + 10 * jj + kk;
+      });
+    }
+    gt::copy(h_mflds, mflds.storage());
+  }
+
+  Bnd_ bnd;
+  bnd.fill_ghosts_begin(mflds, 0, 1);
+  bnd.fill_ghosts_end(mflds, 0, 1);
+
+  {
+    auto&& h_mflds = gt::host_mirror(mflds.storage());
+    gt::copy(mflds.storage(), h_mflds);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      auto flds = make_Fields3d<dim_xyz>(
+        h_mflds.view(_all, _all, _all, _all, p), -grid.ibn);
+      int i0 = grid.patches[p].off[0];
+      int j0 = grid.patches[p].off[1];
+      int k0 = grid.patches[p].off[2];
+      grid.Foreach_3d(B, B, [&](int i, int j, int k) {
+        int ii = i + i0, jj = j + j0, kk = k + k0;
+        ii = (ii + grid.domain.gdims[0]) % grid.domain.gdims[0];
+        jj = (jj + grid.domain.gdims[1]) % grid.domain.gdims[1];
+        kk = (kk + grid.domain.gdims[2]) % grid.domain.gdims[2];
+        EXPECT_EQ(flds(0, i, j, k), 100 * ii + 10 * jj + kk);
+      });
+    }
+  }
+}
+
+// fill_ghosts_end() must only write the ghost points, so that interior
+// values updated in between (like by the overlapped E push) survive
+
+template <typename T>
+struct BndSplitTest : public ::testing::Test
+{};
+
+using BndSplitTestTypes =
+  ::testing::Types<TestConfigBnd<MfieldsSingle, Bnd_, dim_yz>,
+#ifdef USE_CUDA
+                   TestConfigBnd<MfieldsCuda, Bnd_, dim_xyz>,
+#endif
+                   TestConfigBnd<MfieldsSingle, Bnd_, dim_xyz>>;
+
+TYPED_TEST_SUITE(BndSplitTest, BndSplitTestTypes);
+
+TYPED_TEST(BndSplitTest, FillGhostsBeginEndInterior)
+{
+  using Mfields = typename TypeParam::Mfields;
+  using Bnd = typename TypeParam::Bnd;
+  using dim = typename TypeParam::dim;
+
+  auto grid = make_grid<dim>();
+  auto mflds = Mfields{grid, 1, grid.ibn};
+
+  auto set_interior = [&](int offset) {
+    auto&& h_mflds = gt::host_mirror(mflds.storage());
+    gt::copy(mflds.storage(), h_mflds);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      int i0 = grid.patches[p].off[0];
+      int j0 = grid.patches[p].off[1];
+      int k0 = grid.patches[p].off[2];
+      auto flds = make_Fields3d<dim_xyz>(
+        h_mflds.view(_all, _all, _all, _all, p), -grid.ibn);
+      grid.Foreach_3d(0, 0, [&](int i, int j, int k) {
+        int ii = i + i0, jj = j + j0, kk = k + k0;
+        flds(0, i, j, k) = offset + 100 * ii + 10 * jj + kk;
+      });
+    }
+    gt::copy(h_mflds, mflds.storage());
+  };
+
+  mflds.storage().view() = 0.;
+  set_interior(0);
+
+  Bnd bnd;
+  bnd.fill_ghosts_begin(mflds, 0, 1);
+  set_interior(1000);
+  bnd.fill_ghosts_end(mflds, 0, 1);
+
+  {
+    auto&& h_mflds = gt::host_mirror(mflds.storage());
+    gt::copy(mflds.storage(), h_mflds);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      auto flds = make_Fields3d<dim_xyz>(
+        h_mflds.view(_all, _all, _all, _all, p), -grid.ibn);
+      int i0 = grid.patches[p].off[0];
+      int j0 = grid.patches[p].off[1];
+      int k0 = grid.patches[p].off[2];
+      grid.Foreach_3d(B, B, [&](int i, int j, int k) {
+        bool interior = i >= 0 && i < grid.ldims[0] && j >= 0 &&
+                        j < grid.ldims[1] && k >= 0 && k < grid.ldims[2];
+        int ii = i + i0, jj = j + j0, kk = k + k0;
+        ii = (ii + grid.domain.gdims[0]) % grid.domain.gdims[0];
+        jj = (jj + grid.domain.gdims[1]) % grid.domain.gdims[1];
+        kk = (kk + grid.domain.gdims[2]) % grid.domain.gdims[2];
+        EXPECT_EQ(flds(0, i, j, k), (interior ? 1000 : 0) + 100 * ii +
+                                      10 * jj + kk)
+          << "ijk " << i << " " << j << " " << k;
+      });
+    }
+  }
+}
+
+// fill_ghosts() with n_ghosts = 1 needs to give the same first layer of
+// ghost points as the full fill, for the same Bnd_ configurations
+
+template <typename T>
+struct BndNarrowTest : public ::testing::Test
+{};
+
+TYPED_TEST_SUITE(BndNarrowTest, BndSplitTestTypes);
+
+TYPED_TEST(BndNarrowTest, FillGhostsNarrow)
+{
+  using Mfields = typename TypeParam::Mfields;
+  using Bnd = typename TypeParam::Bnd;
+  using dim = typename TypeParam::dim;
+
+  auto grid = make_grid<dim>();
+  auto mflds = Mfields{grid, 2, grid.ibn};
+  auto mflds_ref = Mfields{grid, 2, grid.ibn};
+
+  {
+    auto&& h_mflds = gt::host_mirror(mflds.storage());
+    h_mflds.view() = 0.;
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      int i0 = grid.patches[p].off[0];
+      int j0 = grid.patches[p].off[1];
+      int k0 = grid.patches[p].off[2];
+      auto flds = make_Fields3d<dim_xyz>(
+        h_mflds.view(_all, _all, _all, _all, p), -grid.ibn);
+      grid.Foreach_3d(0, 0, [&](int i, int j, int k) {
+        int ii = i + i0, jj = j + j0, kk = k + k0;
+        flds(0, i, j, k) = 100 * ii + 10 * jj + kk;
+        flds(1, i, j, k) = -(100 * ii + 10 * jj + kk);
+      });
+    }
+    gt::copy(h_mflds, mflds.storage());
+    gt::copy(h_mflds, mflds_ref.storage());
+  }
+
+  Bnd bnd;
+  bnd.fill_ghosts(mflds_ref, 0, 2);
+  // twice, to also use the cached narrow ddc
+  for (int n = 0; n < 2; n++) {
+    bnd.fill_ghosts(mflds.grid(), mflds.storage(), mflds.ib(), 0, 2, 1);
+  }
+
+  {
+    auto&& h_mflds = gt::host_mirror(mflds.storage());
+    auto&& h_mflds_ref = gt::host_mirror(mflds_ref.storage());
+    gt::copy(mflds.storage(), h_mflds);
+    gt::copy(mflds_ref.storage(), h_mflds_ref);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      auto flds = make_Fields3d<dim_xyz>(
+        h_mflds.view(_all, _all, _all, _all, p), -grid.ibn);
+      auto flds_ref = make_Fields3d<dim_xyz>(
+        h_mflds_ref.view(_all, _all, _all, _all, p), -grid.ibn);
+      grid.Foreach_3d(1, 1, [&](int i, int j, int k) {
+        for (int m = 0; m < 2; m++) {
+          EXPECT_EQ(flds(m, i, j, k), flds_ref(m, i, j, k))
+            << "m " << m << " ijk " << i << " " << j << " " << k;
+        }
+      });
+    }
+  }
+}
+
 TYPED_TEST(BndTest, AddGhosts)
 {
   using Mfields = typename TypeParam::Mfields;
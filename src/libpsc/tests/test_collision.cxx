@@ -10,6 +10,10 @@
 #include "../libpsc/cuda/collision_cuda_impl.hxx"
 #endif
 
+#ifdef PSC_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 struct ParticleTest
 {
   using real_t = double;
@@ -170,6 +174,116 @@ TYPED_TEST(CollisionTest, Test1)
   EXPECT_NEAR(std::abs(prtf1.u()[2]), 0.17342988, eps);
 }
 
+// ======================================================================
+// CollisionHostTest
+//
+// CollisionHost with the actual (Philox) random numbers and n_per_cell
+// particles in each cell
+
+struct CollisionHostTest : ::testing::Test
+{
+  using Mparticles = MparticlesDouble;
+  using Collision = Collision_<MparticlesDouble, MfieldsStateDouble, MfieldsC>;
+
+  const int n_per_cell = 10;
+
+  CollisionHostTest()
+    : grid_{make_psc<dim_yz>({Grid_t::Kind(1., 1., "test_species")})}
+  {}
+
+  void inject(Mparticles& mprts)
+  {
+    const auto& ldims = grid_.ldims;
+    const auto& dx = grid_.domain.dx;
+    auto inj = mprts.injector();
+    auto injector = inj[0];
+    int n = 0;
+    for (int k = 0; k < ldims[2]; k++) {
+      for (int j = 0; j < ldims[1]; j++) {
+        for (int c = 0; c < n_per_cell; c++, n++) {
+          Double3 x = {.5 * dx[0], (j + .5) * dx[1], (k + .5) * dx[2]};
+          Double3 u = {.1 * std::sin(n), .1 * std::cos(2 * n),
+                       .05 * std::sin(3 * n)};
+          injector({x, u, 1., 0});
+        }
+      }
+    }
+  }
+
+  Grid_t& grid_;
+};
+
+// the cells are collided in parallel, but each cell has its own random
+// numbers, so the number of threads must not matter
+
+TEST_F(CollisionHostTest, ThreadCountIndependent)
+{
+  auto collide = [&](int n_threads) {
+#ifdef PSC_HAVE_OPENMP
+    omp_set_num_threads(n_threads);
+#endif
+    Mparticles mprts{grid_};
+    inject(mprts);
+    Collision collision{grid_, 1, 1.};
+    collision(mprts);
+
+    std::vector<Double3> u;
+    auto accessor = mprts.accessor();
+    for (auto prt : accessor[0]) {
+      u.emplace_back(prt.u());
+    }
+    return u;
+  };
+
+#ifdef PSC_HAVE_OPENMP
+  int max_threads = omp_get_max_threads();
+#endif
+  auto u_ref = collide(1);
+  auto u = collide(4);
+#ifdef PSC_HAVE_OPENMP
+  omp_set_num_threads(max_threads);
+#endif
+
+  ASSERT_EQ(u.size(), u_ref.size());
+  for (std::size_t n = 0; n < u.size(); n++) {
+    for (int d = 0; d < 3; d++) {
+      EXPECT_EQ(u[n][d], u_ref[n][d]) << "n " << n << " d " << d;
+    }
+  }
+}
+
+// with stats_interval 2, the stats are gathered on even steps only, and
+// zeroed on the odd ones
+
+TEST_F(CollisionHostTest, StatsInterval)
+{
+  Mparticles mprts{grid_};
+  inject(mprts);
+  Collision collision{grid_, 1, 1., 2};
+
+  auto n_coll = [&]() {
+    double sum = 0.;
+    auto F = make_Fields3d<dim_xyz>(collision.mflds_stats_[0]);
+    grid_.Foreach_3d(0, 0, [&](int i, int j, int k) {
+      sum += F(Collision::STATS_NCOLL, i, j, k);
+    });
+    return sum;
+  };
+  double n_coll_ref = grid_.ldims[1] * grid_.ldims[2] * (n_per_cell / 2);
+
+  grid_.timestep_ = 0;
+  collision(mprts);
+  EXPECT_EQ(n_coll(), n_coll_ref);
+
+  grid_.timestep_ = 1;
+  collision(mprts);
+  EXPECT_EQ(n_coll(), 0.);
+
+  grid_.timestep_ = 2;
+  collision(mprts);
+  EXPECT_EQ(n_coll(), n_coll_ref);
+}
+
 // ======================================================================
 // main
 
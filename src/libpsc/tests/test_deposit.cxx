@@ -135,6 +135,33 @@ TYPED_TEST(DepositTest, ChargeCenterWithBndCc)
                                                       << rho_ref;
 }
 
+TYPED_TEST(DepositTest, MultipleCc)
+{
+  using self_type = DepositTest<TypeParam>;
+  using real_t = typename self_type::real_t;
+  using real3_t = typename self_type::real3_t;
+  using dim_t = typename self_type::dim_t;
+
+  real3_t x = {1.3, 2.6, 1.8};
+  if (std::is_same<dim_t, dim_yz>::value) {
+    x[0] = 0.;
+  }
+  std::array<real_t, 2> vals = {.1, -.3};
+  auto ibn = gt::shape(1, 1, 1);
+  auto shape = this->ldims_ + 2 * ibn;
+
+  auto flds = gt::zeros<real_t>(gt::shape(shape[0], shape[1], shape[2], 2));
+  psc::deposit::norm::Deposit1stCc<real_t, dim_t> deposit;
+  deposit(flds, -ibn, x, vals);
+
+  for (int m = 0; m < 2; m++) {
+    auto rho_ref = gt::zeros<real_t>(shape);
+    psc::deposit::norm::cc<dim_t>(rho_ref, -ibn, x, vals[m]);
+    EXPECT_LT(gt::norm_linf(flds.view(_all, _all, _all, m) - rho_ref),
+              this->eps);
+  }
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
@@ -33,6 +33,26 @@ TEST(Grid, CtorComplete)
   EXPECT_EQ(grid.patches[3].xe, Grid_t::Real3({40., 20., 20.}));
 }
 
+TEST(Grid, CtorHilbert)
+{
+  auto domain =
+    Grid_t::Domain{{16, 16, 1}, {160., 160., 10.}, {0., 0., 0.}, {4, 4, 1}};
+  domain.curve = psc::grid::Curve::HILBERT;
+  auto bc = psc::grid::BC{};
+  auto kinds = Grid_t::Kinds{};
+  auto norm = Grid_t::Normalization{};
+  double dt = .1;
+  auto grid = Grid_t{domain, bc, kinds, norm, dt};
+
+  // consecutive patches along a Hilbert curve always share a face
+  EXPECT_EQ(grid.n_patches(), 16);
+  EXPECT_EQ(grid.patches[0].off, Int3({0, 0, 0}));
+  for (int p = 1; p < grid.n_patches(); p++) {
+    Int3 diff = grid.patches[p].off - grid.patches[p - 1].off;
+    EXPECT_EQ(std::abs(diff[0]) + std::abs(diff[1]) + std::abs(diff[2]), 4);
+  }
+}
+
 TEST(Grid, MoveCtor)
 {
   auto domain =
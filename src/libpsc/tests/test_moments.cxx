@@ -64,6 +64,7 @@ struct MomentTest : ::testing::Test
   const real_t w = .4; // test particle weight
 
   Int3 ibn = {2, 2, 2};
+  Grid_t::Kinds kinds = {Grid_t::Kind(1., 1., "test_species")};
 
   const Grid_t& make_grid()
   {
@@ -97,8 +98,6 @@ struct MomentTest : ::testing::Test
     norm_params.nicell = nicell;
     auto coeff = Grid_t::Normalization{norm_params};
 
-    auto kinds = Grid_t::Kinds{Grid_t::Kind(1., 1., "test_species")};
-
     grid_.reset(new Grid_t{grid_domain, grid_bc, kinds, coeff, 1., -1, ibn});
 
     return *grid_;
@@ -440,6 +439,146 @@ TYPED_TEST(MomentTest, Moment_rho_2nd_nc)
   }
 }
 
+// ======================================================================
+// MomentFusedTest
+//
+// The n, v, p, T and all moments deposit all of their components at once
+// through a DepositTile, which gets flushed whenever the particle's cell
+// changes. Compare against depositing one component at a time, with the
+// particles in unsorted order and of more than one kind.
+
+template <typename T>
+struct MomentFusedTest : MomentTest<T>
+{
+  using base_type = MomentTest<T>;
+  using Mfields = typename base_type::Mfields;
+  using Mparticles = typename base_type::Mparticles;
+  using dim_t = typename base_type::dim_t;
+  using real_t = typename Mfields::real_t;
+  using storage_type = typename Mfields::Storage;
+  using space_type = typename storage_type::space_type;
+
+  template <template <template <typename, typename> class, typename>
+            class Moment,
+            std::size_t N, typename F>
+  void check(F&& vals)
+  {
+    this->kinds = {Grid_t::Kind(-1., 1., "e"), Grid_t::Kind(1., 4., "i")};
+    const auto& grid = this->make_grid();
+
+    Mparticles mprts{grid};
+    {
+      auto injector = mprts.injector();
+      // pairs of particles in the same cell, but the pairs jump around
+      for (int n = 0; n < 200; n++) {
+        int i = n / 2;
+        Double3 x = {std::fmod(i * 37.3, this->L), std::fmod(i * 53.9, this->L),
+                     std::fmod(i * 71.7, this->L)};
+        Double3 u = {.01 * (n % 5), -.02 * (n % 3), .03 * (n % 7)};
+        injector[0]({x, u, this->w * (1 + n % 4), n % 2});
+      }
+    }
+
+    Int3 ib = -grid.ibn;
+    int n_comps = N * grid.kinds.size();
+    auto mres = psc::mflds::zeros<real_t, space_type>(grid, n_comps, ib);
+    Moment<psc::deposit::code::Deposit1stCc, dim_t>{}(mres, ib, mprts);
+
+    auto mres_ref = psc::mflds::zeros<real_t, space_type>(grid, n_comps, ib);
+    psc::moment::deposit<psc::deposit::code::Deposit1stCc, dim_t>(
+      mres_ref, ib, mprts, [&](auto& deposit_one, const auto& prt) {
+        auto v = vals(prt);
+        for (std::size_t m = 0; m < N; m++) {
+          deposit_one(N * prt.kind() + m, v[m]);
+        }
+      });
+
+    EXPECT_GT(gt::norm_linf(mres_ref), 0.);
+    EXPECT_LT(gt::norm_linf(mres - mres_ref), this->eps);
+  }
+};
+
+using MomentFusedTestTypes = ::testing::Types<
+  MomentTestConfig<MfieldsC, MparticlesDouble, dim_xyz>,
+  MomentTestConfig<MfieldsC, MparticlesDouble, dim_yz>,
+  MomentTestConfig<MfieldsSingle, MparticlesSingle, dim_xyz>,
+  MomentTestConfig<MfieldsSingle, MparticlesSingle, dim_yz>>;
+
+TYPED_TEST_SUITE(MomentFusedTest, MomentFusedTestTypes);
+
+TYPED_TEST(MomentFusedTest, n)
+{
+  using real_t = typename TestFixture::real_t;
+
+  this->template check<psc::moment::moment_n, 1>([](const auto& prt) {
+    return std::array<real_t, 1>{real_t(prt.w())};
+  });
+}
+
+TYPED_TEST(MomentFusedTest, v)
+{
+  using real_t = typename TestFixture::real_t;
+
+  this->template check<psc::moment::moment_v, 3>([](const auto& prt) {
+    typename TestFixture::Mparticles::real_t vxi[3];
+    psc::moment::_particle_calc_vxi(prt, vxi);
+    return std::array<real_t, 3>{prt.w() * vxi[0], prt.w() * vxi[1],
+                                 prt.w() * vxi[2]};
+  });
+}
+
+TYPED_TEST(MomentFusedTest, p)
+{
+  using real_t = typename TestFixture::real_t;
+
+  this->template check<psc::moment::moment_p, 3>([](const auto& prt) {
+    real_t wm = prt.w() * prt.m();
+    return std::array<real_t, 3>{wm * prt.u()[0], wm * prt.u()[1],
+                                 wm * prt.u()[2]};
+  });
+}
+
+TYPED_TEST(MomentFusedTest, T)
+{
+  using real_t = typename TestFixture::real_t;
+
+  this->template check<psc::moment::moment_T, 6>([](const auto& prt) {
+    typename TestFixture::Mparticles::real_t vxi[3];
+    psc::moment::_particle_calc_vxi(prt, vxi);
+    real_t wm = prt.w() * prt.m();
+    return std::array<real_t, 6>{
+      wm * prt.u()[0] * vxi[0], wm * prt.u()[1] * vxi[1],
+      wm * prt.u()[2] * vxi[2], wm * prt.u()[0] * vxi[1],
+      wm * prt.u()[0] * vxi[2], wm * prt.u()[1] * vxi[2]};
+  });
+}
+
+TYPED_TEST(MomentFusedTest, all)
+{
+  using real_t = typename TestFixture::real_t;
+
+  this->template check<psc::moment::moment_all, 13>([](const auto& prt) {
+    typename TestFixture::Mparticles::real_t vxi[3];
+    psc::moment::_particle_calc_vxi(prt, vxi);
+    real_t wq = prt.w() * prt.q();
+    real_t wm = prt.w() * prt.m();
+    return std::array<real_t, 13>{
+      wq,
+      wq * vxi[0],
+      wq * vxi[1],
+      wq * vxi[2],
+      wm * prt.u()[0],
+      wm * prt.u()[1],
+      wm * prt.u()[2],
+      wm * prt.u()[0] * vxi[0],
+      wm * prt.u()[1] * vxi[1],
+      wm * prt.u()[2] * vxi[2],
+      wm * prt.u()[0] * vxi[1],
+      wm * prt.u()[1] * vxi[2],
+      wm * prt.u()[2] * vxi[0]};
+  });
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
@@ -12,6 +12,7 @@
 #include "psc_particles_single.h"
 #include "particle_with_id.h"
 #include "setup_particles.hxx"
+#include "bnd_particles_impl.hxx"
 #ifdef USE_CUDA
 #include "../libpsc/cuda/mparticles_cuda.hxx"
 #include "../libpsc/cuda/mparticles_cuda.inl"
@@ -37,7 +38,9 @@ struct Config
 
 using MparticlesTestTypes = ::testing::Types<
   Config<MparticlesSingle>, Config<MparticlesSingle, MakeTestGridYZ>,
-  Config<MparticlesDouble>, Config<MparticlesVpic, MakeTestGridYZ1>
+  Config<MparticlesDouble>, Config<MparticlesSingleSoA>,
+  Config<MparticlesSingleSoA, MakeTestGridYZ>,
+  Config<MparticlesVpic, MakeTestGridYZ1>
 #ifdef USE_CUDA
   ,
   Config<MparticlesCuda<BS144>, MakeTestGridYZ1>,
@@ -377,6 +380,96 @@ TYPED_TEST(MparticlesTest, ConversionFromMparticlesSingle)
   test(mprts);
 }
 
+// ----------------------------------------------------------------------
+// SoA storage: changes made through the accessor end up in the
+// per-component arrays
+
+TEST(MparticlesSoATest, ComponentArrays)
+{
+  auto grid = MakeTestGridYZ1{}();
+  grid.kinds.emplace_back(Grid_t::Kind(1., 1., "test_species"));
+  MparticlesSingleSoA mprts{grid};
+
+  {
+    auto injector = mprts.injector()[0];
+    injector({{5., -35., -75.}, {1., 2., 3.}, 1., 0});
+    injector({{5., -30., -70.}, {4., 5., 6.}, 1., 0});
+  }
+
+  {
+    auto accessor = mprts.accessor_();
+    for (auto prt : accessor[0]) {
+      prt.u()[0] += 10.f;
+    }
+  }
+
+  auto& storage = mprts.storage()[0];
+  ASSERT_EQ(storage.size(), 2);
+  EXPECT_EQ(storage.x(1)[0], 5.f);
+  EXPECT_EQ(storage.x(1)[1], 10.f);
+  EXPECT_EQ(storage.u(0)[0], 11.f);
+  EXPECT_EQ(storage.u(0)[1], 14.f);
+  EXPECT_EQ(storage.u(2)[1], 6.f);
+  EXPECT_EQ(storage.kind()[1], 0);
+}
+
+// ----------------------------------------------------------------------
+// SoA storage: the boundary exchange works on the SoA buffers directly,
+// and gives the same result as for AoS storage
+
+template <typename Mparticles>
+static void exchange_moved(Mparticles& mprts)
+{
+  const auto& grid = mprts.grid();
+  {
+    auto injector = mprts.injector();
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      const auto& patch = grid.patches[p];
+      for (int n = 0; n < 20; n++) {
+        auto x = patch.xb + ((n + .5) / 20.) * (patch.xe - patch.xb);
+        injector[p]({x, {double(n), 0., 0.}, 1., 0});
+      }
+    }
+  }
+
+  // move them around, some across patch boundaries
+  for (int p = 0; p < mprts.n_patches(); p++) {
+    auto prts = mprts[p];
+    for (int n = 0; n < prts.size(); n++) {
+      auto&& prt = prts[n];
+      prt.x[1] += (n % 5 - 2) * 7.f;
+      prt.x[2] += (n % 3 - 1) * 7.f;
+    }
+  }
+
+  BndParticles_<Mparticles> bndp{grid};
+  bndp(mprts);
+}
+
+TEST(MparticlesSoATest, BndExchange)
+{
+  auto grid = MakeTestGridYZ{}();
+  grid.kinds.emplace_back(Grid_t::Kind(1., 1., "test_species"));
+  MparticlesSingle mprts{grid};
+  MparticlesSingleSoA mprts_soa{grid};
+  exchange_moved(mprts);
+  exchange_moved(mprts_soa);
+
+  EXPECT_EQ(mprts_soa.size(), mprts.size());
+  for (int p = 0; p < mprts.n_patches(); p++) {
+    auto prts = mprts[p];
+    auto prts_soa = mprts_soa[p];
+    ASSERT_EQ(prts_soa.size(), prts.size());
+    for (int n = 0; n < prts.size(); n++) {
+      ParticleSimple<float> prt = prts[n], prt_soa = prts_soa[n];
+      EXPECT_EQ(prt_soa.x, prt.x);
+      EXPECT_EQ(prt_soa.u, prt.u);
+      EXPECT_EQ(prt_soa.qni_wni, prt.qni_wni);
+      EXPECT_EQ(prt_soa.kind, prt.kind);
+    }
+  }
+}
+
 #ifdef PSC_HAVE_ADIOS2
 
 // ======================================================================
@@ -389,7 +482,7 @@ struct MparticlesIOTest : MparticlesTest<T>
 using MparticlesIOTestTypes =
   ::testing::Types<Config<MparticlesSingle>,
                    Config<MparticlesSingle, MakeTestGridYZ>,
-                   Config<MparticlesDouble>
+                   Config<MparticlesDouble>, Config<MparticlesSingleSoA>
 #ifdef USE_CUDA
                    ,
                    Config<MparticlesCuda<BS144>, MakeTestGridYZ1>,
@@ -105,12 +105,89 @@ TYPED_TEST(OutputParticlesTest, Test1)
   outp(mprts);
 }
 
+#ifdef H5_HAVE_PARALLEL
+
+// ======================================================================
+// AggregatedAsync
+//
+// write with per-node aggregation on the I/O thread, then read the
+// particles and the per-cell index back
+
+using OutputParticlesHdf5Test =
+  OutputParticlesTest<Config<dim_xyz, MparticlesSingle, OutputParticlesHdf5>>;
+
+TEST_F(OutputParticlesHdf5Test, AggregatedAsync)
+{
+  auto kinds = Grid_t::Kinds{{1., 100., "ion"}, {-1., 1., "electron"}};
+  this->make_psc(kinds);
+  const auto& grid = this->grid();
+
+  MparticlesSingle mprts{grid};
+  if (grid.n_patches() > 0) {
+    auto injector = mprts.injector();
+    injector[0]({{1., 0., 0.}, {}, 1., 0});
+    injector[0]({{2., 0., 0.}, {}, 1., 1});
+  }
+
+  auto params = OutputParticlesParams{};
+  params.every_step = 1;
+  params.data_dir = ".";
+  params.basename = "prt_agg";
+  params.aggregate = true;
+  params.async = true;
+
+  {
+    auto outp = OutputParticlesHdf5{grid, params};
+    outp(mprts);
+  } // waits for the write to finish
+
+  int rank;
+  MPI_Comm_rank(grid.comm(), &rank);
+  if (rank != 0) {
+    return;
+  }
+
+  hid_t file =
+    H5Fopen("./prt_agg.000000_p000000.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+  ASSERT_GE(file, 0);
+
+  hid_t dset = H5Dopen(file, "particles/p0/1d", H5P_DEFAULT);
+  hid_t space = H5Dget_space(dset);
+  ASSERT_EQ(H5Sget_simple_extent_npoints(space), 2);
+  H5Sclose(space);
+  std::vector<hdf5_prt> prts(2);
+  H5Dread(dset, detail::Hdf5ParticleType{}, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+          prts.data());
+  H5Dclose(dset);
+  EXPECT_EQ(prts[0].x, 1.f);
+  EXPECT_EQ(prts[1].x, 2.f);
+  EXPECT_EQ(prts[1].q, -1.f);
+
+  // both particles are in cell (0, 0, 0), one of each kind
+  int n_cells = 16 * 16 * 16;
+  std::vector<hsize_t> idx_begin(2 * n_cells), idx_end(2 * n_cells);
+  H5LTread_dataset(file, "particles/p0/idx_begin", H5T_NATIVE_HSIZE,
+                   idx_begin.data());
+  H5LTread_dataset(file, "particles/p0/idx_end", H5T_NATIVE_HSIZE,
+                   idx_end.data());
+  EXPECT_EQ(idx_begin[0], 0);
+  EXPECT_EQ(idx_end[0], 1);
+  EXPECT_EQ(idx_begin[n_cells], 1);
+  EXPECT_EQ(idx_end[n_cells], 2);
+  EXPECT_EQ(idx_begin[1], idx_end[1]);
+
+  H5Fclose(file);
+}
+
+#endif
+
 // ----------------------------------------------------------------------
 // main
 
 int main(int argc, char** argv)
 {
-  MPI_Init(&argc, &argv);
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
   ::testing::InitGoogleTest(&argc, argv);
   int rc = RUN_ALL_TESTS();
   MPI_Finalize();
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include "test_common.hxx"
+
+#include "../libpsc/vpic/vpic_config.h"
+
+#include <algorithm>
+#include <cmath>
+
+using VpicConfig = VpicConfigPsc;
+
+using Grid = VpicConfig::Grid;
+using Mparticles = VpicConfig::Mparticles;
+using MfieldsInterpolator = VpicConfig::MfieldsInterpolator;
+using MfieldsAccumulator = VpicConfig::MfieldsAccumulator;
+using AccumulatorOps = VpicConfig::AccumulatorOps;
+using ParticlesOps = VpicConfig::ParticlesOps;
+
+// ======================================================================
+// PscParticlesOpsTest
+//
+// advance_p splits the particles into pipelines that each accumulate into
+// their own block and record their own movers. Check that this gives the
+// same result as a single pipeline.
+
+struct PscParticlesOpsTest : ::testing::Test
+{
+  PscParticlesOpsTest() : grid_{MakeTestGrid1{}()}
+  {
+    grid_.kinds.emplace_back(Grid_t::Kind(1., 1., "test_species"));
+
+    auto& domain = grid_.domain;
+    double dx[3], xl[3], xh[3];
+    for (int d = 0; d < 3; d++) {
+      dx[d] = domain.length[d] / domain.gdims[d];
+      xl[d] = domain.corner[d];
+      xh[d] = xl[d] + domain.length[d];
+    }
+    vgrid_.setup(dx, grid_.dt, 1., 1.);
+    vgrid_.partition_periodic_box(xl, xh, domain.gdims, domain.np);
+  }
+
+  struct Result
+  {
+    std::vector<Mparticles::Particle> prts;
+    std::vector<Mparticles::ParticleMover> movers;
+    std::vector<float> acc;
+  };
+
+  // push n_prts particles, which isn't a multiple of 16, through uniform E
+  // and B fields using n_pipeline pipelines
+  Result push(int n_pipeline, int n_prts = 1003)
+  {
+    Mparticles mprts{grid_, &vgrid_};
+    mprts.define_species("test_species", 1., 1., n_prts, n_prts, 10, 0);
+    {
+      auto injector = mprts.injector();
+      const auto& patch = grid_.patches[0];
+      for (int n = 0; n < n_prts; n++) {
+        double xi[3] = {std::fmod(n * .37, 1.), std::fmod(n * .53, 1.),
+                        std::fmod(n * .71, 1.)};
+        Double3 u = {.1 * std::sin(n), .2 * std::cos(n), .3 * std::sin(2 * n)};
+        Double3 x;
+        for (int d = 0; d < 3; d++) {
+          x[d] = patch.xb[d] + xi[d] * (patch.xe[d] - patch.xb[d]);
+        }
+        injector[0]({x, u, 1., 0});
+      }
+    }
+
+    MfieldsInterpolator interpolator{&vgrid_};
+    auto& ip = interpolator.getPatch(0);
+    for (int i = 0; i < vgrid_.nv; i++) {
+      ip[i].ex = .01;
+      ip[i].ey = -.02;
+      ip[i].ez = .03;
+      ip[i].cbx = .1;
+      ip[i].cbz = -.2;
+    }
+
+    MfieldsAccumulator accumulator{&vgrid_};
+    AccumulatorOps::clear(accumulator);
+    auto& sp = *mprts[0].begin();
+    ParticlesOps::advance_p(sp, accumulator, interpolator, n_pipeline);
+    AccumulatorOps::reduce(accumulator);
+
+    Result res;
+    res.prts.assign(sp.p, sp.p + sp.np);
+    res.movers.assign(sp.pm, sp.pm + sp.nm);
+    auto acc = reinterpret_cast<float*>(accumulator.data());
+    int n_floats = accumulator.stride() *
+                   sizeof(MfieldsAccumulator::Element) / sizeof(float);
+    res.acc.assign(acc, acc + n_floats);
+    return res;
+  }
+
+  Grid_t grid_;
+  Grid vgrid_;
+};
+
+TEST_F(PscParticlesOpsTest, AdvancePipelined)
+{
+  auto ref = push(1);
+  EXPECT_GT(*std::max_element(ref.acc.begin(), ref.acc.end()), 0.f);
+  for (int n_pipeline : {2, 3}) {
+    auto res = push(n_pipeline);
+
+    ASSERT_EQ(res.prts.size(), ref.prts.size());
+    for (std::size_t n = 0; n < ref.prts.size(); n++) {
+      EXPECT_EQ(res.prts[n].i, ref.prts[n].i) << "n " << n;
+      EXPECT_EQ(res.prts[n].dx, ref.prts[n].dx) << "n " << n;
+      EXPECT_EQ(res.prts[n].dy, ref.prts[n].dy) << "n " << n;
+      EXPECT_EQ(res.prts[n].dz, ref.prts[n].dz) << "n " << n;
+      EXPECT_EQ(res.prts[n].ux, ref.prts[n].ux) << "n " << n;
+      EXPECT_EQ(res.prts[n].uy, ref.prts[n].uy) << "n " << n;
+      EXPECT_EQ(res.prts[n].uz, ref.prts[n].uz) << "n " << n;
+    }
+
+    ASSERT_EQ(res.movers.size(), ref.movers.size());
+    for (std::size_t n = 0; n < ref.movers.size(); n++) {
+      EXPECT_EQ(res.movers[n].i, ref.movers[n].i) << "n " << n;
+      EXPECT_EQ(res.movers[n].dispx, ref.movers[n].dispx) << "n " << n;
+      EXPECT_EQ(res.movers[n].dispy, ref.movers[n].dispy) << "n " << n;
+      EXPECT_EQ(res.movers[n].dispz, ref.movers[n].dispz) << "n " << n;
+    }
+
+    // the blocks get summed in a different order
+    for (std::size_t i = 0; i < ref.acc.size(); i++) {
+      EXPECT_NEAR(res.acc[i], ref.acc[i], 1e-6) << "i " << i;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
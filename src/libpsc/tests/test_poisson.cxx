@@ -0,0 +1,182 @@
+
+#include <gtest/gtest.h>
+
+#include "grid.hxx"
+#include "fields3d.hxx"
+#include "setup_fields.hxx"
+#include "psc_fields_c.h"
+#include "psc_particles_double.h"
+#include "../libpsc/psc_output_fields/fields_item_fields.hxx"
+#include "../libpsc/psc_push_fields/poisson_impl.hxx"
+
+#include <gtensor/reductions.h>
+
+static Grid_t make_grid(int fld_bc_z = BND_FLD_PERIODIC)
+{
+  auto domain =
+    Grid_t::Domain{{1, 32, 64}, {10., 20., 80.}, {0., 0., 0.}, {1, 2, 4}};
+  auto bc = psc::grid::BC{};
+  bc.fld_lo[2] = fld_bc_z;
+  bc.fld_hi[2] = fld_bc_z;
+  auto kinds = Grid_t::Kinds{};
+  auto norm = Grid_t::Normalization{};
+  double dt = .1;
+  int n_patches = -1;
+  auto ibn = Int3{0, 2, 2};
+  return Grid_t{domain, bc, kinds, norm, dt, n_patches, ibn};
+}
+
+// ----------------------------------------------------------------------
+// check_solve
+//
+// solves for a Fourier mode phi_ref, for which the discrete Laplacian is
+// known exactly; ky, kz are mode numbers (in units of pi / L)
+
+static void check_solve(const Grid_t& grid, int ky, int kz)
+{
+  PoissonParams prm;
+  prm.tol = 1e-10;
+  psc::poisson::Multigrid mg{prm};
+  mg.setup(grid);
+  EXPECT_GT(mg.n_levels(), 1);
+
+  auto dx = grid.domain.dx;
+  double k[3] = {0., ky * M_PI / grid.domain.length[1],
+                 kz * M_PI / grid.domain.length[2]};
+  double lambda = 0.;
+  for (int d = 1; d < 3; d++) {
+    lambda -= 4. / sqr(dx[d]) * sqr(std::sin(.5 * k[d] * dx[d]));
+  }
+  auto phi_ref = [&](int p, int j, int k_) {
+    Int3 off = grid.patches[p].off;
+    return std::cos(k[1] * (j + off[1]) * dx[1] + .3) *
+           std::sin(k[2] * (k_ + off[2]) * dx[2]);
+  };
+
+  Int3 ibn = grid.ibn;
+  for (int p = 0; p < grid.n_patches(); p++) {
+    grid.Foreach_3d(0, 0, [&](int i, int j, int k) {
+      mg.rhs()(i + ibn[0], j + ibn[1], k + ibn[2], 0, p) =
+        lambda * phi_ref(p, j, k);
+    });
+  }
+
+  mg.solve();
+  EXPECT_LT(mg.residual(), prm.tol);
+
+  for (int p = 0; p < grid.n_patches(); p++) {
+    // includes the upper layer of ghost points
+    grid.Foreach_3d(0, 1, [&](int i, int j, int k) {
+      EXPECT_NEAR(mg.phi()(i + ibn[0], j + ibn[1], k + ibn[2], 0, p),
+                  phi_ref(p, j, k), 1e-8)
+        << "p " << p << " j " << j << " k " << k;
+    });
+  }
+}
+
+TEST(Poisson, Periodic)
+{
+  auto grid = make_grid();
+  check_solve(grid, 2, 4);
+}
+
+TEST(Poisson, ConductingWall)
+{
+  auto grid = make_grid(BND_FLD_CONDUCTING_WALL);
+  check_solve(grid, 2, 1);
+}
+
+// ----------------------------------------------------------------------
+// CoarseCorrection
+//
+// 3d, where the smoother alone converges slowly, so it takes a working
+// coarse-grid correction (down to a CG solve on the coarsest of several
+// levels) to converge in a few cycles
+
+TEST(Poisson, CoarseCorrection)
+{
+  auto domain =
+    Grid_t::Domain{{16, 32, 64}, {16., 20., 80.}, {0., 0., 0.}, {2, 2, 4}};
+  auto bc = psc::grid::BC{};
+  auto kinds = Grid_t::Kinds{};
+  auto norm = Grid_t::Normalization{};
+  auto grid = Grid_t{domain, bc, kinds, norm, .1, -1, Int3{2, 2, 2}};
+
+  PoissonParams prm;
+  prm.tol = 1e-10;
+  psc::poisson::Multigrid mg{prm};
+  mg.setup(grid);
+  EXPECT_GE(mg.n_levels(), 3);
+
+  auto dx = grid.domain.dx;
+  Vec3<double> k;
+  double lambda = 0.;
+  for (int d = 0; d < 3; d++) {
+    k[d] = 2. * M_PI / grid.domain.length[d];
+    lambda -= 4. / sqr(dx[d]) * sqr(std::sin(.5 * k[d] * dx[d]));
+  }
+  auto phi_ref = [&](int p, int i, int j, int k_) {
+    Int3 off = grid.patches[p].off;
+    return std::cos(k[0] * (i + off[0]) * dx[0]) *
+           std::cos(k[1] * (j + off[1]) * dx[1] + .3) *
+           std::sin(k[2] * (k_ + off[2]) * dx[2]);
+  };
+
+  Int3 ibn = grid.ibn;
+  for (int p = 0; p < grid.n_patches(); p++) {
+    grid.Foreach_3d(0, 0, [&](int i, int j, int k) {
+      mg.rhs()(i + ibn[0], j + ibn[1], k + ibn[2], 0, p) =
+        lambda * phi_ref(p, i, j, k);
+    });
+  }
+
+  int n_cycles = mg.solve();
+  EXPECT_LT(mg.residual(), prm.tol);
+  EXPECT_LE(n_cycles, 15);
+
+  for (int p = 0; p < grid.n_patches(); p++) {
+    grid.Foreach_3d(0, 0, [&](int i, int j, int k) {
+      EXPECT_NEAR(mg.phi()(i + ibn[0], j + ibn[1], k + ibn[2], 0, p),
+                  phi_ref(p, i, j, k), 1e-8);
+    });
+  }
+}
+
+TEST(Poisson, Projection)
+{
+  auto grid = make_grid();
+  auto mflds = MfieldsStateDouble{grid};
+  auto mprts = MparticlesDouble{grid};
+  auto ky = 2. * M_PI / grid.domain.length[1];
+  auto kz = 2. * M_PI / grid.domain.length[2];
+
+  // Ex is divergence-free, the others aren't
+  setupFields(mflds, [&](int m, double crd[3]) {
+    switch (m) {
+      case EX: return std::sin(ky * crd[1]);
+      case EY: return std::cos(ky * crd[1]) * std::sin(kz * crd[2]);
+      case EZ: return .5 * std::sin(2. * kz * crd[2]) + std::cos(ky * crd[1]);
+      default: return 0.;
+    }
+  });
+  auto ex_ref = gt::eval(mflds.storage().view(_all, _all, _all, EX));
+
+  // no particles, so rho = 0
+  PoissonProjection_<MfieldsStateDouble::Storage, dim_yz> projection{grid};
+  projection(mflds, mprts);
+
+  auto dive = psc::item::div_nc(
+    grid, mflds.storage().view(_all, _all, _all, _s(EX, EX + 3)));
+  EXPECT_LT(gt::norm_linf(dive), 1e-6);
+  EXPECT_LT(gt::norm_linf(mflds.storage().view(_all, _all, _all, EX) - ex_ref),
+            1e-12);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -4,6 +4,7 @@
 #include "testing.hxx"
 
 #include "../libpsc/psc_push_fields/marder_impl.hxx"
+#include "../libpsc/psc_bnd_fields/psc_bnd_fields_impl.hxx"
 
 #include <gtensor/reductions.h>
 
@@ -167,6 +168,102 @@ TYPED_TEST(PushFieldsTest, MarderCorrect)
             1e-3);
 }
 
+// ======================================================================
+// MarderErr
+//
+// The errors Marder finds are reduced all at once after the correction,
+// and it only fills one layer of ghost points within the loop. Both need
+// to give the same errors and result as filling all ghost points and
+// reducing right away in each iteration.
+
+template <typename T>
+struct MarderTest : PushParticlesTest<T>
+{};
+
+using MarderTestTypes =
+  ::testing::Types<TestConfig1vbec3dSingleYZ, TestConfig1vbec3dSingle>;
+
+TYPED_TEST_SUITE(MarderTest, MarderTestTypes);
+
+TYPED_TEST(MarderTest, MarderErr)
+{
+  using Mparticles = typename TypeParam::Mparticles;
+  using MfieldsState = typename TypeParam::MfieldsState;
+  using Mfields = typename TypeParam::Mfields;
+  using dim = typename TypeParam::dim;
+  using Storage = typename Mfields::Storage;
+  using real_t = typename Mfields::real_t;
+
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(1., 1., "test_species")};
+  this->make_psc(kinds);
+  const auto& grid = this->grid();
+
+  const double ky = 2. * M_PI / grid.domain.length[1];
+  const double kz = 2. * M_PI / grid.domain.length[2];
+  const double diffusion = .9;
+  const int loop = 3;
+
+  Mparticles mprts{grid};
+  {
+    auto injector = mprts.injector();
+    auto x = grid.patches[0].xb + Grid_t::Real3{5., 25., 35.};
+    injector[0]({x, {}, 1., 0});
+  }
+
+  auto init_fields = [&](int m, double crd[3]) {
+    switch (m) {
+      case EY: return .5 * sin(ky * crd[1]);
+      case EZ: return sin(kz * crd[2]);
+      default: return 0.;
+    }
+  };
+  auto mflds = MfieldsState{grid};
+  setupFields(mflds, init_fields);
+  auto mflds_ref = MfieldsState{grid};
+  setupFields(mflds_ref, init_fields);
+
+  Marder_<Storage, dim> marder{grid, diffusion, loop, false, 1};
+  marder(mflds, mprts);
+  auto& errs = marder.errs();
+  ASSERT_EQ(errs.size(), std::size_t(loop));
+
+  // reference: the way it used to be done
+  double inv_sum = 0.;
+  for (int d = 0; d < 3; d++) {
+    if (!grid.isInvar(d)) {
+      inv_sum += 1. / sqr(grid.domain.dx[d]);
+    }
+  }
+  double diffusion_max = 1. / 2. / (.5 * grid.dt) / inv_sum;
+
+  auto efield =
+    mflds_ref.storage().view(_all, _all, _all, _s(EX, EX + 3), _all);
+  auto rho = psc::mflds::interior(
+    grid, Moment_rho_1st_nc<Storage, dim>{grid}(mprts));
+  Bnd_ bnd;
+  for (int i = 0; i < loop; i++) {
+    bnd.fill_ghosts(grid, mflds_ref.storage(), mflds_ref.ib(), EX, EX + 3);
+    auto dive = psc::mflds::interior(grid, psc::item::div_nc(grid, efield));
+
+    Int3 res_ib = -grid.ibn;
+    auto res = Storage{psc::mflds::make_shape(grid, 1, res_ib)};
+    psc::mflds::interior(grid, res) = dive - rho;
+    bnd.fill_ghosts(grid, res, res_ib, 0, 1);
+
+    real_t err = gt::norm_linf(psc::mflds::interior(grid, res));
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MpiDtypeTraits<real_t>::value(),
+                  MPI_MAX, grid.comm());
+    EXPECT_GT(err, 0.);
+    EXPECT_FLOAT_EQ(errs[i], err) << "iteration " << i;
+
+    psc::marder::correct(grid, efield, mflds_ref.ib(), res, res_ib,
+                         diffusion_max * diffusion);
+  }
+  bnd.fill_ghosts(grid, mflds_ref.storage(), mflds_ref.ib(), EX, EX + 3);
+
+  EXPECT_LT(gt::norm_linf(mflds.gt() - mflds_ref.gt()), 1e-6);
+}
+
 template <typename T>
 struct ItemTest : PushParticlesTest<T>
 {};
@@ -262,6 +359,140 @@ TYPED_TEST(ItemTest, ItemDivJ)
   EXPECT_LT(gt::norm_linf(rho - rho_ref), 1e-2);
 }
 
+// ======================================================================
+// TemporalBlocking
+//
+// Runs the field part of Psc::step_psc() for a number of steps, with and
+// without temporal blocking, on 2x2 patches in y, z, which may be spread
+// over ranks. The interior E / H have to come out the same. (Ghost points
+// beyond a wall, next to a patch boundary, aren't filled by the ghost
+// exchange and may differ, but nothing in the interior depends on them.)
+
+template <typename T>
+struct TemporalBlockingTest : PushParticlesTest<T>
+{
+  using dim = typename T::dim;
+  using MfieldsState = typename T::MfieldsState;
+  using PushFields = typename T::PushFields;
+  using Bnd = typename T::Bnd;
+  using BndFields = BndFields_<MfieldsState, dim>;
+
+  // like make_psc(), but split into patches, and with the given field
+  // boundary condition in y
+  void make_grid(int fld_bc_y)
+  {
+    const bool invar[3] = {dim::InvarX::value, dim::InvarY::value,
+                           dim::InvarZ::value};
+    Int3 gdims = {16, 16, 16};
+    for (int d = 0; d < 3; d++) {
+      if (invar[d]) {
+        gdims[d] = 1;
+        this->ibn[d] = 0;
+      }
+    }
+    int prt_bc_y =
+      fld_bc_y == BND_FLD_PERIODIC ? BND_PRT_PERIODIC : BND_PRT_REFLECTING;
+
+    auto grid_domain = Grid_t::Domain{
+      gdims, {this->L, this->L, this->L}, {0., 0., 0.}, {1, 2, 2}};
+    auto grid_bc =
+      psc::grid::BC{{BND_FLD_PERIODIC, fld_bc_y, BND_FLD_PERIODIC},
+                    {BND_FLD_PERIODIC, fld_bc_y, BND_FLD_PERIODIC},
+                    {BND_PRT_PERIODIC, prt_bc_y, BND_PRT_PERIODIC},
+                    {BND_PRT_PERIODIC, prt_bc_y, BND_PRT_PERIODIC}};
+
+    auto norm_params = Grid_t::NormalizationParams::dimensionless();
+    norm_params.nicell = 200;
+    auto coeff = Grid_t::Normalization{norm_params};
+
+    this->grid_ =
+      new Grid_t{grid_domain, grid_bc, {}, coeff, 1., -1, this->ibn};
+  }
+
+  // the same sequence of pushes and exchanges as step_psc()
+  void step(MfieldsState& mflds, bool temporal_blocking)
+  {
+    pushf_.push_H(mflds, .5, dim{});
+    bndf_.fill_ghosts_H(mflds);
+    if (!temporal_blocking) {
+      bnd_.fill_ghosts(mflds, HX, HX + 3);
+    }
+
+    pushf_.push_E(mflds, 1., dim{},
+                  [&]() { bnd_.fill_ghosts(mflds, JXI, JXI + 3); });
+    bndf_.fill_ghosts_E(mflds);
+
+    if (temporal_blocking) {
+      pushf_.push_H(mflds, .5, dim{});
+    } else {
+      pushf_.push_H(mflds, .5, dim{},
+                    [&]() { bnd_.fill_ghosts(mflds, EX, EX + 3); });
+    }
+    bndf_.fill_ghosts_H(mflds);
+    if (temporal_blocking) {
+      bnd_.fill_ghosts(mflds, EX, HX + 3);
+    } else {
+      bnd_.fill_ghosts(mflds, HX, HX + 3);
+    }
+  }
+
+  void check(int fld_bc_y)
+  {
+    const int n_steps = 10;
+
+    make_grid(fld_bc_y);
+    const auto& grid = this->grid();
+
+    const double ky = 2. * M_PI / grid.domain.length[1];
+    const double kz = 2. * M_PI / grid.domain.length[2];
+
+    auto mflds = MfieldsState{grid};
+    setupFields(mflds, [&](int m, double crd[3]) {
+      if (m < EX) {
+        return 0.;
+      }
+      return sin(ky * crd[1] + m) * cos(2. * kz * crd[2] - m) + .1 * m;
+    });
+    bndf_.fill_ghosts_E(mflds);
+    bndf_.fill_ghosts_H(mflds);
+    bnd_.fill_ghosts(mflds, EX, HX + 3);
+
+    auto mflds_tb = MfieldsState{grid};
+    mflds_tb.storage() = mflds.storage();
+
+    for (int n = 0; n < n_steps; n++) {
+      step(mflds, false);
+      step(mflds_tb, true);
+    }
+
+    auto bnd = mflds.ibn();
+    auto interior = [&](MfieldsState& mf) {
+      return mf.storage().view(_s(bnd[0], bnd[0] + grid.ldims[0]),
+                               _s(bnd[1], bnd[1] + grid.ldims[1]),
+                               _s(bnd[2], bnd[2] + grid.ldims[2]),
+                               _s(EX, HX + 3), _all);
+    };
+    EXPECT_GT(gt::norm_linf(interior(mflds)), 0.);
+    EXPECT_EQ(gt::norm_linf(interior(mflds) - interior(mflds_tb)), 0.);
+  }
+
+  PushFields pushf_;
+  Bnd bnd_;
+  BndFields bndf_;
+};
+
+using TemporalBlockingTestTypes =
+  ::testing::Types<TestConfig1vbec3dSingleYZ, TestConfig1vbec3dSingle>;
+
+TYPED_TEST_SUITE(TemporalBlockingTest, TemporalBlockingTestTypes);
+
+TYPED_TEST(TemporalBlockingTest, Periodic) { this->check(BND_FLD_PERIODIC); }
+
+TYPED_TEST(TemporalBlockingTest, ConductingWall)
+{
+  this->check(BND_FLD_CONDUCTING_WALL);
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
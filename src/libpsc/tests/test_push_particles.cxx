@@ -13,6 +13,9 @@
 
 using PushParticlesTestTypes = ::testing::Types<
   TestConfig2ndDoubleYZ, TestConfig1vbec3dSingleYZ, TestConfig1vbec3dSingleXZ,
+  TestConfig1vbec3dSingleYZSimd, TestConfig1vbec3dSingleSimd,
+  TestConfig1vbec3dSingleYZSimdVar1, TestConfig1vbec3dSingleSimdVar1,
+  TestConfig1vbec3dSingleYZTile, TestConfig1vbec3dSingleTile,
 // TestConfigVpic,
 #ifdef USE_CUDA
   TestConfig1vbec3dCudaYZ, TestConfig1vbec3dCuda, TestConfig1vbec3dCuda444,
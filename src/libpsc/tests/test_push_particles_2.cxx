@@ -2,9 +2,14 @@
 #include "gtest/gtest.h"
 
 #include "testing.hxx"
+#include "subcycling.hxx"
 
+// the SIMD pushers are run with n_prts per patch that isn't a multiple of
+// the vector width, so the partial last batch gets tested, too
 using PushParticlesTestTypes =
-  ::testing::Types<TestConfig2ndDoubleYZ, TestConfig1vbec3dSingle
+  ::testing::Types<TestConfig2ndDoubleYZ, TestConfig1vbec3dSingle,
+                   TestConfig1vbec3dSingleYZSimdVar1,
+                   TestConfig1vbec3dSingleSimdVar1
 #ifdef USE_CUDA
                    ,
                    TestConfig1vbec3dCudaYZ
@@ -175,6 +180,175 @@ TYPED_TEST(PushParticlesTest, Cyclo)
   }
 }
 
+// ======================================================================
+// Subcycle test
+//
+// like Accel, with electrons pushed every step and ions every other step
+
+template <typename T>
+struct PushParticlesSubcycleTest : PushParticlesTest<T>
+{};
+
+using PushParticlesSubcycleTestTypes =
+  ::testing::Types<TestConfig2ndDoubleYZ, TestConfig1vbec3dSingle>;
+
+TYPED_TEST_SUITE(PushParticlesSubcycleTest, PushParticlesSubcycleTestTypes);
+
+TYPED_TEST(PushParticlesSubcycleTest, Accel)
+{
+  using Mparticles = typename TypeParam::Mparticles;
+  using MfieldsState = typename TypeParam::MfieldsState;
+  using PushParticles = typename TypeParam::PushParticles;
+  using BndParticles = typename TypeParam::BndParticles;
+  using Bnd = typename TypeParam::Bnd;
+
+  const int n_prts = 131;
+  const int n_steps = 10;
+  const typename Mparticles::real_t eps = 1e-5;
+
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(-1., 1., "e"),
+                             Grid_t::Kind(1., 4., "i")};
+  this->make_psc(kinds);
+  const auto& grid = this->grid();
+
+  auto mflds = MfieldsState{grid};
+  setupFields(mflds, [](int m, double crd[3]) {
+    switch (m) {
+      case EX: return 1.;
+      case EY: return 2.;
+      case EZ: return 3.;
+      default: return 0.;
+    }
+  });
+
+  RngPool rngpool;
+  Rng* rng = rngpool[0];
+
+  Mparticles mprts{grid};
+  {
+    auto inj = mprts.injector();
+    for (int p = 0; p < grid.n_patches(); p++) {
+      auto injector = inj[p];
+      for (int n = 0; n < n_prts; n++) {
+        injector({{rng->uniform(0, this->L), rng->uniform(0, this->L),
+                   rng->uniform(0, this->L)},
+                  {},
+                  1.,
+                  n % 2});
+      }
+    }
+  }
+
+  PushParticles pushp_;
+  BndParticles bndp_{grid};
+  Bnd bnd_{};
+  Subcycling<MfieldsState> subcycling{grid, {1, 2}};
+  EXPECT_TRUE(subcycling.active());
+  for (int n = 0; n < n_steps; n++) {
+    subcycling.push_mprts(pushp_, mprts, mflds);
+    subcycling.push_subcycled(pushp_, mprts, mflds, n);
+    bndp_(mprts);
+    bnd_.add_ghosts(mflds, JXI, JXI + 3);
+    bnd_.fill_ghosts(mflds, JXI, JXI + 3);
+
+    // the ions are pushed by 2 dt on even steps
+    double fac_e = -(n + 1);
+    double fac_i = .25 * 2 * (n / 2 + 1);
+    auto accessor = mprts.accessor();
+    for (auto prt : accessor[0]) {
+      double fac = prt.kind() == 0 ? fac_e : fac_i;
+      EXPECT_NEAR(prt.u()[0], 1 * fac, eps);
+      EXPECT_NEAR(prt.u()[1], 2 * fac, eps);
+      EXPECT_NEAR(prt.u()[2], 3 * fac, eps);
+    }
+  }
+}
+
+// ======================================================================
+// Subcycle ramp test
+//
+// E ramps up linearly in time, and ions are pushed every third step. Each
+// push has to see the average of E over the three steps it covers, ie., end
+// up where pushing every step would have gotten them. The very first push
+// has no history to extrapolate from, so it uses E at that step.
+
+TYPED_TEST(PushParticlesSubcycleTest, AccelRamp)
+{
+  using Mparticles = typename TypeParam::Mparticles;
+  using MfieldsState = typename TypeParam::MfieldsState;
+  using PushParticles = typename TypeParam::PushParticles;
+  using BndParticles = typename TypeParam::BndParticles;
+  using Bnd = typename TypeParam::Bnd;
+
+  const int n_prts = 131;
+  const int n_steps = 10;
+  const int n_sub = 3;
+  const typename Mparticles::real_t eps = 1e-4;
+
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(-1., 1., "e"),
+                             Grid_t::Kind(1., 4., "i")};
+  this->make_psc(kinds);
+  const auto& grid = this->grid();
+
+  auto E = [](int n) { return 1. + .1 * n; };
+  auto mflds = MfieldsState{grid};
+
+  RngPool rngpool;
+  Rng* rng = rngpool[0];
+
+  Mparticles mprts{grid};
+  {
+    auto inj = mprts.injector();
+    for (int p = 0; p < grid.n_patches(); p++) {
+      auto injector = inj[p];
+      for (int n = 0; n < n_prts; n++) {
+        injector({{rng->uniform(0, this->L), rng->uniform(0, this->L),
+                   rng->uniform(0, this->L)},
+                  {},
+                  1.,
+                  n % 2});
+      }
+    }
+  }
+
+  PushParticles pushp_;
+  BndParticles bndp_{grid};
+  Bnd bnd_{};
+  Subcycling<MfieldsState> subcycling{grid, {1, n_sub}};
+  double fac_e = 0., fac_i = 0.;
+  for (int n = 0; n < n_steps; n++) {
+    setupFields(mflds, [&](int m, double crd[3]) {
+      switch (m) {
+        case EX: return 1. * E(n);
+        case EY: return 2. * E(n);
+        case EZ: return 3. * E(n);
+        default: return 0.;
+      }
+    });
+    subcycling.push_mprts(pushp_, mprts, mflds);
+    subcycling.push_subcycled(pushp_, mprts, mflds, n);
+    bndp_(mprts);
+    bnd_.add_ghosts(mflds, JXI, JXI + 3);
+    bnd_.fill_ghosts(mflds, JXI, JXI + 3);
+
+    fac_e -= E(n);
+    if (n == 0) {
+      fac_i += .25 * n_sub * E(0);
+    } else if (n % n_sub == 0) {
+      for (int k = n; k < n + n_sub; k++) {
+        fac_i += .25 * E(k);
+      }
+    }
+    auto accessor = mprts.accessor();
+    for (auto prt : accessor[0]) {
+      double fac = prt.kind() == 0 ? fac_e : fac_i;
+      EXPECT_NEAR(prt.u()[0], 1 * fac, eps) << "n " << n;
+      EXPECT_NEAR(prt.u()[1], 2 * fac, eps) << "n " << n;
+      EXPECT_NEAR(prt.u()[2], 3 * fac, eps) << "n " << n;
+    }
+  }
+}
+
 // ======================================================================
 // main
 
@@ -0,0 +1,180 @@
+#include "gtest/gtest.h"
+
+#include "test_common.hxx"
+#include "psc_particles_double.h"
+#include "psc_particles_single.h"
+#include "../libpsc/psc_reweight/psc_reweight_impl.hxx"
+
+#include <cstdlib>
+
+template <typename MP>
+struct ReweightTest : ::testing::Test
+{
+  using Mparticles = MP;
+  using Reweight = Reweight_<Mparticles>;
+
+  ReweightTest() : grid_{MakeTestGridYZ1{}()}
+  {
+    grid_.kinds.emplace_back(Grid_t::Kind(1., 1., "test_species"));
+  }
+
+  // particles with random weights and momenta, all in cell (0, 1, 2) of
+  // the (1 x 8 x 16, dx = 10) patch
+  void inject_cell(Mparticles& mprts, int n_prts)
+  {
+    auto inj = mprts.injector()[0];
+    for (int n = 0; n < n_prts; n++) {
+      double y = -30. + 10. * drand48(), z = -60. + 10. * drand48();
+      double ux = 2. * drand48() - 1., uy = 2. * drand48() - 1.,
+             uz = 2. * drand48() - 1.;
+      inj({{5., y, z}, {ux, uy, uz}, .5 + drand48(), 0});
+    }
+  }
+
+  struct Moments
+  {
+    double w = 0., wgamma = 0.;
+    Vec3<double> wu = {}, wx = {};
+  };
+
+  // total charge, momentum and kinetic energy; checks that all particles
+  // are in the cell they started in
+  Moments moments(Mparticles& mprts)
+  {
+    Moments m;
+    auto&& prts = mprts[0];
+    for (int n = 0; n < prts.size(); n++) {
+      const auto& prt = prts[n];
+      EXPECT_EQ(prts.validCellIndex(prt), 2 * 8 + 1);
+      double w = prt.qni_wni;
+      double gamma =
+        std::sqrt(1. + sqr(prt.u[0]) + sqr(prt.u[1]) + sqr(prt.u[2]));
+      m.w += w;
+      m.wgamma += w * gamma;
+      for (int d = 0; d < 3; d++) {
+        m.wu[d] += w * prt.u[d];
+        m.wx[d] += w * prt.x[d];
+      }
+    }
+    return m;
+  }
+
+  void check_conserved(const Moments& m, const Moments& m_ref, double eps)
+  {
+    EXPECT_NEAR(m.w, m_ref.w, eps * m_ref.w);
+    EXPECT_NEAR(m.wgamma, m_ref.wgamma, eps * m_ref.wgamma);
+    for (int d = 0; d < 3; d++) {
+      EXPECT_NEAR(m.wu[d], m_ref.wu[d], eps * m_ref.w);
+    }
+  }
+
+  Grid_t grid_;
+};
+
+using ReweightTestTypes = ::testing::Types<MparticlesSingle, MparticlesDouble>;
+
+TYPED_TEST_SUITE(ReweightTest, ReweightTestTypes);
+
+TYPED_TEST(ReweightTest, Merge)
+{
+  using Base = ReweightTest<TypeParam>;
+  typename Base::Mparticles mprts{this->grid_};
+  typename Base::Reweight reweight{{0, 20}};
+
+  srand48(1);
+  this->inject_cell(mprts, 100);
+  auto m_ref = this->moments(mprts);
+  reweight(mprts);
+  EXPECT_LE(mprts[0].size(), 20);
+  EXPECT_GE(mprts[0].size(), 10);
+  this->check_conserved(this->moments(mprts), m_ref, 1e-5);
+}
+
+// 39 particles into at most 20: groups of (2 * 39 + 19) / 20 = 4 only fit
+// 9 times, which would take away 18 rather than 19
+
+TYPED_TEST(ReweightTest, MergeGroupSize)
+{
+  using Base = ReweightTest<TypeParam>;
+  typename Base::Mparticles mprts{this->grid_};
+  typename Base::Reweight reweight{{0, 20}};
+
+  srand48(1);
+  this->inject_cell(mprts, 39);
+  auto m_ref = this->moments(mprts);
+  reweight(mprts);
+  EXPECT_LE(mprts[0].size(), 20);
+  EXPECT_GE(mprts[0].size(), 10);
+  this->check_conserved(this->moments(mprts), m_ref, 1e-5);
+}
+
+// all momenta along the same direction, so there's no spread perpendicular
+// to the mean momentum to take a direction from
+
+TYPED_TEST(ReweightTest, MergeCollinear)
+{
+  using Base = ReweightTest<TypeParam>;
+  typename Base::Mparticles mprts{this->grid_};
+  typename Base::Reweight reweight{{0, 10}};
+
+  srand48(1);
+  {
+    auto inj = mprts.injector()[0];
+    for (int n = 0; n < 40; n++) {
+      double y = -30. + 10. * drand48(), z = -60. + 10. * drand48();
+      double s = 4. * drand48() - 1.;
+      inj({{5., y, z}, {.5 * s, s, -.25 * s}, .5 + drand48(), 0});
+    }
+  }
+  auto m_ref = this->moments(mprts);
+  reweight(mprts);
+  EXPECT_LE(mprts[0].size(), 10);
+  this->check_conserved(this->moments(mprts), m_ref, 1e-5);
+}
+
+TYPED_TEST(ReweightTest, Split)
+{
+  using Base = ReweightTest<TypeParam>;
+  typename Base::Mparticles mprts{this->grid_};
+  typename Base::Reweight reweight{{8, 0}};
+
+  srand48(1);
+  this->inject_cell(mprts, 3);
+  auto m_ref = this->moments(mprts);
+  reweight(mprts);
+  EXPECT_EQ(mprts[0].size(), 8);
+  auto m = this->moments(mprts);
+  this->check_conserved(m, m_ref, 1e-5);
+  // splitting doesn't move the center of charge
+  for (int d = 0; d < 3; d++) {
+    EXPECT_NEAR(m.wx[d], m_ref.wx[d], 1e-5 * m_ref.w * 10.);
+  }
+}
+
+TYPED_TEST(ReweightTest, InRange)
+{
+  using Base = ReweightTest<TypeParam>;
+  typename Base::Mparticles mprts{this->grid_};
+  typename Base::Reweight reweight{{5, 20}};
+
+  srand48(1);
+  this->inject_cell(mprts, 10);
+  std::vector<typename Base::Mparticles::Particle> before;
+  for (int n = 0; n < mprts[0].size(); n++) {
+    before.push_back(mprts[0][n]);
+  }
+  reweight(mprts);
+  ASSERT_EQ(mprts[0].size(), 10);
+  for (int n = 0; n < mprts[0].size(); n++) {
+    EXPECT_EQ(mprts[0][n], before[n]);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 
 #include "../vpic/PscRng.h"
+#include "rng_philox.hxx"
 
 using Rng = PscRng;
 using RngPool = PscRngPool<Rng>;
@@ -18,6 +19,51 @@ TEST(Rng, RngPool)
   }
 }
 
+TEST(Rng, Philox4x32)
+{
+  // known answers from the Random123 distribution
+  auto ctr = Philox4x32::apply({{0, 0, 0, 0}}, {{0, 0}});
+  EXPECT_EQ(ctr.v[0], 0x6627e8d5);
+  EXPECT_EQ(ctr.v[1], 0xe169c58d);
+  EXPECT_EQ(ctr.v[2], 0xbc57ac4c);
+  EXPECT_EQ(ctr.v[3], 0x9b00dbd8);
+
+  ctr = Philox4x32::apply({{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}},
+                          {{0xffffffff, 0xffffffff}});
+  EXPECT_EQ(ctr.v[0], 0x408f276d);
+  EXPECT_EQ(ctr.v[1], 0x41c83b0e);
+  EXPECT_EQ(ctr.v[2], 0xa20bc7c6);
+  EXPECT_EQ(ctr.v[3], 0x6d5451fd);
+
+  ctr = Philox4x32::apply({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}},
+                          {{0xa4093822, 0x299f31d0}});
+  EXPECT_EQ(ctr.v[0], 0xd16cfe09);
+  EXPECT_EQ(ctr.v[1], 0x94fdcceb);
+  EXPECT_EQ(ctr.v[2], 0x5001e420);
+  EXPECT_EQ(ctr.v[3], 0x24126ea1);
+}
+
+TEST(Rng, RngPhilox)
+{
+  RngPhilox<double> rng1{1234, RNG_STREAM_COLLISION, 7};
+  RngPhilox<double> rng2{1234, RNG_STREAM_COLLISION, 7};
+  RngPhilox<double> rng3{1234, RNG_STREAM_HEATING, 7};
+
+  double sum = 0.;
+  int n_differ = 0;
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    double r1 = rng1.uniform(), r2 = rng2.uniform(), r3 = rng3.uniform();
+    EXPECT_GT(r1, 0.);
+    EXPECT_LE(r1, 1.);
+    EXPECT_EQ(r1, r2); // same key and counter, same sequence
+    n_differ += r1 != r3;
+    sum += r1;
+  }
+  EXPECT_EQ(n_differ, N);
+  EXPECT_NEAR(sum / N, .5, .01);
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
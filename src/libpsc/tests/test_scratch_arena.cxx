@@ -0,0 +1,66 @@
+#include "gtest/gtest.h"
+
+#include "scratch_arena.hxx"
+
+#include <cstdint>
+
+TEST(ScratchArena, Alloc)
+{
+  psc::ScratchArena arena;
+
+  int* a = arena.calloc<int>(10);
+  double* b = arena.alloc<double>(3);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a) % 64, 0);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b) % 64, 0);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(a[i], 0);
+  }
+  EXPECT_EQ(arena.used(), 128);
+}
+
+TEST(ScratchArena, Scope)
+{
+  psc::ScratchArena arena;
+
+  int* a = arena.alloc<int>(1);
+  {
+    psc::ScratchArena::Scope scope(arena);
+    arena.alloc<int>(100);
+    EXPECT_EQ(arena.used(), 64 + 448);
+  }
+  EXPECT_EQ(arena.used(), 64);
+  // space released by the scope gets reused
+  int* b = arena.alloc<int>(1);
+  EXPECT_EQ(b, a + 16);
+  EXPECT_EQ(arena.high_water(), 64 + 448);
+}
+
+TEST(ScratchArena, Grow)
+{
+  psc::ScratchArena arena;
+  const std::size_t n = psc::ScratchArena::MIN_CHUNK_SIZE;
+
+  // doesn't fit into the first chunk, so a second one gets added
+  char* a = arena.alloc<char>(n / 2 + 1);
+  char* b = arena.alloc<char>(n);
+  a[0] = b[n - 1] = 1;
+  EXPECT_GT(arena.capacity(), n);
+
+  // after a reset, it's all in one chunk
+  arena.reset();
+  EXPECT_EQ(arena.used(), 0);
+  std::size_t cap = arena.capacity();
+  EXPECT_GE(cap, arena.high_water());
+  a = arena.alloc<char>(n / 2 + 1);
+  b = arena.alloc<char>(n);
+  EXPECT_EQ(arena.capacity(), cap);
+}
+
+TEST(ScratchArena, PerThread)
+{
+  auto& arena = psc::ScratchArena::get();
+  arena.alloc<int>(16);
+  EXPECT_GE(psc::ScratchArena::high_water_all(), 64);
+  psc::ScratchArena::reset_all();
+  EXPECT_EQ(arena.used(), 0);
+}
@@ -0,0 +1,164 @@
+#include "gtest/gtest.h"
+
+#include "test_common.hxx"
+#include "psc_particles_single.h"
+#include "../libpsc/psc_sort/psc_sort_impl.hxx"
+
+#include <algorithm>
+#include <cstdlib>
+
+template <typename S>
+struct SortTest : ::testing::Test
+{
+  using Sort = S;
+  using Mparticles = typename Sort::Mparticles;
+
+  SortTest() : grid_{MakeTestGridYZ1{}()}
+  {
+    grid_.kinds.emplace_back(Grid_t::Kind(1., 1., "test_species"));
+  }
+
+  // particles in random cells of the (1 x 8 x 16, dx = 10) patch
+  void inject_random(Mparticles& mprts, int n_prts)
+  {
+    auto inj = mprts.injector()[0];
+    for (int n = 0; n < n_prts; n++) {
+      double y = -40. + 80. * drand48(), z = -80. + 160. * drand48();
+      inj({{5., y, z}, {double(n), 0., 0.}, 1., 0});
+    }
+  }
+
+  // move every `stride`th particle by up to one cell in y and z
+  void perturb(Mparticles& mprts, int stride)
+  {
+    auto&& prts = mprts[0];
+    for (int n = 0; n < prts.size(); n += stride) {
+      auto&& prt = prts[n];
+      for (int d = 1; d < 3; d++) {
+        float x = prt.x[d] + 10. * (2. * drand48() - 1.);
+        float xe = grid_.ldims[d] * grid_.domain.dx[d];
+        prt.x[d] = std::max(0.f, std::min(x, xe - 1e-3f));
+      }
+    }
+  }
+
+  void check_sorted(Mparticles& mprts, int n_prts)
+  {
+    auto&& prts = mprts[0];
+    ASSERT_EQ(prts.size(), n_prts);
+    std::vector<int> ids;
+    int last_cni = 0;
+    for (int n = 0; n < prts.size(); n++) {
+      const auto& prt = prts[n];
+      int cni = prts.validCellIndex(prt);
+      EXPECT_GE(cni, last_cni);
+      last_cni = cni;
+      ids.push_back(prt.u[0]);
+    }
+    // every particle is still there, just once
+    std::sort(ids.begin(), ids.end());
+    for (int n = 0; n < n_prts; n++) {
+      EXPECT_EQ(ids[n], n);
+    }
+  }
+
+  Grid_t grid_;
+};
+
+using SortTestTypes = ::testing::Types<SortCountsort2<MparticlesSingle>,
+                                       SortIncremental<MparticlesSingle>>;
+
+TYPED_TEST_SUITE(SortTest, SortTestTypes);
+
+TYPED_TEST(SortTest, Random)
+{
+  using Base = SortTest<TypeParam>;
+  typename Base::Mparticles mprts{this->grid_};
+  typename Base::Sort sort;
+
+  srand48(1);
+  this->inject_random(mprts, 1000);
+  sort(mprts);
+  this->check_sorted(mprts, 1000);
+}
+
+TYPED_TEST(SortTest, Perturbed)
+{
+  using Base = SortTest<TypeParam>;
+  typename Base::Mparticles mprts{this->grid_};
+  typename Base::Sort sort;
+
+  srand48(1);
+  this->inject_random(mprts, 1000);
+  sort(mprts);
+  for (int step = 0; step < 5; step++) {
+    this->perturb(mprts, 7);
+    sort(mprts);
+    this->check_sorted(mprts, 1000);
+  }
+}
+
+// ======================================================================
+// ByKind
+//
+// SortIncremental<..., true> groups particles by kind, then by cell, and
+// records the ranges of each kind
+
+TEST(SortTest, ByKind)
+{
+  using Mparticles = MparticlesSingle;
+  using Sort = SortIncremental<Mparticles, true>;
+  const int n_prts = 1000;
+
+  auto grid = MakeTestGridYZ1{}();
+  grid.kinds.emplace_back(Grid_t::Kind(-1., 1., "e"));
+  grid.kinds.emplace_back(Grid_t::Kind(1., 100., "i"));
+  Mparticles mprts{grid};
+  Sort sort;
+
+  srand48(1);
+  {
+    auto inj = mprts.injector()[0];
+    for (int n = 0; n < n_prts; n++) {
+      double y = -40. + 80. * drand48(), z = -80. + 160. * drand48();
+      inj({{5., y, z}, {double(n), 0., 0.}, 1., n % 3 == 0});
+    }
+  }
+  EXPECT_TRUE(mprts.kind_offsets(0).empty());
+
+  for (int step = 0; step < 3; step++) {
+    sort(mprts);
+
+    const auto& offsets = mprts.kind_offsets(0);
+    ASSERT_EQ(offsets.size(), 3);
+    EXPECT_EQ(offsets[0], 0);
+    EXPECT_EQ(offsets[1], n_prts - (n_prts + 2) / 3);
+    EXPECT_EQ(offsets[2], n_prts);
+
+    auto&& prts = mprts[0];
+    for (int k = 0; k < 2; k++) {
+      int last_cni = 0;
+      for (int n = offsets[k]; n < offsets[k + 1]; n++) {
+        const auto& prt = prts[n];
+        EXPECT_EQ(prt.kind, k);
+        int cni = prts.validCellIndex(prt);
+        EXPECT_GE(cni, last_cni);
+        last_cni = cni;
+      }
+    }
+
+    // anything else that adds particles voids the ranges
+    mprts.injector()[0]({{5., 0., 0.}, {}, 1., 0});
+    EXPECT_TRUE(mprts.kind_offsets(0).empty());
+    mprts.storage().buffer(0).resize(n_prts);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -90,6 +90,37 @@ using TestConfig1vbec3dSingleXZ =
              PushParticlesVb<
                Config1vbecSplit<MparticlesSingle, MfieldsStateSingle, dim_xz>>,
              checks_order_1st>;
+using TestConfig1vbec3dSingleSimd = TestConfig<
+  dim_xyz, MfieldsSingle,
+  PushParticlesVb<
+    Config1vbecSplitSimd<MparticlesSingle, MfieldsStateSingle, dim_xyz>>,
+  checks_order_1st>;
+using TestConfig1vbec3dSingleYZSimd = TestConfig<
+  dim_yz, MfieldsSingle,
+  PushParticlesVb<
+    Config1vbecSplitSimd<MparticlesSingle, MfieldsStateSingle, dim_yz>>,
+  checks_order_1st>;
+// what PscConfig1vbecSimdSingle actually runs
+using TestConfig1vbec3dSingleSimdVar1 = TestConfig<
+  dim_xyz, MfieldsSingle,
+  PushParticlesVb<
+    Config1vbecSimd<MparticlesSingle, MfieldsStateSingle, dim_xyz>>,
+  checks_order_1st>;
+using TestConfig1vbec3dSingleYZSimdVar1 = TestConfig<
+  dim_yz, MfieldsSingle,
+  PushParticlesVb<
+    Config1vbecSimd<MparticlesSingle, MfieldsStateSingle, dim_yz>>,
+  checks_order_1st>;
+using TestConfig1vbec3dSingleTile = TestConfig<
+  dim_xyz, MfieldsSingle,
+  PushParticlesVb<
+    Config1vbecSplitTile<MparticlesSingle, MfieldsStateSingle, dim_xyz>>,
+  checks_order_1st>;
+using TestConfig1vbec3dSingleYZTile = TestConfig<
+  dim_yz, MfieldsSingle,
+  PushParticlesVb<
+    Config1vbecSplitTile<MparticlesSingle, MfieldsStateSingle, dim_yz>>,
+  checks_order_1st>;
 
 using VpicConfig = VpicConfigPsc;
 
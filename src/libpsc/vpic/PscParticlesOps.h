@@ -2,6 +2,14 @@
 #pragma once
 
 #include "psc_vpic_bits.h"
+#include "PscConfig.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef PSC_HAVE_OPENMP
+#include <omp.h>
+#endif
 
 #ifdef USE_VPIC
 #define HAS_V4_PIPELINE
@@ -417,7 +425,7 @@ struct PscParticlesOps
 #endif
 
   // ----------------------------------------------------------------------
-  // advance_p
+  // advance_p_pipeline
 
   typedef struct particle_mover_seg
   {
@@ -752,38 +760,84 @@ struct PscParticlesOps
 
 #endif
 
+  // ----------------------------------------------------------------------
+  // advance_p
+  //
+  // The bulk of the particles (a multiple of 16) is split into n_pipeline
+  // contiguous segments that are pushed concurrently, one per thread. Each
+  // pipeline accumulates into its own block 1 ... n_pipeline of the
+  // accumulator (so they get summed up by AccumulatorOps::reduce), and
+  // records its movers in its own share of the species' mover array. The
+  // movers are compacted afterwards, and the leftover particles are pushed
+  // into block 0 with whatever mover storage remains.
+  //
+  // By default, there is one pipeline per OpenMP thread.
+
   static void advance_p(typename Mparticles::Species& sp,
                         MfieldsAccumulator& accumulator,
                         MfieldsInterpolator& interpolator)
   {
-    DECLARE_ALIGNED_ARRAY(particle_mover_seg_t, 128, seg, 1);
+    int n_pipeline = 1;
+#ifdef PSC_HAVE_OPENMP
+    n_pipeline = omp_get_max_threads();
+#endif
+    advance_p(sp, accumulator, interpolator, n_pipeline);
+  }
 
-    sp.nm = 0;
+  static void advance_p(typename Mparticles::Species& sp,
+                        MfieldsAccumulator& accumulator,
+                        MfieldsInterpolator& interpolator, int n_pipeline)
+  {
+    n_pipeline = std::max(1, std::min(n_pipeline, accumulator.n_pipeline()));
+
+    std::vector<particle_mover_seg_t> seg(n_pipeline);
+    std::vector<int> pm_off(n_pipeline + 1);
 
-    Particle* p = sp.p;
-    int n = sp.np & ~15;
+    int n_blocks = sp.np / 16;
+    int max_nm = sp.max_nm;
+    for (int r = 0; r <= n_pipeline; r++) {
+      pm_off[r] = int((long(max_nm) * r) / n_pipeline);
+    }
+
+#pragma omp parallel for
+    for (int r = 0; r < n_pipeline; r++) {
+      int ib = int((long(n_blocks) * r) / n_pipeline);
+      int ie = int((long(n_blocks) * (r + 1)) / n_pipeline);
+      Particle* p = sp.p + 16 * ib;
+      int n = 16 * (ie - ib);
 #if defined(V4_ACCELERATION) && defined(HAS_V4_PIPELINE)
-    advance_p_pipeline_v4(sp, accumulator[1], interpolator, seg, p, n,
-                          sp.pm + sp.nm, sp.max_nm - sp.nm);
+      advance_p_pipeline_v4(sp, accumulator[r + 1], interpolator, &seg[r], p,
+                            n, sp.pm + pm_off[r], pm_off[r + 1] - pm_off[r]);
 #else
-    advance_p_pipeline(sp, accumulator[1], interpolator, seg, p, n,
-                       sp.pm + sp.nm, sp.max_nm - sp.nm);
+      advance_p_pipeline(sp, accumulator[r + 1], interpolator, &seg[r], p, n,
+                         sp.pm + pm_off[r], pm_off[r + 1] - pm_off[r]);
 #endif
-    sp.nm += seg->nm;
+    }
 
-    if (seg->n_ignored)
-      LOG_WARN("Pipeline %i ran out of storage for %i movers", 0,
-               seg->n_ignored);
+    // merge the movers from all pipelines
+    sp.nm = 0;
+    for (int r = 0; r < n_pipeline; r++) {
+      if (seg[r].n_ignored) {
+        LOG_WARN("Pipeline %i ran out of storage for %i movers", r,
+                 seg[r].n_ignored);
+      }
+      if (sp.nm != pm_off[r]) {
+        std::copy(sp.pm + pm_off[r], sp.pm + pm_off[r] + seg[r].nm,
+                  sp.pm + sp.nm);
+      }
+      sp.nm += seg[r].nm;
+    }
 
-    p += n;
-    n = sp.np - n;
-    advance_p_pipeline(sp, accumulator[0], interpolator, seg, p, n,
+    Particle* p = sp.p + 16 * n_blocks;
+    int n = sp.np - 16 * n_blocks;
+    advance_p_pipeline(sp, accumulator[0], interpolator, &seg[0], p, n,
                        sp.pm + sp.nm, sp.max_nm - sp.nm);
-    sp.nm += seg->nm;
+    sp.nm += seg[0].nm;
 
-    if (seg->n_ignored)
-      LOG_WARN("Pipeline %i ran out of storage for %i movers", 1,
-               seg->n_ignored);
+    if (seg[0].n_ignored) {
+      LOG_WARN("Pipeline %i ran out of storage for %i movers", n_pipeline,
+               seg[0].n_ignored);
+    }
   }
 
   static void advance_p(Mparticles& mprts, MfieldsAccumulator& accumulator,
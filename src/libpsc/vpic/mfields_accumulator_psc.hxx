@@ -3,6 +3,14 @@
 
 #include "PscFieldBase.h"
 
+#include "PscConfig.h"
+
+#include <algorithm>
+
+#ifdef PSC_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 // ======================================================================
 // MfieldsAccumulatorPsc
 
@@ -40,15 +48,14 @@ struct MfieldsAccumulatorPsc
 
   ~MfieldsAccumulatorPsc() { delete[] arr_; }
 
+  // one block per thread that may run advance_p, (at least 2, as
+  // originally), plus block 0 for the leftover particles
   static int aa_n_pipeline(void)
   {
+#ifdef PSC_HAVE_OPENMP
+    return std::max(2, omp_get_max_threads());
+#else
     return 2;
-#if 0
-    int n = serial.n_pipeline;
-    if (n < thread.n_pipeline) {
-      n = thread.n_pipeline;
-    }
-    return n;
 #endif
   }
 
@@ -65,7 +72,7 @@ struct MfieldsAccumulatorPsc
 
   Block operator[](int c)
   {
-    assert(c >= 0 && c < n_pipeline_);
+    assert(c >= 0 && c <= n_pipeline_);
     return Block(grid(), arr_ + c * stride_);
   }
 
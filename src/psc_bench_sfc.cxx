@@ -0,0 +1,67 @@
+
+#include <psc.hxx>
+
+#include "psc_config.hxx"
+
+// ======================================================================
+// psc_bench_sfc
+//
+// Compares the space-filling curves that can be used to order the patches
+// by how much halo surface the resulting decomposition has between procs.
+// Run with the number of procs of interest, e.g.
+//
+//   mpirun -n 64 psc_bench_sfc 512 512 512 32 32 32
+//
+// (global number of cells, then number of patches, in each direction)
+
+int main(int argc, char** argv)
+{
+  psc_init(argc, argv);
+
+  Int3 gdims = {256, 256, 256};
+  Int3 np = {16, 16, 16};
+  if (argc == 7) {
+    for (int d = 0; d < 3; d++) {
+      gdims[d] = atoi(argv[1 + d]);
+      np[d] = atoi(argv[4 + d]);
+    }
+  }
+
+  int size;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  mpi_printf(MPI_COMM_WORLD,
+             "psc_bench_sfc: %d x %d x %d cells, %d x %d x %d patches, "
+             "%d procs\n",
+             gdims[0], gdims[1], gdims[2], np[0], np[1], np[2], size);
+
+  bool is_pow2 = true;
+  for (int d = 0; d < 3; d++) {
+    is_pow2 = is_pow2 && (np[d] & (np[d] - 1)) == 0;
+  }
+
+  for (auto curve : {psc::grid::Curve::BYDIM, psc::grid::Curve::MORTON,
+                     psc::grid::Curve::HILBERT}) {
+    if (curve == psc::grid::Curve::MORTON && !is_pow2) {
+      continue;
+    }
+
+    auto domain = Grid_t::Domain{gdims, Grid_t::Real3(gdims), {}, np};
+    domain.curve = curve;
+    auto bc = psc::grid::BC{};
+    for (int d = 0; d < 3; d++) {
+      bc.fld_lo[d] = bc.fld_hi[d] = BND_FLD_PERIODIC;
+      bc.prt_lo[d] = bc.prt_hi[d] = BND_PRT_PERIODIC;
+    }
+    Grid_t grid{domain, bc, {}, {}, 1.};
+
+    auto halo = psc::balance::get_halo_stats(grid);
+    mpi_printf(MPI_COMM_WORLD,
+               "%-8s halo surface avg %10g max %10g  "
+               "neighbor procs avg %6g max %4g\n",
+               psc::grid::to_string(curve), halo.surface_avg,
+               halo.surface_max, halo.n_neighbors_avg, halo.n_neighbors_max);
+  }
+
+  psc_finalize();
+  return 0;
+}
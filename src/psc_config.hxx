@@ -15,6 +15,7 @@
 #include "../libpsc/psc_output_particles/output_particles_none_impl.hxx"
 #include "../libpsc/psc_push_fields/marder_impl.hxx"
 #include "../libpsc/psc_push_particles/1vb/psc_push_particles_1vb.h"
+#include "../libpsc/psc_reweight/psc_reweight_impl.hxx"
 #include "../libpsc/psc_sort/psc_sort_impl.hxx"
 #include "bnd_particles_impl.hxx"
 #include "psc_push_fields_impl.hxx"
@@ -72,6 +73,52 @@ struct PscConfigPushParticles1vbec<dim_xz, Mparticles, Mfields>
     PushParticlesVb<Config1vbecSplit<Mparticles, Mfields, dim_xz>>;
 };
 
+// 1vbec pushed Simd::size() particles at a time, see PushpConfigVbSimd
+
+template <typename _Dim, typename Mparticles, typename MfieldsState>
+struct PscConfigPushParticles1vbecSimd
+{
+  using PushParticles =
+    PushParticlesVb<Config1vbecSimd<Mparticles, MfieldsState, _Dim>>;
+};
+
+template <typename Mparticles, typename Mfields>
+struct PscConfigPushParticles1vbecSimd<dim_xyz, Mparticles, Mfields>
+{
+  using PushParticles =
+    PushParticlesVb<Config1vbecSplitSimd<Mparticles, Mfields, dim_xyz>>;
+};
+
+template <typename Mparticles, typename Mfields>
+struct PscConfigPushParticles1vbecSimd<dim_xz, Mparticles, Mfields>
+{
+  using PushParticles =
+    PushParticlesVb<Config1vbecSplitSimd<Mparticles, Mfields, dim_xz>>;
+};
+
+// 1vbec using per-block field tiles, see PushpConfigVbTile
+
+template <typename _Dim, typename Mparticles, typename MfieldsState>
+struct PscConfigPushParticles1vbecTile
+{
+  using PushParticles =
+    PushParticlesVb<Config1vbecTile<Mparticles, MfieldsState, _Dim>>;
+};
+
+template <typename Mparticles, typename Mfields>
+struct PscConfigPushParticles1vbecTile<dim_xyz, Mparticles, Mfields>
+{
+  using PushParticles =
+    PushParticlesVb<Config1vbecSplitTile<Mparticles, Mfields, dim_xyz>>;
+};
+
+template <typename Mparticles, typename Mfields>
+struct PscConfigPushParticles1vbecTile<dim_xz, Mparticles, Mfields>
+{
+  using PushParticles =
+    PushParticlesVb<Config1vbecSplitTile<Mparticles, Mfields, dim_xz>>;
+};
+
 template <typename _Dim, typename _Mparticles, typename _MfieldsState,
           typename _Mfields, template <typename...> class ConfigPushParticles,
           typename _Simulation = SimulationNone>
@@ -86,6 +133,7 @@ struct PscConfig_
   using checks_order = typename PushParticles::checks_order;
   using Sort = SortCountsort2<Mparticles>;
   using Collision = Collision_<Mparticles, MfieldsState, Mfields>;
+  using Reweight = Reweight_<Mparticles>;
   using PushFields = ::PushFields<MfieldsState>;
   using BndParticles = BndParticles_<Mparticles>;
   using Bnd = Bnd_;
@@ -112,6 +160,7 @@ struct PscConfig_<_Dim, _Mparticles, _MfieldsState, _Mfields,
   using PushParticles = PushParticlesCuda<CudaConfig1vbec3d<Dim, BS>>;
   using Sort = SortCuda<BS>;
   using Collision = CollisionCuda<Mparticles>;
+  using Reweight = ReweightNone;
   using PushFields = PushFieldsCuda;
   using BndParticles = BndParticlesCuda<Mparticles, Dim>;
   using Bnd = BndCuda3;
@@ -134,6 +183,7 @@ struct PscConfig_<dim_xyz, _Mparticles, _MfieldsState, _Mfields,
   using PushParticles = PushParticlesCuda<CudaConfig1vbec3dGmem<Dim, BS>>;
   using Sort = SortCuda<BS>;
   using Collision = CollisionCuda<Mparticles>;
+  using Reweight = ReweightNone;
   using PushFields = PushFieldsCuda;
   using BndParticles = BndParticlesCuda<Mparticles, Dim>;
   using Bnd_t = BndCuda3;
@@ -161,11 +211,35 @@ using PscConfig1vbecSingle =
   PscConfig_<dim, MparticlesSingle, MfieldsStateSingle, MfieldsSingle,
              PscConfigPushParticles1vbec>;
 
+template <typename dim>
+using PscConfig1vbecSimdSingle =
+  PscConfig_<dim, MparticlesSingle, MfieldsStateSingle, MfieldsSingle,
+             PscConfigPushParticles1vbecSimd>;
+
+template <typename dim>
+using PscConfig1vbecTileSingle =
+  PscConfig_<dim, MparticlesSingle, MfieldsStateSingle, MfieldsSingle,
+             PscConfigPushParticles1vbecTile>;
+
 template <typename dim>
 using PscConfig1vbecDouble =
   PscConfig_<dim, MparticlesDouble, MfieldsStateDouble, MfieldsC,
              PscConfigPushParticles1vbec>;
 
+// ----------------------------------------------------------------------
+// PscConfigSortIncremental
+//
+// a config that uses SortIncremental instead of the default sort, which
+// pays off when sorting (nearly) every step, e.g.
+//   using PscConfig = PscConfigSortIncremental<PscConfig1vbecSingle<Dim>>;
+// With BY_KIND = true, particles are kept grouped by kind, too.
+
+template <typename PscConfig, bool BY_KIND = false>
+struct PscConfigSortIncremental : PscConfig
+{
+  using Sort = SortIncremental<typename PscConfig::Mparticles, BY_KIND>;
+};
+
 #ifdef USE_CUDA
 
 template <typename dim>
@@ -204,6 +278,7 @@ struct PscConfigVpicWrap
   using Balance = Balance_<MparticlesSingle, MfieldsStateSingle, MfieldsSingle>;
   using Sort = SortVpicWrap<Mparticles>;
   using Collision = PscCollisionVpic;
+  using Reweight = ReweightNone;
   using PushParticles = PushParticlesVpic<
     Mparticles, MfieldsState, typename VpicConfig::ParticlesOps,
     typename VpicConfig::AccumulatorOps, typename VpicConfig::AccumulateOps,
@@ -242,6 +317,7 @@ struct PscConfigVpicPsc
   using Balance = Balance_<MparticlesSingle, MfieldsStateSingle, MfieldsSingle>;
   using Sort = SortVpic<Mparticles>;
   using Collision = PscCollisionVpic;
+  using Reweight = ReweightNone;
   using PushParticles = PushParticlesVpic<
     Mparticles, MfieldsState, typename VpicConfig::ParticlesOps,
     typename VpicConfig::AccumulatorOps, typename VpicConfig::AccumulateOps,